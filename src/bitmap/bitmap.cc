@@ -0,0 +1,369 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// rocksdb
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/slice.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/bitmap/bitmap.h"
+
+namespace small::bitmap {
+
+namespace {
+
+constexpr char kArrayTag = 'A';
+constexpr char kBitsetTag = 'B';
+
+constexpr char kAddOp = '+';
+constexpr char kRemoveOp = '-';
+
+void put_fixed16(std::string* dst, uint16_t value) {
+    dst->push_back(static_cast<char>(value & 0xff));
+    dst->push_back(static_cast<char>(value >> 8));
+}
+
+uint16_t get_fixed16(const char* p) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(p[0]) |
+                                 (static_cast<uint8_t>(p[1]) << 8));
+}
+
+void put_fixed64(std::string* dst, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        dst->push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+    }
+}
+
+uint64_t get_fixed64(const char* p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (i * 8);
+    }
+    return value;
+}
+
+}  // namespace
+
+bool Container::Add(uint16_t value) {
+    if (is_bitset_) {
+        uint64_t mask = uint64_t(1) << (value % 64);
+        if (words_[value / 64] & mask) {
+            return false;
+        }
+        words_[value / 64] |= mask;
+        cardinality_++;
+        return true;
+    }
+
+    auto it = std::lower_bound(array_.begin(), array_.end(), value);
+    if (it != array_.end() && *it == value) {
+        return false;
+    }
+    array_.insert(it, value);
+    if (array_.size() > kMaxArraySize) {
+        ToBitset();
+    }
+    return true;
+}
+
+bool Container::Remove(uint16_t value) {
+    if (is_bitset_) {
+        uint64_t mask = uint64_t(1) << (value % 64);
+        if (!(words_[value / 64] & mask)) {
+            return false;
+        }
+        words_[value / 64] &= ~mask;
+        cardinality_--;
+        MaybeToArray();
+        return true;
+    }
+
+    auto it = std::lower_bound(array_.begin(), array_.end(), value);
+    if (it == array_.end() || *it != value) {
+        return false;
+    }
+    array_.erase(it);
+    return true;
+}
+
+bool Container::Contains(uint16_t value) const {
+    if (is_bitset_) {
+        return words_[value / 64] & (uint64_t(1) << (value % 64));
+    }
+    return std::binary_search(array_.begin(), array_.end(), value);
+}
+
+int64_t Container::Cardinality() const {
+    return is_bitset_ ? cardinality_ : array_.size();
+}
+
+void Container::UnionWith(const Container& other) {
+    if (!is_bitset_ && !other.is_bitset_) {
+        std::vector<uint16_t> result;
+        result.reserve(array_.size() + other.array_.size());
+        std::set_union(array_.begin(), array_.end(), other.array_.begin(),
+                       other.array_.end(), std::back_inserter(result));
+        array_ = std::move(result);
+        if (array_.size() > kMaxArraySize) {
+            ToBitset();
+        }
+        return;
+    }
+
+    ToBitset();
+    if (other.is_bitset_) {
+        for (int i = 0; i < kWords; i++) {
+            words_[i] |= other.words_[i];
+        }
+    } else {
+        for (uint16_t value : other.array_) {
+            words_[value / 64] |= uint64_t(1) << (value % 64);
+        }
+    }
+
+    cardinality_ = 0;
+    for (uint64_t word : words_) {
+        cardinality_ += __builtin_popcountll(word);
+    }
+}
+
+void Container::IntersectWith(const Container& other) {
+    if (!is_bitset_) {
+        std::vector<uint16_t> result;
+        for (uint16_t value : array_) {
+            if (other.Contains(value)) {
+                result.push_back(value);
+            }
+        }
+        array_ = std::move(result);
+        return;
+    }
+
+    if (!other.is_bitset_) {
+        std::vector<uint16_t> result;
+        for (uint16_t value : other.array_) {
+            if (Contains(value)) {
+                result.push_back(value);
+            }
+        }
+        is_bitset_ = false;
+        words_.clear();
+        cardinality_ = 0;
+        array_ = std::move(result);
+        return;
+    }
+
+    cardinality_ = 0;
+    for (int i = 0; i < kWords; i++) {
+        words_[i] &= other.words_[i];
+        cardinality_ += __builtin_popcountll(words_[i]);
+    }
+    MaybeToArray();
+}
+
+std::string Container::Serialize() const {
+    std::string data;
+    if (!is_bitset_) {
+        data.reserve(1 + array_.size() * 2);
+        data.push_back(kArrayTag);
+        for (uint16_t value : array_) {
+            put_fixed16(&data, value);
+        }
+        return data;
+    }
+
+    data.reserve(1 + kWords * 8);
+    data.push_back(kBitsetTag);
+    for (uint64_t word : words_) {
+        put_fixed64(&data, word);
+    }
+    return data;
+}
+
+bool Container::Deserialize(std::string_view data, Container* container) {
+    if (data.empty()) {
+        return false;
+    }
+
+    *container = Container();
+    if (data[0] == kArrayTag) {
+        if ((data.size() - 1) % 2 != 0) {
+            return false;
+        }
+        for (size_t i = 1; i < data.size(); i += 2) {
+            container->array_.push_back(get_fixed16(data.data() + i));
+        }
+        return true;
+    }
+
+    if (data[0] == kBitsetTag && data.size() == 1 + kWords * 8) {
+        container->is_bitset_ = true;
+        container->words_.resize(kWords);
+        for (int i = 0; i < kWords; i++) {
+            container->words_[i] = get_fixed64(data.data() + 1 + i * 8);
+            container->cardinality_ +=
+                __builtin_popcountll(container->words_[i]);
+        }
+        return true;
+    }
+    return false;
+}
+
+void Container::ToBitset() {
+    if (is_bitset_) {
+        return;
+    }
+    words_.assign(kWords, 0);
+    for (uint16_t value : array_) {
+        words_[value / 64] |= uint64_t(1) << (value % 64);
+    }
+    cardinality_ = array_.size();
+    array_.clear();
+    array_.shrink_to_fit();
+    is_bitset_ = true;
+}
+
+void Container::MaybeToArray() {
+    if (!is_bitset_ || cardinality_ > kMaxArraySize) {
+        return;
+    }
+    std::vector<uint16_t> values;
+    values.reserve(cardinality_);
+    ForEach([&](uint16_t value) { values.push_back(value); });
+    is_bitset_ = false;
+    words_.clear();
+    words_.shrink_to_fit();
+    cardinality_ = 0;
+    array_ = std::move(values);
+}
+
+void Bitmap::Add(uint64_t row_id) {
+    containers_[row_id >> 16].Add(static_cast<uint16_t>(row_id & 0xffff));
+}
+
+int64_t Bitmap::Cardinality() const {
+    int64_t cardinality = 0;
+    for (const auto& [_, container] : containers_) {
+        cardinality += container.Cardinality();
+    }
+    return cardinality;
+}
+
+void Bitmap::SetContainer(uint64_t high, Container container) {
+    if (container.Cardinality() == 0) {
+        containers_.erase(high);
+        return;
+    }
+    containers_[high] = std::move(container);
+}
+
+void Bitmap::UnionWith(const Bitmap& other) {
+    for (const auto& [high, container] : other.containers_) {
+        auto it = containers_.find(high);
+        if (it == containers_.end()) {
+            containers_.emplace(high, container);
+        } else {
+            it->second.UnionWith(container);
+        }
+    }
+}
+
+void Bitmap::IntersectWith(const Bitmap& other) {
+    for (auto it = containers_.begin(); it != containers_.end();) {
+        auto other_it = other.containers_.find(it->first);
+        if (other_it == other.containers_.end()) {
+            it = containers_.erase(it);
+            continue;
+        }
+        it->second.IntersectWith(other_it->second);
+        if (it->second.Cardinality() == 0) {
+            it = containers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+uint64_t to_row_id(int64_t pk) {
+    return static_cast<uint64_t>(pk) ^ (uint64_t(1) << 63);
+}
+
+int64_t to_pk(uint64_t row_id) {
+    return static_cast<int64_t>(row_id ^ (uint64_t(1) << 63));
+}
+
+std::string add_operand(uint16_t value) {
+    std::string operand(1, kAddOp);
+    put_fixed16(&operand, value);
+    return operand;
+}
+
+std::string remove_operand(uint16_t value) {
+    std::string operand(1, kRemoveOp);
+    put_fixed16(&operand, value);
+    return operand;
+}
+
+bool ContainerMergeOperator::FullMergeV2(
+    const MergeOperationInput& merge_in,
+    MergeOperationOutput* merge_out) const {
+    Container container;
+    if (merge_in.existing_value != nullptr) {
+        const rocksdb::Slice* existing = merge_in.existing_value;
+        std::string_view data(existing->data(), existing->size());
+        if (!Container::Deserialize(data, &container)) {
+            return false;
+        }
+    }
+
+    for (const auto& operand : merge_in.operand_list) {
+        if (operand.size() % 3 != 0) {
+            return false;
+        }
+        for (size_t i = 0; i < operand.size(); i += 3) {
+            uint16_t value = get_fixed16(operand.data() + i + 1);
+            if (operand[i] == kAddOp) {
+                container.Add(value);
+            } else if (operand[i] == kRemoveOp) {
+                container.Remove(value);
+            } else {
+                return false;
+            }
+        }
+    }
+
+    merge_out->new_value = container.Serialize();
+    return true;
+}
+
+}  // namespace small::bitmap
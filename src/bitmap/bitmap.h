@@ -0,0 +1,148 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// rocksdb
+#include "rocksdb/merge_operator.h"
+
+namespace small::bitmap {
+
+// A set of row IDs sharing the same high 48 bits, only the low 16 bits are
+// stored (a Roaring container). Small sets are sorted arrays, sets with more
+// than "kMaxArraySize" values are bitsets of 65536 bits, so a container never
+// takes more than 8KB.
+class Container {
+   public:
+    static constexpr int kMaxArraySize = 4096;
+
+    // Return true if the value is added (removed), i.e. it was not (was) in
+    // the set.
+    bool Add(uint16_t value);
+    bool Remove(uint16_t value);
+
+    bool Contains(uint16_t value) const;
+
+    int64_t Cardinality() const;
+
+    void UnionWith(const Container& other);
+    void IntersectWith(const Container& other);
+
+    // Call "f" for each value in ascending order.
+    template <typename F>
+    void ForEach(F f) const {
+        if (!is_bitset_) {
+            for (uint16_t value : array_) {
+                f(value);
+            }
+            return;
+        }
+        for (int i = 0; i < kWords; i++) {
+            uint64_t word = words_[i];
+            while (word != 0) {
+                int bit = __builtin_ctzll(word);
+                f(static_cast<uint16_t>(i * 64 + bit));
+                word &= word - 1;
+            }
+        }
+    }
+
+    // The format is "A" followed by the values (uint16, little-endian) for an
+    // array, or "B" followed by the 1024 words (uint64, little-endian) for a
+    // bitset.
+    std::string Serialize() const;
+
+    // Return false if "data" is corrupted.
+    static bool Deserialize(std::string_view data, Container* container);
+
+   private:
+    static constexpr int kWords = 65536 / 64;
+
+    bool is_bitset_ = false;
+
+    // sorted values if the container is an array
+    std::vector<uint16_t> array_;
+
+    // bits if the container is a bitset
+    std::vector<uint64_t> words_;
+    int64_t cardinality_ = 0;
+
+    void ToBitset();
+    void MaybeToArray();
+};
+
+// A compressed set of 64-bit row IDs, containers are keyed by the high 48 bits.
+class Bitmap {
+   public:
+    void Add(uint64_t row_id);
+
+    int64_t Cardinality() const;
+
+    void SetContainer(uint64_t high, Container container);
+
+    void UnionWith(const Bitmap& other);
+    void IntersectWith(const Bitmap& other);
+
+    // Call "f" for each row ID in ascending order.
+    template <typename F>
+    void ForEach(F f) const {
+        for (const auto& [high, container] : containers_) {
+            container.ForEach(
+                [&](uint16_t low) { f((high << 16) | low); });
+        }
+    }
+
+    const std::map<uint64_t, Container>& containers() const {
+        return containers_;
+    }
+
+   private:
+    std::map<uint64_t, Container> containers_;
+};
+
+// Map an int64 primary key to a row ID (and back), the order is kept.
+uint64_t to_row_id(int64_t pk);
+int64_t to_pk(uint64_t row_id);
+
+// Merge operands of a container, the low 16 bits of a row ID to add (remove).
+// Operands can be concatenated into one, which applies them in order, e.g.
+// the single entry of a container in an SST file of a bulk load.
+std::string add_operand(uint16_t value);
+std::string remove_operand(uint16_t value);
+
+// Apply add/remove operands to a serialized container, so the write path
+// updates a bitmap without reading it.
+class ContainerMergeOperator : public rocksdb::MergeOperator {
+   public:
+    bool FullMergeV2(const MergeOperationInput& merge_in,
+                     MergeOperationOutput* merge_out) const override;
+
+    const char* Name() const override { return "small.ContainerMerge"; }
+};
+
+}  // namespace small::bitmap
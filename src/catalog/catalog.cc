@@ -16,8 +16,11 @@
 // c++ std
 // =====================================================================
 
+#include <algorithm>
+#include <exception>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -36,6 +39,7 @@
 // local libraries
 // =====================================================================
 
+#include "src/schema/const.h"
 #include "src/server_info/info.h"
 
 // =====================================================================
@@ -48,6 +52,29 @@ namespace small::catalog {
 
 Catalog* Catalog::instancePtr = nullptr;
 
+namespace {
+
+// Assign column IDs in the order of the columns.
+std::vector<small::schema::Column> with_column_ids(
+    std::vector<small::schema::Column> columns) {
+    int64_t column_id = small::schema::kFirstColumnID;
+    for (auto& column : columns) {
+        column.id = column_id++;
+    }
+    return columns;
+}
+
+std::string table_metadata_key(int64_t table_id) {
+    return "T:" + std::to_string(table_id);
+}
+
+// The next table (index) ID, written with every table (index) created, so the
+// ID of a dropped table (index) is never reused either.
+constexpr std::string_view kNextTableIDKey = "N:table";
+constexpr std::string_view kNextIndexIDKey = "N:index";
+
+}  // namespace
+
 void Catalog::InitInstance() {
     if (instancePtr == nullptr) {
         instancePtr = new Catalog();
@@ -64,12 +91,15 @@ Catalog* Catalog::GetInstance() {
     return instancePtr;
 }
 
-Catalog::Catalog() {
+Catalog::Catalog()
+    : next_table_id(small::schema::kFirstUserTableID),
+      next_index_id(small::schema::kFirstIndexID) {
     std::vector<small::schema::Column> columns;
     columns.emplace_back("table_name", small::type::Type::String, true);
     columns.emplace_back("columns", small::type::Type::String);
-    this->tables["system.tables"] =
-        std::make_shared<small::schema::Table>("system.tables", columns);
+    this->tables["system.tables"] = std::make_shared<small::schema::Table>(
+        small::schema::kSystemTablesID, "system.tables",
+        with_column_ids(columns));
     this->system_tables = this->tables["system.tables"];
 
     columns.clear();
@@ -78,8 +108,9 @@ Catalog::Catalog() {
     columns.emplace_back("constraint", small::type::Type::String);
     columns.emplace_back("column_name", small::type::Type::String);
     columns.emplace_back("partition_value", small::type::Type::String);
-    this->tables["system.partitions"] =
-        std::make_shared<small::schema::Table>("system.partitions", columns);
+    this->tables["system.partitions"] = std::make_shared<small::schema::Table>(
+        small::schema::kSystemPartitionsID, "system.partitions",
+        with_column_ids(columns));
     this->system_partitions = this->tables["system.partitions"];
 
     auto info = small::server_info::get_info();
@@ -89,7 +120,36 @@ Catalog::Catalog() {
     }
     std::string db_path = info.value()->db_path;
     this->db = small::rocks::RocksDBWrapper::GetInstance(
-        db_path, {"TablesCF", "PartitionCF"});
+        db_path, {"TablesCF", "PartitionCF", "IndexCF", "BitmapCF"});
+    RecoverNextIDs();
+}
+
+void Catalog::RecoverNextIDs() {
+    try {
+        for (const auto& [key, value] : db->GetAllKV("TablesCF")) {
+            if (key == kNextTableIDKey) {
+                next_table_id = std::max(
+                    next_table_id, nlohmann::json::parse(value).get<int64_t>());
+            } else if (key == kNextIndexIDKey) {
+                next_index_id = std::max(
+                    next_index_id, nlohmann::json::parse(value).get<int64_t>());
+            } else if (key.rfind("T:", 0) == 0) {
+                // tables created before the counters were written
+                auto j = nlohmann::json::parse(value);
+                next_table_id =
+                    std::max(next_table_id, j.at("id").get<int64_t>() + 1);
+                for (const auto& index : j.value("indexes", nlohmann::json())) {
+                    next_index_id = std::max(
+                        next_index_id, index.at("id").get<int64_t>() + 1);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        SPDLOG_ERROR("failed to recover the next IDs: {}", e.what());
+        return;
+    }
+    SPDLOG_INFO("next table ID: {}, next index ID: {}", next_table_id,
+                next_index_id);
 }
 
 std::optional<std::shared_ptr<small::schema::Table>> Catalog::GetTable(
@@ -104,37 +164,184 @@ std::optional<std::shared_ptr<small::schema::Table>> Catalog::GetTable(
 
 absl::Status Catalog::CreateTable(
     const std::string& table_name,
-    const std::vector<small::schema::Column>& columns) {
+    const std::vector<small::schema::Column>& columns,
+    const std::vector<std::pair<std::string, std::vector<std::string>>>&
+        families) {
     auto table = GetTable(table_name);
     if (table.has_value()) {
         return absl::AlreadyExistsError("Table already exists");
     }
 
+    auto new_table = std::make_shared<small::schema::Table>(
+        next_table_id, table_name, with_column_ids(columns));
+    for (const auto& [family_name, column_names] : families) {
+        small::schema::Family family;
+        family.id = new_table->families.size() + 1;
+        family.name = family_name;
+        for (const auto& other : new_table->families) {
+            if (other.name == family_name) {
+                return absl::InvalidArgumentError("Duplicate family: " +
+                                                  family_name);
+            }
+        }
+
+        std::vector<bool> in_family(new_table->columns.size(), false);
+        for (const auto& name : column_names) {
+            int i = new_table->get_column_index(name);
+            if (i == -1) {
+                return absl::InvalidArgumentError("Column not found: " + name);
+            }
+            const auto& column = new_table->columns[i];
+            if (column.is_primary_key) {
+                return absl::InvalidArgumentError(
+                    "the primary key must be in the primary family: " + name);
+            }
+            if (new_table->get_family_id(column.id) != 0) {
+                return absl::InvalidArgumentError(
+                    "column is in more than one family: " + name);
+            }
+            in_family[i] = true;
+        }
+        for (int i = 0; i < new_table->columns.size(); i++) {
+            if (in_family[i]) {
+                family.column_ids.push_back(new_table->columns[i].id);
+            }
+        }
+        if (family.column_ids.empty()) {
+            return absl::InvalidArgumentError("Empty family: " + family_name);
+        }
+        new_table->families.push_back(family);
+    }
+
     // write to in-memory cache
-    auto new_table =
-        std::make_shared<small::schema::Table>(table_name, columns);
+    next_table_id++;
     tables[table_name] = new_table;
 
-    // write to disk
+    // write to disk, the row in "system.tables" and the table metadata are
+    // committed atomically
     std::vector<small::type::Datum> row;
     row.emplace_back(table_name);
-    row.emplace_back(nlohmann::json(columns).dump());
-
-    db->WriteRow(this->system_tables, row);
+    row.emplace_back(nlohmann::json(new_table->columns).dump());
+
+    rocksdb::WriteBatch batch;
+    db->PutRow(&batch, this->system_tables, row);
+    db->Put(&batch, "TablesCF", table_metadata_key(new_table->id),
+            nlohmann::json(*new_table).dump());
+    db->Put(&batch, "TablesCF", std::string(kNextTableIDKey),
+            std::to_string(next_table_id));
+    if (!db->Write(&batch)) {
+        tables.erase(table_name);
+        return absl::InternalError("failed to write table metadata");
+    }
 
     return absl::OkStatus();
 }
 
 absl::Status Catalog::DropTable(const std::string& table_name) {
     auto it = tables.find(table_name);
-    if (it != tables.end()) {
-        tables.erase(it);
+    if (it == tables.end()) {
+        return absl::OkStatus();
+    }
+    const auto& table = it->second;
+    if (table->id < small::schema::kFirstUserTableID) {
+        return absl::InvalidArgumentError("can't drop system table: " +
+                                          table_name);
     }
 
-    db->Delete("TablesCF", table_name);
+    // write to disk, the metadata and the rows in "system.tables" and
+    // "system.partitions" are removed atomically
+    rocksdb::WriteBatch batch;
+    db->Delete(&batch, rocksdb::kDefaultColumnFamilyName,
+               small::rocks::row_key(system_tables->id, table_name));
+    if (auto* listP =
+            std::get_if<small::schema::ListPartition>(&table->partition)) {
+        for (const auto& [p_name, _] : listP->partitions) {
+            db->Delete(&batch, rocksdb::kDefaultColumnFamilyName,
+                       small::rocks::row_key(system_partitions->id, p_name));
+        }
+    }
+    db->Delete(&batch, "TablesCF", table_metadata_key(table->id));
+    if (!db->Write(&batch)) {
+        return absl::InternalError("failed to delete table metadata");
+    }
+
+    // write to in-memory cache
+    parititions.erase(table_name);
+    tables.erase(it);
     return absl::OkStatus();
 }
 
+absl::StatusOr<small::schema::Index> Catalog::CreateIndex(
+    const std::string& index_name, const std::string& table_name,
+    const std::vector<std::string>& column_names,
+    const std::vector<std::string>& include_column_names,
+    small::schema::Index::Method method) {
+    auto table = GetTable(table_name);
+    if (!table.has_value()) {
+        return absl::NotFoundError("Table not found: " + table_name);
+    }
+    for (const auto& [_, other] : tables) {
+        for (const auto& index : other->indexes) {
+            if (index.name == index_name) {
+                return absl::AlreadyExistsError("Index already exists: " +
+                                                index_name);
+            }
+        }
+    }
+
+    if (method == small::schema::Index::Method::Bitmap) {
+        if (column_names.size() != 1 || !include_column_names.empty()) {
+            return absl::InvalidArgumentError(
+                "bitmap index must have a single column and no INCLUDE");
+        }
+        int pk_index = table.value()->get_pk_index();
+        if (pk_index == -1 || table.value()->columns[pk_index].type !=
+                                  small::type::Type::Int64) {
+            return absl::InvalidArgumentError(
+                "bitmap index needs an int64 primary key: " + table_name);
+        }
+    }
+
+    small::schema::Index index;
+    index.name = index_name;
+    index.method = method;
+    for (const auto& name : column_names) {
+        int i = table.value()->get_column_index(name);
+        if (i == -1) {
+            return absl::InvalidArgumentError("Column not found: " + name);
+        }
+        index.column_ids.push_back(table.value()->columns[i].id);
+    }
+    for (const auto& name : include_column_names) {
+        int i = table.value()->get_column_index(name);
+        if (i == -1) {
+            return absl::InvalidArgumentError("Column not found: " + name);
+        }
+        // the primary key is always in the entries
+        if (!index.covers(table.value()->columns[i].id) &&
+            !table.value()->columns[i].is_primary_key) {
+            index.include_column_ids.push_back(table.value()->columns[i].id);
+        }
+    }
+    index.id = next_index_id++;
+
+    // write to disk
+    auto new_table = *table.value();
+    new_table.indexes.push_back(index);
+    rocksdb::WriteBatch batch;
+    db->Put(&batch, "TablesCF", table_metadata_key(new_table.id),
+            nlohmann::json(new_table).dump());
+    db->Put(&batch, "TablesCF", std::string(kNextIndexIDKey),
+            std::to_string(next_index_id));
+    if (!db->Write(&batch)) {
+        return absl::InternalError("failed to write table metadata");
+    }
+
+    // write to in-memory cache
+    table.value()->indexes.push_back(index);
+    return index;
+}
+
 absl::Status Catalog::SetPartition(const std::string& table_name,
                                    const std::string& partition_column,
                                    PgQuery__PartitionStrategy strategy) {
@@ -152,9 +359,7 @@ absl::Status Catalog::SetPartition(const std::string& table_name,
             table.value()->partition = p;
 
             // write to disk
-            WritePartition(table.value());
-
-            return absl::OkStatus();
+            return WritePartition(table.value());
         }
 
         default: {
@@ -166,8 +371,9 @@ absl::Status Catalog::SetPartition(const std::string& table_name,
 
     return absl::OkStatus();
 }
-void Catalog::WritePartition(
+absl::Status Catalog::WritePartition(
     const std::shared_ptr<small::schema::Table>& table) {
+    std::vector<std::vector<small::type::Datum>> rows;
     std::visit(
         [&](auto&& partition) {
             using T = std::decay_t<decltype(partition)>;
@@ -180,7 +386,7 @@ void Catalog::WritePartition(
                     row.emplace_back(nlohmann::json(p.constraints).dump());
                     row.emplace_back(partition.column_name);
                     row.emplace_back(nlohmann::json(p.values).dump());
-                    db->WriteRow(this->system_partitions, row);
+                    rows.push_back(std::move(row));
                 }
             } else {
                 SPDLOG_ERROR("unsupported partition type: {}",
@@ -188,6 +394,11 @@ void Catalog::WritePartition(
             }
         },
         table->partition);
+
+    if (!db->WriteRows(this->system_partitions, rows)) {
+        return absl::InternalError("failed to write partitions");
+    }
+    return absl::OkStatus();
 }
 
 absl::Status Catalog::AddListPartition(const std::string& table_name,
@@ -198,8 +409,7 @@ absl::Status Catalog::AddListPartition(const std::string& table_name,
                 std::get_if<small::schema::ListPartition>(&table->partition)) {
             listP->partitions[partition_name] =
                 small::schema::ListPartition::SinglePartition{values, {}};
-            WritePartition(table);
-            return absl::OkStatus();
+            return WritePartition(table);
         }
     }
     return absl::NotFoundError("table not found");
@@ -215,8 +425,7 @@ absl::Status Catalog::AddPartitionConstraint(
             if (it != listP->partitions.end()) {
                 auto& p = it->second;
                 p.constraints.insert(constraint);
-                WritePartition(table);
-                return absl::OkStatus();
+                return WritePartition(table);
             }
         }
     }
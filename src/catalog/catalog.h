@@ -54,7 +54,20 @@ class Catalog {
     std::unordered_map<std::string, std::shared_ptr<small::schema::partition_t>>
         parititions;
 
-    void WritePartition(const std::shared_ptr<small::schema::Table>& table);
+    // ID of the next user table
+    int64_t next_table_id;
+
+    // ID of the next index
+    int64_t next_index_id;
+
+    // Recover the next IDs from "TablesCF" at startup, so IDs of tables and
+    // indexes created before a restart are never used again.
+    void RecoverNextIDs();
+
+    // Write all partitions of the table to "system.partitions" in a single
+    // batch.
+    absl::Status WritePartition(
+        const std::shared_ptr<small::schema::Table>& table);
 
    public:
     // singleton instance - assignment-blocker
@@ -69,11 +82,32 @@ class Catalog {
     // singleton instance - init api
     static void InitInstance();
 
-    absl::Status CreateTable(const std::string& table_name,
-                             const std::vector<small::schema::Column>& columns);
-
+    // Create a table, "families" maps the name of each column family to the
+    // names of its columns. Columns of no family, including the primary key,
+    // are in the primary family.
+    absl::Status CreateTable(
+        const std::string& table_name,
+        const std::vector<small::schema::Column>& columns,
+        const std::vector<std::pair<std::string, std::vector<std::string>>>&
+            families = {});
+
+    // Remove the table from the catalog, its rows are left to the caller. A
+    // missing table is ignored.
     absl::Status DropTable(const std::string& table_name);
 
+    // Add an index to the table. Entries of rows written after it are
+    // maintained by the write path, the caller must backfill the existing
+    // rows.
+    //
+    // A bitmap index has a single key column, no included columns and needs
+    // an int64 primary key (the row ID).
+    absl::StatusOr<small::schema::Index> CreateIndex(
+        const std::string& index_name, const std::string& table_name,
+        const std::vector<std::string>& column_names,
+        const std::vector<std::string>& include_column_names,
+        small::schema::Index::Method method =
+            small::schema::Index::Method::BTree);
+
     std::optional<std::shared_ptr<small::schema::Table>> GetTable(
         const std::string& table_name);
 
@@ -0,0 +1,160 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <system_error>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+#include "arrow/io/file.h"
+#include "arrow/ipc/reader.h"
+#include "arrow/ipc/writer.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/columnar/ipc.h"
+
+namespace small::columnar {
+
+absl::StatusOr<std::shared_ptr<arrow::Table>> read_ipc_file(
+    const std::string& path) {
+    auto file =
+        arrow::io::MemoryMappedFile::Open(path, arrow::io::FileMode::READ);
+    if (!file.ok()) {
+        return absl::InternalError("failed to map file: " +
+                                   file.status().ToString());
+    }
+
+    auto reader = arrow::ipc::RecordBatchFileReader::Open(file.ValueOrDie());
+    if (!reader.ok()) {
+        return absl::InternalError("failed to open ipc file: " +
+                                   reader.status().ToString());
+    }
+
+    // batches read from a memory-mapped file point into the mapping, nothing
+    // is copied
+    arrow::RecordBatchVector batches;
+    for (int i = 0; i < reader.ValueOrDie()->num_record_batches(); i++) {
+        auto batch = reader.ValueOrDie()->ReadRecordBatch(i);
+        if (!batch.ok()) {
+            return absl::InternalError("failed to read ipc file: " +
+                                       batch.status().ToString());
+        }
+        batches.push_back(batch.ValueOrDie());
+    }
+
+    auto table = arrow::Table::FromRecordBatches(
+        reader.ValueOrDie()->schema(), batches);
+    if (!table.ok()) {
+        return absl::InternalError("invalid ipc file: " +
+                                   table.status().ToString());
+    }
+    return table.ValueOrDie();
+}
+
+absl::Status write_ipc_file(const std::string& path, const arrow::Table& table,
+                            int64_t batch_rows) {
+    auto writer = IpcFileWriter::Open(path, table.schema());
+    if (!writer.ok()) {
+        return writer.status();
+    }
+    auto status = writer.value()->Write(table, batch_rows);
+    if (!status.ok()) {
+        return status;
+    }
+    return writer.value()->Finish();
+}
+
+absl::StatusOr<std::unique_ptr<IpcFileWriter>> IpcFileWriter::Open(
+    const std::string& path, const std::shared_ptr<arrow::Schema>& schema) {
+    std::unique_ptr<IpcFileWriter> writer(new IpcFileWriter());
+    writer->path_ = path;
+
+    // write to a temporary file first, a crash never leaves a partial file
+    writer->tmp_path_ = path + ".tmp";
+
+    auto stream = arrow::io::FileOutputStream::Open(writer->tmp_path_);
+    if (!stream.ok()) {
+        return absl::InternalError("failed to create ipc file: " +
+                                   stream.status().ToString());
+    }
+    writer->stream_ = stream.ValueOrDie();
+
+    auto ipc_writer = arrow::ipc::MakeFileWriter(writer->stream_, schema);
+    if (!ipc_writer.ok()) {
+        return absl::InternalError("failed to create ipc writer: " +
+                                   ipc_writer.status().ToString());
+    }
+    writer->writer_ = ipc_writer.ValueOrDie();
+    return writer;
+}
+
+IpcFileWriter::~IpcFileWriter() {
+    if (finished_) {
+        return;
+    }
+    if (writer_) {
+        auto _ = writer_->Close();
+    }
+    if (stream_) {
+        auto _ = stream_->Close();
+    }
+    std::error_code ec;
+    std::filesystem::remove(tmp_path_, ec);
+}
+
+absl::Status IpcFileWriter::Write(const arrow::Table& table,
+                                  int64_t batch_rows) {
+    auto status = writer_->WriteTable(table, batch_rows);
+    if (!status.ok()) {
+        return absl::InternalError("failed to write ipc file: " +
+                                   status.ToString());
+    }
+    return absl::OkStatus();
+}
+
+absl::Status IpcFileWriter::Finish() {
+    arrow::Status status = writer_->Close();
+    if (status.ok()) {
+        status = stream_->Close();
+    }
+    if (!status.ok()) {
+        return absl::InternalError("failed to write ipc file: " +
+                                   status.ToString());
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp_path_, path_, ec);
+    if (ec) {
+        return absl::InternalError("failed to rename ipc file: " +
+                                   ec.message());
+    }
+    finished_ = true;
+    return absl::OkStatus();
+}
+
+}  // namespace small::columnar
@@ -0,0 +1,77 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+#include "arrow/io/file.h"
+#include "arrow/ipc/writer.h"
+
+namespace small::columnar {
+
+// Read an Arrow IPC file by memory-mapping it, the arrays of the table point
+// into the mapping and nothing is copied. The mapping lives as long as any of
+// the arrays.
+absl::StatusOr<std::shared_ptr<arrow::Table>> read_ipc_file(
+    const std::string& path);
+
+// Write the table as an Arrow IPC file of record batches with at most
+// "batch_rows" rows. The file is replaced atomically.
+absl::Status write_ipc_file(const std::string& path, const arrow::Table& table,
+                            int64_t batch_rows);
+
+// Write an Arrow IPC file a part at a time, so the whole table is never in
+// memory. The file is written under a temporary name and replaces "path"
+// atomically in "Finish", it's removed if the writer is destroyed before.
+class IpcFileWriter {
+   public:
+    static absl::StatusOr<std::unique_ptr<IpcFileWriter>> Open(
+        const std::string& path, const std::shared_ptr<arrow::Schema>& schema);
+
+    ~IpcFileWriter();
+
+    // Append the rows of the table as record batches with at most
+    // "batch_rows" rows.
+    absl::Status Write(const arrow::Table& table, int64_t batch_rows);
+
+    absl::Status Finish();
+
+   private:
+    IpcFileWriter() = default;
+
+    std::string path_;
+    std::string tmp_path_;
+    std::shared_ptr<arrow::io::FileOutputStream> stream_;
+    std::shared_ptr<arrow::ipc::RecordBatchWriter> writer_;
+    bool finished_ = false;
+};
+
+}  // namespace small::columnar
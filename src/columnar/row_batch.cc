@@ -0,0 +1,184 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/encode/encode.h"
+#include "src/schema/schema.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/columnar/row_batch.h"
+
+namespace small::columnar {
+
+std::shared_ptr<arrow::Schema> get_arrow_schema(
+    const small::schema::Table& table) {
+    arrow::FieldVector fields;
+    for (const auto& column : table.columns) {
+        fields.push_back(arrow::field(
+            column.name, small::type::get_gandiva_type(column.type)));
+    }
+    return arrow::schema(fields);
+}
+
+RowBatchBuilder::RowBatchBuilder(const small::schema::Table& table,
+                                 const std::vector<int>& columns)
+    : schema_(get_arrow_schema(table)) {
+    std::vector<bool> decoded(table.columns.size(), columns.empty());
+    for (int column : columns) {
+        decoded[column] = true;
+    }
+
+    for (int i = 0; i < table.columns.size(); i++) {
+        const auto& column = table.columns[i];
+        types_.push_back(column.type);
+        if (!decoded[i]) {
+            builders_.push_back(nullptr);
+            continue;
+        }
+        switch (column.type) {
+            case small::type::Type::Int64:
+                builders_.push_back(std::make_unique<arrow::Int64Builder>());
+                break;
+            case small::type::Type::String:
+                builders_.push_back(std::make_unique<arrow::StringBuilder>());
+                break;
+            default:
+                throw std::invalid_argument(
+                    "unsupported type: " +
+                    small::type::to_string(column.type));
+        }
+
+        if (column.id >= builder_index_.size()) {
+            builder_index_.resize(column.id + 1, -1);
+        }
+        builder_index_[column.id] = i;
+    }
+}
+
+absl::Status RowBatchBuilder::Append(std::string_view row) {
+    num_rows_++;
+
+    try {
+        small::encode::RowReader reader(row);
+        int64_t column_id;
+        std::string_view cell;
+        while (reader.Next(&column_id, &cell)) {
+            if (column_id >= builder_index_.size() ||
+                builder_index_[column_id] == -1) {
+                // the column is not in the schema, skip it
+                continue;
+            }
+
+            int index = builder_index_[column_id];
+            arrow::Status status;
+            switch (types_[index]) {
+                case small::type::Type::Int64: {
+                    int64_t int_value;
+                    if (!small::encode::decode_int64(cell, &int_value)) {
+                        return absl::InternalError(
+                            "invalid int64 value in row");
+                    }
+                    status = static_cast<arrow::Int64Builder*>(
+                                 builders_[index].get())
+                                 ->Append(int_value);
+                    break;
+                }
+                case small::type::Type::String:
+                    status = static_cast<arrow::StringBuilder*>(
+                                 builders_[index].get())
+                                 ->Append(cell);
+                    break;
+                default:
+                    return absl::InvalidArgumentError(
+                        "unsupported type of column: " +
+                        std::to_string(column_id));
+            }
+            if (!status.ok()) {
+                SPDLOG_ERROR("failed to append value: {}", status.ToString());
+                return absl::InternalError("failed to append value");
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        return absl::InternalError(std::string("corrupted row: ") + e.what());
+    }
+
+    for (auto& builder : builders_) {
+        if (builder != nullptr && builder->length() < num_rows_) {
+            auto status = builder->AppendNull();
+            if (!status.ok()) {
+                SPDLOG_ERROR("failed to append null: {}", status.ToString());
+                return absl::InternalError("failed to append null");
+            }
+        }
+    }
+
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> RowBatchBuilder::Finish() {
+    arrow::ArrayVector columns;
+    for (int i = 0; i < builders_.size(); i++) {
+        const auto& builder = builders_[i];
+        if (builder == nullptr) {
+            auto nulls = arrow::MakeArrayOfNull(schema_->field(i)->type(),
+                                                num_rows_);
+            if (!nulls.ok()) {
+                return absl::InternalError("failed to make null array: " +
+                                           nulls.status().ToString());
+            }
+            columns.push_back(nulls.ValueOrDie());
+            continue;
+        }
+
+        auto result = builder->Finish();
+        if (!result.ok()) {
+            return absl::InternalError("failed to finish builder: " +
+                                       result.status().ToString());
+        }
+        columns.push_back(result.ValueOrDie());
+    }
+
+    auto batch = arrow::RecordBatch::Make(schema_, num_rows_, columns);
+    num_rows_ = 0;
+    return batch;
+}
+
+}  // namespace small::columnar
@@ -0,0 +1,84 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/schema/schema.h"
+
+namespace small::columnar {
+
+// Arrow schema of all columns of the table, in the order of the columns.
+std::shared_ptr<arrow::Schema> get_arrow_schema(
+    const small::schema::Table& table);
+
+// Decode packed rows (see "small::encode::encode_row") into Arrow arrays, one
+// array per column of the table.
+class RowBatchBuilder {
+   public:
+    // Only the "columns" (indexes of the columns in the table, empty means
+    // all) are decoded, the arrays of the other columns are all NULL.
+    explicit RowBatchBuilder(const small::schema::Table& table,
+                             const std::vector<int>& columns = {});
+
+    // Append a packed row, columns missing in the row are appended as NULL and
+    // columns not in the table are skipped.
+    absl::Status Append(std::string_view row);
+
+    int64_t num_rows() const { return num_rows_; }
+
+    const std::shared_ptr<arrow::Schema>& schema() const { return schema_; }
+
+    // Build a batch of the rows appended so far, the builder is reset and can
+    // be reused.
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Finish();
+
+   private:
+    std::shared_ptr<arrow::Schema> schema_;
+    std::vector<small::type::Type> types_;
+
+    // nullptr for the columns not decoded
+    std::vector<std::unique_ptr<arrow::ArrayBuilder>> builders_;
+
+    // column ID -> index of the column (and its builder), -1 if the column is
+    // not in the table or not decoded
+    std::vector<int> builder_index_;
+
+    int64_t num_rows_ = 0;
+};
+
+}  // namespace small::columnar
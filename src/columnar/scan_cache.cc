@@ -0,0 +1,227 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <system_error>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+#include "arrow/util/byte_size.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/columnar/ipc.h"
+#include "src/rocks/config.h"
+#include "src/server_info/info.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/columnar/scan_cache.h"
+
+namespace small::columnar {
+
+ScanCache* ScanCache::instancePtr = nullptr;
+
+void ScanCache::InitInstance() {
+    if (instancePtr == nullptr) {
+        instancePtr = new ScanCache();
+    } else {
+        SPDLOG_ERROR("scan cache instance already initialized");
+    }
+}
+
+ScanCache* ScanCache::GetInstance() {
+    if (instancePtr == nullptr) {
+        SPDLOG_ERROR("scan cache instance not initialized");
+        return nullptr;
+    }
+    return instancePtr;
+}
+
+ScanCache::ScanCache()
+    : capacity(small::rocks::get_storage_config().scan_cache_size) {
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        SPDLOG_ERROR("failed to get server info");
+        capacity = 0;
+        return;
+    }
+    this->dir =
+        (std::filesystem::path(info.value()->db_path) / "scan_cache").string();
+
+    // versions restart from 0 with the process, files of the previous run are
+    // useless
+    std::error_code ec;
+    std::filesystem::remove_all(this->dir, ec);
+    std::filesystem::create_directories(this->dir, ec);
+    if (ec) {
+        SPDLOG_ERROR("failed to create scan cache dir: {}, error: {}",
+                     this->dir, ec.message());
+        capacity = 0;
+    }
+}
+
+void ScanCache::Drop(Entry* entry) {
+    if (entry->batch == nullptr) {
+        return;
+    }
+
+    // scans still reading the batch keep the mapping alive
+    std::error_code ec;
+    std::filesystem::remove(entry->path, ec);
+
+    total_bytes -= entry->bytes;
+    entry->batch = nullptr;
+    entry->path.clear();
+    entry->bytes = 0;
+}
+
+std::shared_ptr<arrow::RecordBatch> ScanCache::Get(int64_t table_id,
+                                                   uint64_t version) {
+    std::lock_guard lock(mutex);
+    auto it = entries.find(table_id);
+    if (it == entries.end() || it->second.version != version ||
+        it->second.batch == nullptr) {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    it->second.last_used = ++clock;
+    return it->second.batch;
+}
+
+void ScanCache::Put(int64_t table_id, uint64_t version,
+                    const std::shared_ptr<arrow::RecordBatch>& batch) {
+    int64_t bytes = arrow::util::TotalBufferSize(*batch);
+    if (capacity == 0 || bytes > capacity) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        auto [it, inserted] = entries.try_emplace(table_id);
+        auto& entry = it->second;
+        if (inserted || entry.version != version) {
+            // the first scan of the version
+            Drop(&entry);
+            entry.version = version;
+            entry.last_used = ++clock;
+            return;
+        }
+        if (entry.batch != nullptr) {
+            return;
+        }
+    }
+
+    // write the file without holding the lock
+    auto path = (std::filesystem::path(dir) /
+                 (std::to_string(table_id) + "-" + std::to_string(version) +
+                  ".arrow"))
+                    .string();
+    auto table = arrow::Table::FromRecordBatches({batch});
+    if (!table.ok()) {
+        SPDLOG_ERROR("failed to cache table {}: {}", table_id,
+                     table.status().ToString());
+        return;
+    }
+    auto status = write_ipc_file(path, *table.ValueOrDie(),
+                                 std::max<int64_t>(batch->num_rows(), 1));
+    if (!status.ok()) {
+        SPDLOG_ERROR("failed to cache table {}: {}", table_id,
+                     status.ToString());
+        return;
+    }
+    auto mapped = read_ipc_file(path);
+    if (!mapped.ok()) {
+        SPDLOG_ERROR("failed to cache table {}: {}", table_id,
+                     mapped.status().ToString());
+        return;
+    }
+    auto mapped_batch = mapped.value()->CombineChunksToBatch();
+    if (!mapped_batch.ok()) {
+        SPDLOG_ERROR("failed to cache table {}: {}", table_id,
+                     mapped_batch.status().ToString());
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+    auto& entry = entries[table_id];
+    if (entry.version != version || entry.batch != nullptr) {
+        // raced with a write or another scan
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        return;
+    }
+
+    // evict the least recently used tables
+    while (total_bytes + bytes > capacity) {
+        Entry* victim = nullptr;
+        for (auto& [_, other] : entries) {
+            if (other.batch != nullptr &&
+                (victim == nullptr || other.last_used < victim->last_used)) {
+                victim = &other;
+            }
+        }
+        if (victim == nullptr) {
+            break;
+        }
+        Drop(victim);
+    }
+
+    entry.batch = mapped_batch.ValueOrDie();
+    entry.path = path;
+    entry.bytes = bytes;
+    entry.last_used = ++clock;
+    total_bytes += bytes;
+    SPDLOG_INFO("cached scan of table {}, version: {}, bytes: {}", table_id,
+                version, bytes);
+}
+
+void ScanCache::Remove(int64_t table_id) {
+    std::lock_guard lock(mutex);
+    auto it = entries.find(table_id);
+    if (it == entries.end()) {
+        return;
+    }
+    Drop(&it->second);
+    entries.erase(it);
+}
+
+int64_t ScanCache::bytes() {
+    std::lock_guard lock(mutex);
+    return total_bytes;
+}
+
+}  // namespace small::columnar
@@ -0,0 +1,116 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+
+namespace small::columnar {
+
+// Cache of table scans for tables read often and written rarely (e.g.
+// "system.tables"). The batch of a scan is written to an Arrow IPC file under
+// "<db_path>/scan_cache" and memory-mapped, later scans of the same table
+// version are served from the mapping without touching rocksdb.
+//
+// A table is cached after it is scanned twice at the same version (see
+// "small::rocks::RocksDBWrapper::GetTableVersion"), so tables written between
+// scans never pay for the file. The least recently used tables are evicted
+// when the cache exceeds "scan_cache_size" of the storage config.
+class ScanCache {
+   private:
+    // singleton instance - the only instance
+    static ScanCache* instancePtr;
+
+    // singleton instance - constructor protector
+    ScanCache();
+
+    // singleton instance - destructor protector
+    ~ScanCache() = default;
+
+    class Entry {
+       public:
+        // the latest version scanned
+        uint64_t version = 0;
+
+        // batch of "version", nullptr if the version is scanned only once
+        std::shared_ptr<arrow::RecordBatch> batch;
+        std::string path;
+        int64_t bytes = 0;
+
+        uint64_t last_used = 0;
+    };
+
+    std::string dir;
+    int64_t capacity;
+
+    std::mutex mutex;
+    std::unordered_map<int64_t, Entry> entries;
+    int64_t total_bytes = 0;
+    uint64_t clock = 0;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+    // Drop the cached batch of the entry, the caller must hold "mutex".
+    void Drop(Entry* entry);
+
+   public:
+    // singleton instance - assignment-blocker
+    void operator=(const ScanCache&) = delete;
+
+    // singleton instance - copy-blocker
+    ScanCache(const ScanCache&) = delete;
+
+    // singleton instance - get api
+    static ScanCache* GetInstance();
+
+    // singleton instance - init api
+    static void InitInstance();
+
+    // Return the cached batch of the table at "version", or nullptr.
+    std::shared_ptr<arrow::RecordBatch> Get(int64_t table_id,
+                                            uint64_t version);
+
+    // Offer the batch of a table scanned at "version" to the cache.
+    void Put(int64_t table_id, uint64_t version,
+             const std::shared_ptr<arrow::RecordBatch>& batch);
+
+    // Forget the table, e.g. after its rows are deleted.
+    void Remove(int64_t table_id);
+
+    uint64_t num_hits() const { return hits; }
+
+    uint64_t num_misses() const { return misses; }
+
+    // Bytes of the cached batches.
+    int64_t bytes();
+};
+
+}  // namespace small::columnar
@@ -0,0 +1,706 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <algorithm>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+#include "arrow/compute/api_vector.h"
+
+// json
+#include "nlohmann/json.hpp"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/columnar/ipc.h"
+#include "src/columnar/row_batch.h"
+#include "src/encode/encode.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+#include "src/server_info/info.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/columnar/segment.h"
+
+namespace small::columnar {
+
+SegmentStore* SegmentStore::instancePtr = nullptr;
+
+namespace {
+
+std::string manifest_key(int64_t table_id) {
+    return "S:" + std::to_string(table_id);
+}
+
+// Return the take indices merging "delta" into "base", an index less than the
+// length of "base" points to a row of "base", otherwise to a row of "delta"
+// (after the rows of "base"). Set "in_order" if the indices are 0, 1, 2, ...,
+// i.e. "delta" can be appended to "base" as is.
+template <typename ArrayType>
+std::shared_ptr<arrow::Int64Array> merge_indices(
+    const arrow::ChunkedArray& base, const ArrayType& delta, bool* in_order) {
+    const int64_t base_rows = base.length();
+    const int64_t delta_rows = delta.length();
+
+    arrow::Int64Builder builder;
+    auto _ = builder.Reserve(base_rows + delta_rows);
+
+    *in_order = true;
+    int64_t base_index = 0;
+    int64_t d = 0;
+    for (const auto& chunk : base.chunks()) {
+        const auto& array = static_cast<const ArrayType&>(*chunk);
+        for (int64_t i = 0; i < array.length(); i++, base_index++) {
+            auto pk = array.GetView(i);
+            while (d < delta_rows && delta.GetView(d) < pk) {
+                builder.UnsafeAppend(base_rows + d);
+                d++;
+                *in_order = false;
+            }
+            if (d < delta_rows && delta.GetView(d) == pk) {
+                // the row is updated in the delta
+                builder.UnsafeAppend(base_rows + d);
+                d++;
+                *in_order = false;
+            } else {
+                builder.UnsafeAppend(base_index);
+            }
+        }
+    }
+    for (; d < delta_rows; d++) {
+        builder.UnsafeAppend(base_rows + d);
+    }
+
+    std::shared_ptr<arrow::Int64Array> indices;
+    _ = builder.Finish(&indices);
+    return indices;
+}
+
+// Binary search "pk" in the sorted chunk, return its offset or -1.
+template <typename ArrayType, typename ValueType>
+int64_t find_in_chunk(const ArrayType& array, const ValueType& pk) {
+    int64_t low = 0;
+    int64_t high = array.length();
+    while (low < high) {
+        int64_t mid = low + (high - low) / 2;
+        if (array.GetView(mid) < pk) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < array.length() && array.GetView(low) == pk) {
+        return low;
+    }
+    return -1;
+}
+
+// Find the primary key in the sorted chunks, return (chunk, offset) or
+// (-1, -1) if not found.
+std::pair<int, int64_t> find_pk(const arrow::ChunkedArray& pk_column,
+                                const small::type::Datum& pk) {
+    for (int c = 0; c < pk_column.num_chunks(); c++) {
+        const auto& chunk = *pk_column.chunk(c);
+        if (chunk.length() == 0) {
+            continue;
+        }
+
+        int64_t offset = -1;
+        if (std::holds_alternative<int64_t>(pk)) {
+            const auto& array = static_cast<const arrow::Int64Array&>(chunk);
+            // skip chunks before the key
+            if (array.GetView(array.length() - 1) < std::get<int64_t>(pk)) {
+                continue;
+            }
+            offset = find_in_chunk(array, std::get<int64_t>(pk));
+        } else {
+            const auto& array = static_cast<const arrow::StringArray&>(chunk);
+            std::string_view key = std::get<std::string>(pk);
+            if (array.GetView(array.length() - 1) < key) {
+                continue;
+            }
+            offset = find_in_chunk(array, key);
+        }
+
+        // chunks after this one only have greater keys
+        if (offset == -1) {
+            return {-1, -1};
+        }
+        return {c, offset};
+    }
+    return {-1, -1};
+}
+
+// Return the row key (see "small::rocks::row_key") of row "i" of the primary
+// key column.
+std::string pk_row_key(int64_t table_id, const arrow::Array& pk, int64_t i) {
+    if (pk.type_id() == arrow::Type::INT64) {
+        return small::rocks::row_key(
+            table_id, static_cast<const arrow::Int64Array&>(pk).Value(i));
+    }
+    return small::rocks::row_key(
+        table_id, static_cast<const arrow::StringArray&>(pk).GetString(i));
+}
+
+// Number of rows of the batch, sorted by the primary key, whose row key is not
+// greater than "key".
+int64_t rows_up_to(int64_t table_id, const arrow::RecordBatch& batch,
+                   int pk_index, const std::string& key) {
+    const auto& pk = *batch.column(pk_index);
+    int64_t low = 0;
+    int64_t high = batch.num_rows();
+    while (low < high) {
+        int64_t mid = low + (high - low) / 2;
+        if (pk_row_key(table_id, pk, mid) <= key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+}  // namespace
+
+Segment::Segment(const std::string& path, uint64_t sequence,
+                 const std::shared_ptr<arrow::Table>& data)
+    : path(path), sequence(sequence), data(data) {}
+
+Segment::~Segment() {
+    if (obsolete) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        if (ec) {
+            SPDLOG_ERROR("failed to remove segment file: {}, error: {}", path,
+                         ec.message());
+        }
+    }
+}
+
+absl::StatusOr<std::shared_ptr<arrow::Table>> merge_by_pk(
+    const std::shared_ptr<arrow::Table>& base,
+    const std::shared_ptr<arrow::RecordBatch>& delta, int pk_index) {
+    auto delta_table = arrow::Table::FromRecordBatches({delta});
+    if (!delta_table.ok()) {
+        return absl::InternalError("invalid delta: " +
+                                   delta_table.status().ToString());
+    }
+    if (base == nullptr) {
+        return delta_table.ValueOrDie();
+    }
+    if (delta->num_rows() == 0) {
+        return base;
+    }
+
+    bool in_order;
+    std::shared_ptr<arrow::Int64Array> indices;
+    const auto& base_pk = *base->column(pk_index);
+    const auto& delta_pk = *delta->column(pk_index);
+    switch (delta_pk.type_id()) {
+        case arrow::Type::INT64:
+            indices = merge_indices(
+                base_pk, static_cast<const arrow::Int64Array&>(delta_pk),
+                &in_order);
+            break;
+        case arrow::Type::STRING:
+            indices = merge_indices(
+                base_pk, static_cast<const arrow::StringArray&>(delta_pk),
+                &in_order);
+            break;
+        default:
+            return absl::InvalidArgumentError(
+                "unsupported primary key type: " +
+                delta_pk.type()->ToString());
+    }
+
+    auto combined = arrow::ConcatenateTables({base, delta_table.ValueOrDie()});
+    if (!combined.ok()) {
+        return absl::InternalError("failed to concatenate tables: " +
+                                   combined.status().ToString());
+    }
+    if (in_order) {
+        // every row of the delta is after the segment (e.g. an increasing
+        // primary key), no need to copy anything
+        return combined.ValueOrDie();
+    }
+
+    auto merged = arrow::compute::Take(combined.ValueOrDie(), indices);
+    if (!merged.ok()) {
+        return absl::InternalError("failed to merge tables: " +
+                                   merged.status().ToString());
+    }
+    return merged.ValueOrDie().table();
+}
+
+void SegmentStore::InitInstance() {
+    if (instancePtr == nullptr) {
+        instancePtr = new SegmentStore();
+    } else {
+        SPDLOG_ERROR("segment store instance already initialized");
+    }
+}
+
+SegmentStore* SegmentStore::GetInstance() {
+    if (instancePtr == nullptr) {
+        SPDLOG_ERROR("segment store instance not initialized");
+        return nullptr;
+    }
+    return instancePtr;
+}
+
+SegmentStore::SegmentStore() {
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        SPDLOG_ERROR("failed to get server info");
+        return;
+    }
+    std::string db_path = info.value()->db_path;
+    this->db = small::rocks::RocksDBWrapper::GetInstance(db_path, {});
+    this->dir = (std::filesystem::path(db_path) / "segments").string();
+    bool _ = std::filesystem::create_directories(this->dir);
+
+    Load();
+
+    // writes must find rows moved into segments to maintain index entries
+    this->db->SetColdRowReader(
+        [this](const small::schema::Table& table,
+               const small::type::Datum& pk,
+               std::string* row) { return GetRow(table, pk, row); });
+
+    std::thread([this]() { Run(); }).detach();
+}
+
+void SegmentStore::Load() {
+    std::unordered_set<std::string> paths;
+    for (const auto& [key, value] : db->GetAllKV("TablesCF")) {
+        if (key.rfind("S:", 0) != 0) {
+            continue;
+        }
+
+        int64_t table_id = std::stoll(key.substr(2));
+        auto manifest = nlohmann::json::parse(value);
+        auto path = manifest["path"].get<std::string>();
+        auto data = read_ipc_file(path);
+        if (!data.ok()) {
+            SPDLOG_ERROR("failed to load segment, table id: {}, error: {}",
+                         table_id, data.status().ToString());
+            continue;
+        }
+
+        segments[table_id].push_back(std::make_shared<Segment>(
+            path, manifest["sequence"].get<uint64_t>(), data.value()));
+        paths.insert(path);
+    }
+
+    // files of a compaction interrupted by a crash
+    for (const auto& entry : std::filesystem::directory_iterator(dir)) {
+        if (paths.count(entry.path().string()) == 0) {
+            std::error_code ec;
+            std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+    SPDLOG_INFO("loaded {} segments from {}", segments.size(), dir);
+}
+
+std::shared_ptr<Segment> SegmentStore::GetSegment(int64_t table_id) {
+    std::lock_guard lock(mutex);
+    auto it = segments.find(table_id);
+    if (it == segments.end() || it->second.empty()) {
+        return nullptr;
+    }
+    return it->second.back();
+}
+
+std::shared_ptr<Segment> SegmentStore::GetSegment(int64_t table_id,
+                                                  uint64_t sequence) {
+    std::lock_guard lock(mutex);
+    auto it = segments.find(table_id);
+    if (it == segments.end()) {
+        return nullptr;
+    }
+
+    Prune(&it->second);
+    for (auto segment = it->second.rbegin(); segment != it->second.rend();
+         ++segment) {
+        if ((*segment)->sequence <= sequence) {
+            return *segment;
+        }
+    }
+    return nullptr;
+}
+
+void SegmentStore::Prune(std::vector<std::shared_ptr<Segment>>* generations) {
+    uint64_t oldest = db->GetOldestSnapshotSequence();
+    size_t first = 0;
+    while (first + 1 < generations->size() &&
+           (*generations)[first + 1]->sequence <= oldest) {
+        first++;
+    }
+    generations->erase(generations->begin(), generations->begin() + first);
+}
+
+bool SegmentStore::GetRow(const small::schema::Table& table,
+                          const small::type::Datum& pk, std::string* row) {
+    return GetRow(table, pk, std::numeric_limits<uint64_t>::max(), row);
+}
+
+bool SegmentStore::GetRow(const small::schema::Table& table,
+                          const small::type::Datum& pk, uint64_t sequence,
+                          std::string* row) {
+    auto segment = GetSegment(table.id, sequence);
+    if (!segment) {
+        return false;
+    }
+
+    auto [chunk, offset] =
+        find_pk(*segment->data->column(table.get_pk_index()), pk);
+    if (chunk == -1) {
+        return false;
+    }
+
+    std::vector<int64_t> column_ids;
+    std::vector<std::string> columns;
+    for (int i = 0; i < table.columns.size(); i++) {
+        const auto& array = *segment->data->column(i)->chunk(chunk);
+        if (array.IsNull(offset)) {
+            continue;
+        }
+        column_ids.push_back(table.columns[i].id);
+        switch (array.type_id()) {
+            case arrow::Type::INT64:
+                columns.push_back(small::encode::encode_value(
+                    static_cast<const arrow::Int64Array&>(array).Value(
+                        offset)));
+                break;
+            default:
+                columns.push_back(
+                    static_cast<const arrow::StringArray&>(array).GetString(
+                        offset));
+                break;
+        }
+    }
+    *row = small::encode::encode_row(column_ids, columns);
+    return true;
+}
+
+absl::Status SegmentStore::Compact(
+    const std::shared_ptr<small::schema::Table>& table) {
+    int pk_index = table->get_pk_index();
+    if (pk_index == -1) {
+        return absl::InvalidArgumentError("primary key not found: " +
+                                          table->name);
+    }
+
+    // read the delta from a snapshot, the base segment must be got after it
+    // (see "GetSegment")
+    small::rocks::ScanOptions scan_options;
+    scan_options.snapshot = db->GetSnapshot();
+    // the delta is read once, keep it out of the block cache
+    scan_options.large = true;
+    auto base = GetSegment(table->id);
+
+    // rows still in a memtable are hot, they stay in rocksdb until a later
+    // compaction finds them flushed
+    std::unordered_set<std::string> recent;
+    try {
+        recent = db->GetRecentRowKeys(*table);
+    } catch (const std::runtime_error& e) {
+        return absl::InternalError(std::string("scan failed: ") + e.what());
+    }
+
+    uint64_t sequence = scan_options.snapshot->GetSequenceNumber();
+    auto path = (std::filesystem::path(dir) /
+                 (std::to_string(table->id) + "-" + std::to_string(sequence) +
+                  ".arrow"))
+                    .string();
+    RowBatchBuilder builder(*table);
+    auto writer = IpcFileWriter::Open(path, builder.schema());
+    if (!writer.ok()) {
+        return writer.status();
+    }
+
+    // The base is merged with the delta a window at a time: a batch of the
+    // base and the delta rows up to its last primary key, at most
+    // "kSegmentBatchRows" of them. Only the keys of the moved rows are kept
+    // for "DeleteIfUnchanged".
+    std::unique_ptr<arrow::TableBatchReader> base_reader;
+    if (base) {
+        base_reader = std::make_unique<arrow::TableBatchReader>(base->data);
+        base_reader->set_chunksize(kSegmentBatchRows);
+    }
+    std::shared_ptr<arrow::RecordBatch> base_rows;
+    std::vector<std::string> moved;
+    std::string start;
+    bool delta_done = false;
+    while (true) {
+        if (base_rows && base_rows->num_rows() == 0) {
+            base_rows.reset();
+        }
+        while (!base_rows && base_reader) {
+            auto read = base_reader->ReadNext(&base_rows);
+            if (!read.ok()) {
+                return absl::InternalError("failed to read segment: " +
+                                           read.ToString());
+            }
+            if (!base_rows) {
+                base_reader.reset();
+            } else if (base_rows->num_rows() == 0) {
+                base_rows.reset();
+            }
+        }
+        if (!base_rows && delta_done) {
+            break;
+        }
+
+        // the delta rows up to the last key of the window, all of them after
+        // the base
+        std::string bound;
+        if (base_rows) {
+            bound = pk_row_key(table->id, *base_rows->column(pk_index),
+                               base_rows->num_rows() - 1);
+        }
+        int64_t visited = 0;
+        bool at_bound = false;
+        std::string last_key;
+        absl::Status status = absl::OkStatus();
+        if (!delta_done) {
+            try {
+                db->ScanRows(
+                    *table,
+                    [&](std::string_view key, std::string_view row) {
+                        if (!bound.empty() && key > bound) {
+                            start.assign(key);
+                            at_bound = true;
+                            return false;
+                        }
+                        last_key.assign(key);
+                        if (recent.count(last_key) == 0) {
+                            moved.push_back(last_key);
+                            status = builder.Append(row);
+                        }
+                        return status.ok() && ++visited < kSegmentBatchRows;
+                    },
+                    scan_options, start);
+            } catch (const std::runtime_error& e) {
+                return absl::InternalError(std::string("scan failed: ") +
+                                           e.what());
+            }
+            if (!status.ok()) {
+                return status;
+            }
+            if (!at_bound) {
+                bool limited = visited == kSegmentBatchRows &&
+                               !small::rocks::prefix_successor(last_key)
+                                    .empty();
+                start = limited ? small::rocks::prefix_successor(last_key)
+                                : std::string();
+                delta_done = !limited;
+            }
+        }
+
+        // if the delta has more rows before the bound, only the base rows up
+        // to the last one visited are merged now
+        bool limited = !at_bound && !delta_done;
+        std::shared_ptr<arrow::RecordBatch> window;
+        if (base_rows) {
+            int64_t num_rows =
+                limited ? rows_up_to(table->id, *base_rows, pk_index, last_key)
+                        : base_rows->num_rows();
+            window = base_rows->Slice(0, num_rows);
+            base_rows = base_rows->Slice(num_rows);
+        }
+        auto delta = builder.Finish();
+        if (!delta.ok()) {
+            return delta.status();
+        }
+
+        std::shared_ptr<arrow::Table> merged;
+        if (window && window->num_rows() > 0) {
+            auto window_table = arrow::Table::FromRecordBatches({window});
+            if (!window_table.ok()) {
+                return absl::InternalError("invalid segment: " +
+                                           window_table.status().ToString());
+            }
+            auto result = merge_by_pk(window_table.ValueOrDie(), delta.value(),
+                                      pk_index);
+            if (!result.ok()) {
+                return result.status();
+            }
+            merged = result.value();
+        } else if (delta.value()->num_rows() > 0) {
+            auto result = arrow::Table::FromRecordBatches({delta.value()});
+            if (!result.ok()) {
+                return absl::InternalError("invalid delta: " +
+                                           result.status().ToString());
+            }
+            merged = result.ValueOrDie();
+        }
+        if (merged) {
+            status = writer.value()->Write(*merged, kSegmentBatchRows);
+            if (!status.ok()) {
+                return status;
+            }
+        }
+    }
+    if (moved.empty()) {
+        // the writer removes its temporary file
+        return absl::OkStatus();
+    }
+    auto status = writer.value()->Finish();
+    if (!status.ok()) {
+        return status;
+    }
+
+    // map the new file, the segment is never in memory
+    auto data = read_ipc_file(path);
+    if (!data.ok()) {
+        return data.status();
+    }
+    auto segment = std::make_shared<Segment>(path, sequence, data.value());
+
+    {
+        // the manifest is written under the lock, so it never races with a
+        // drop of the table
+        std::lock_guard lock(mutex);
+        auto dropped = drop_sequences.find(table->id);
+        if (dropped != drop_sequences.end() && dropped->second > sequence) {
+            segment->obsolete = true;
+            SPDLOG_INFO("discard segment {}, table {} is dropped", path,
+                        table->name);
+            return absl::OkStatus();
+        }
+
+        nlohmann::json manifest = {{"path", path}, {"sequence", sequence}};
+        if (!db->Put("TablesCF", manifest_key(table->id), manifest.dump())) {
+            segment->obsolete = true;
+            return absl::InternalError("failed to write segment manifest");
+        }
+
+        // the previous segment stays for older snapshots, its file is
+        // removed once it's pruned and no scan reads it
+        auto& generations = segments[table->id];
+        if (!generations.empty()) {
+            generations.back()->obsolete = true;
+        }
+        generations.push_back(segment);
+        Prune(&generations);
+    }
+
+    // the rows are in the current segment now, remove them from rocksdb
+    // unless they are written again after the snapshot, a chunk at a time
+    int64_t num_deleted = 0;
+    for (size_t begin = 0; begin < moved.size(); begin += kSegmentBatchRows) {
+        size_t end = std::min(moved.size(), begin + kSegmentBatchRows);
+        std::vector<std::string> keys(moved.begin() + begin,
+                                      moved.begin() + end);
+        auto deleted =
+            db->DeleteIfUnchanged(*table, keys, scan_options.snapshot);
+        if (!deleted.ok()) {
+            return deleted.status();
+        }
+        num_deleted += deleted.value();
+    }
+
+    SPDLOG_INFO(
+        "compacted table {} into segment {}, rows: {}, moved rows: {}, hot "
+        "rows: {}",
+        table->name, path, segment->data->num_rows(), num_deleted,
+        recent.size());
+    return absl::OkStatus();
+}
+
+void SegmentStore::Drop(int64_t table_id, uint64_t sequence) {
+    std::lock_guard lock(mutex);
+    drop_sequences[table_id] = sequence;
+
+    auto it = segments.find(table_id);
+    if (it == segments.end()) {
+        return;
+    }
+    if (!db->Delete("TablesCF", manifest_key(table_id))) {
+        SPDLOG_ERROR("failed to delete segment manifest, table id: {}",
+                     table_id);
+    }
+
+    // scans still reading the segments keep the files
+    for (const auto& segment : it->second) {
+        segment->obsolete = true;
+    }
+    segments.erase(it);
+}
+
+void SegmentStore::MaybeScheduleCompaction(
+    const std::shared_ptr<small::schema::Table>& table, int64_t delta_rows) {
+    if (delta_rows < kCompactionDeltaRows) {
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+    if (pending_ids.insert(table->id).second) {
+        pending.push_back(table);
+        pending_cv.notify_one();
+    }
+}
+
+void SegmentStore::Run() {
+    while (true) {
+        std::shared_ptr<small::schema::Table> table;
+        {
+            std::unique_lock lock(mutex);
+            pending_cv.wait(lock, [this]() { return !pending.empty(); });
+            table = pending.front();
+            pending.pop_front();
+        }
+
+        auto status = Compact(table);
+        if (!status.ok()) {
+            SPDLOG_ERROR("failed to compact table {}: {}", table->name,
+                         status.ToString());
+        }
+
+        std::lock_guard lock(mutex);
+        pending_ids.erase(table->id);
+    }
+}
+
+}  // namespace small::columnar
@@ -0,0 +1,197 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+
+namespace small::columnar {
+
+// Build a new segment once a scan reads this many rows from rocksdb.
+constexpr int64_t kCompactionDeltaRows = 64 * 1024;
+
+// Rows per record batch in a segment file.
+constexpr int64_t kSegmentBatchRows = 64 * 1024;
+
+// A segment is an immutable columnar copy of the rows of a table, stored as an
+// Arrow IPC file and sorted by the primary key.
+//
+// Cold rows are moved from rocksdb into the segment in the background, rows
+// written since the last flush stay in rocksdb. A scan reads the segment and
+// merges it with the rows still in rocksdb (the delta), a row of the delta
+// always replaces the row with the same primary key in the segment.
+//
+// The manifest of the current segment of a table is stored in "TablesCF":
+//
+//   - key: S:<table ID>
+//   - value: {"path": <segment file>, "sequence": <sequence number>}
+class Segment {
+   public:
+    Segment(const std::string& path, uint64_t sequence,
+            const std::shared_ptr<arrow::Table>& data);
+
+    // Remove the file if the segment is obsolete.
+    ~Segment();
+
+    std::string path;
+
+    // Sequence number of the rocksdb snapshot the segment is built from.
+    uint64_t sequence;
+
+    // Columns of the segment, memory-mapped from the file.
+    std::shared_ptr<arrow::Table> data;
+
+    // Set when a newer segment replaces this one, the file is removed after
+    // the last scan reading it finishes.
+    std::atomic<bool> obsolete = false;
+};
+
+// Merge "delta" into "base", both are sorted by the primary key. A row of
+// "delta" replaces the row with the same primary key in "base". "base" may be
+// nullptr.
+absl::StatusOr<std::shared_ptr<arrow::Table>> merge_by_pk(
+    const std::shared_ptr<arrow::Table>& base,
+    const std::shared_ptr<arrow::RecordBatch>& delta, int pk_index);
+
+class SegmentStore {
+   private:
+    // singleton instance - the only instance
+    static SegmentStore* instancePtr;
+
+    // singleton instance - constructor protector
+    SegmentStore();
+
+    // singleton instance - destructor protector
+    ~SegmentStore() = default;
+
+    small::rocks::RocksDBWrapper* db;
+
+    // directory of segment files
+    std::string dir;
+
+    std::mutex mutex;
+
+    // table ID -> segments by sequence number, the last one is current. Older
+    // segments are kept for scans reading snapshots taken before the newer
+    // segments, see "Prune".
+    std::unordered_map<int64_t, std::vector<std::shared_ptr<Segment>>>
+        segments;
+
+    // tables waiting for a compaction
+    std::deque<std::shared_ptr<small::schema::Table>> pending;
+    std::unordered_set<int64_t> pending_ids;
+    std::condition_variable pending_cv;
+
+    // table ID -> sequence number of the latest drop, see "Drop"
+    std::unordered_map<int64_t, uint64_t> drop_sequences;
+
+    // Load segments of all manifests and remove unreferenced files.
+    void Load();
+
+    // Compact pending tables one by one, runs in a background thread.
+    void Run();
+
+    // Forget the segments no live snapshot needs: a segment is needed until
+    // the oldest snapshot can read the next one. The caller must hold
+    // "mutex".
+    void Prune(std::vector<std::shared_ptr<Segment>>* generations);
+
+   public:
+    // singleton instance - assignment-blocker
+    void operator=(const SegmentStore&) = delete;
+
+    // singleton instance - copy-blocker
+    SegmentStore(const SegmentStore&) = delete;
+
+    // singleton instance - get api
+    static SegmentStore* GetInstance();
+
+    // singleton instance - init api
+    static void InitInstance();
+
+    // Return the current segment of the table, or nullptr if the table has no
+    // segment yet.
+    //
+    // Take the rocksdb snapshot of a scan BEFORE getting the segment: rows are
+    // removed from rocksdb only after the segment containing them becomes
+    // current, so the delta read from the snapshot never misses them.
+    std::shared_ptr<Segment> GetSegment(int64_t table_id);
+
+    // Return the latest segment built from a snapshot not newer than
+    // "sequence", so a scan of the snapshot at "sequence" never sees rows
+    // written after it. Return nullptr if there is no such segment.
+    std::shared_ptr<Segment> GetSegment(int64_t table_id, uint64_t sequence);
+
+    // Read a row of the current segment by its primary key as a packed row
+    // (see "small::encode::encode_row"), return false if not found.
+    bool GetRow(const small::schema::Table& table,
+                const small::type::Datum& pk, std::string* row);
+
+    // Read a row of the segment "GetSegment(table.id, sequence)".
+    bool GetRow(const small::schema::Table& table,
+                const small::type::Datum& pk, uint64_t sequence,
+                std::string* row);
+
+    // Build a new segment of the table from its current segment and the cold
+    // rows of the delta (rows not in a memtable), then remove the moved rows
+    // from rocksdb. Both are read and merged a window at a time and the new
+    // segment is written as it goes, only the keys of the moved rows are kept
+    // in memory.
+    absl::Status Compact(const std::shared_ptr<small::schema::Table>& table);
+
+    // Remove the segment of the table after its rows are deleted from rocksdb
+    // (e.g. TRUNCATE), "sequence" is a sequence number after the delete. A
+    // running compaction which read its delta before "sequence" discards its
+    // segment, otherwise the deleted rows would come back.
+    void Drop(int64_t table_id, uint64_t sequence);
+
+    // Schedule a compaction of the table in the background if "delta_rows",
+    // the number of rows a scan read from rocksdb, is large enough.
+    void MaybeScheduleCompaction(
+        const std::shared_ptr<small::schema::Table>& table,
+        int64_t delta_rows);
+};
+
+}  // namespace small::columnar
@@ -17,6 +17,8 @@
 // =====================================================================
 
 #include <string>
+#include <string_view>
+#include <vector>
 
 // =====================================================================
 // self header
@@ -46,4 +48,188 @@ small::type::Datum decode(const std::string& str, small::type::Type type) {
     }
 }
 
+namespace {
+
+constexpr char kEscape = '\x00';
+constexpr char kEscapedNull = '\xff';
+constexpr char kTerminator = '\x01';
+
+constexpr uint64_t kSignBit = uint64_t{1} << 63;
+
+}  // namespace
+
+std::string encode_key(const small::type::Datum& datum) {
+    std::string dst;
+    encode_key(&dst, datum);
+    return dst;
+}
+
+void encode_key(std::string* dst, const small::type::Datum& datum) {
+    if (std::holds_alternative<int64_t>(datum)) {
+        uint64_t value =
+            static_cast<uint64_t>(std::get<int64_t>(datum)) ^ kSignBit;
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            dst->push_back(static_cast<char>(value >> shift));
+        }
+    } else if (std::holds_alternative<std::string>(datum)) {
+        const auto& str = std::get<std::string>(datum);
+        dst->reserve(dst->size() + str.size() + 2);
+        for (char c : str) {
+            dst->push_back(c);
+            if (c == kEscape) {
+                dst->push_back(kEscapedNull);
+            }
+        }
+        dst->push_back(kEscape);
+        dst->push_back(kTerminator);
+    } else {
+        throw std::runtime_error("Unsupported type for key encoding");
+    }
+}
+
+small::type::Datum decode_key(std::string_view* input,
+                              small::type::Type type) {
+    switch (type) {
+        case small::type::Type::Int64: {
+            if (input->size() < 8) {
+                throw std::runtime_error("corrupted key: truncated int64");
+            }
+            uint64_t value = 0;
+            for (int i = 0; i < 8; i++) {
+                value = (value << 8) | static_cast<uint8_t>((*input)[i]);
+            }
+            input->remove_prefix(8);
+            return static_cast<int64_t>(value ^ kSignBit);
+        }
+        case small::type::Type::String: {
+            std::string str;
+            for (size_t i = 0; i + 1 < input->size(); i++) {
+                char c = (*input)[i];
+                if (c != kEscape) {
+                    str.push_back(c);
+                    continue;
+                }
+
+                char next = (*input)[++i];
+                if (next == kTerminator) {
+                    input->remove_prefix(i + 1);
+                    return str;
+                }
+                if (next != kEscapedNull) {
+                    throw std::runtime_error("corrupted key: invalid escape");
+                }
+                str.push_back(kEscape);
+            }
+            throw std::runtime_error("corrupted key: unterminated string");
+        }
+        default:
+            throw std::runtime_error("Unsupported type for key decoding");
+    }
+}
+
+std::string encode_row(const std::vector<int64_t>& column_ids,
+                       const std::vector<std::string>& columns) {
+    if (column_ids.size() != columns.size()) {
+        throw std::runtime_error("column ids and columns mismatch");
+    }
+
+    size_t size = 0;
+    for (const auto& column : columns) {
+        size += column.size() + 2;
+    }
+
+    std::string row;
+    row.reserve(size);
+    for (size_t i = 0; i < columns.size(); i++) {
+        put_varint64(&row, column_ids[i]);
+        put_varint64(&row, columns[i].size());
+        row.append(columns[i]);
+    }
+    return row;
+}
+
+std::string encode_value(const small::type::Datum& datum) {
+    if (std::holds_alternative<int64_t>(datum)) {
+        auto value = static_cast<uint64_t>(std::get<int64_t>(datum));
+        std::string dst(8, '\0');
+        for (int i = 0; i < 8; i++) {
+            dst[i] = static_cast<char>(value >> (i * 8));
+        }
+        return dst;
+    } else if (std::holds_alternative<std::string>(datum)) {
+        return std::get<std::string>(datum);
+    }
+    throw std::runtime_error("Unsupported type for value encoding");
+}
+
+small::type::Datum decode_value(std::string_view value,
+                                small::type::Type type) {
+    switch (type) {
+        case small::type::Type::Int64: {
+            int64_t result;
+            if (!decode_int64(value, &result)) {
+                throw std::runtime_error("corrupted value: invalid int64");
+            }
+            return result;
+        }
+        case small::type::Type::String:
+            return std::string(value);
+        default:
+            throw std::runtime_error("Unsupported type for value decoding");
+    }
+}
+
+bool decode_int64(std::string_view value, int64_t* result) {
+    if (value.size() != 8) {
+        return false;
+    }
+    uint64_t bits = 0;
+    for (int i = 7; i >= 0; i--) {
+        bits = (bits << 8) | static_cast<uint8_t>(value[i]);
+    }
+    *result = static_cast<int64_t>(bits);
+    return true;
+}
+
+RowReader::RowReader(std::string_view row) : remaining(row) {}
+
+bool RowReader::Next(int64_t* column_id, std::string_view* column) {
+    if (remaining.empty()) {
+        return false;
+    }
+
+    uint64_t id;
+    uint64_t len;
+    if (!get_varint64(&remaining, &id) || !get_varint64(&remaining, &len) ||
+        len > remaining.size()) {
+        throw std::runtime_error("corrupted row: invalid column header");
+    }
+    *column_id = static_cast<int64_t>(id);
+    *column = remaining.substr(0, len);
+    remaining.remove_prefix(len);
+    return true;
+}
+
+void put_varint64(std::string* dst, uint64_t value) {
+    while (value >= 0x80) {
+        dst->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    dst->push_back(static_cast<char>(value));
+}
+
+bool get_varint64(std::string_view* input, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift <= 63 && !input->empty(); shift += 7) {
+        uint64_t byte = static_cast<uint8_t>(input->front());
+        input->remove_prefix(1);
+        result |= (byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
 }  // namespace small::encode
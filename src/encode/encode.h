@@ -18,7 +18,10 @@
 // c++ std
 // =====================================================================
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 
 // =====================================================================
 // local libraries
@@ -28,8 +31,73 @@
 
 namespace small::encode {
 
+// Text form of a datum, used on the wire (e.g. the values of a remote insert)
+// and for parsing input. Stored rows use "encode_value".
 std::string encode(const small::type::Datum& datum);
 
 small::type::Datum decode(const std::string& str, small::type::Type type);
 
+// Encode a datum into a memcomparable format, the byte order of encoded datums
+// is the same as the order of the datums themselves, so they can be used as
+// (part of) the key in rocksdb:
+//
+// - Int64: 8 bytes big-endian with the sign bit flipped.
+// - String: every "\x00" is escaped as "\x00\xff" and the string is terminated
+//   by "\x00\x01".
+//
+// Encoded datums are self-delimiting, so a key can be composed of several of
+// them.
+std::string encode_key(const small::type::Datum& datum);
+
+void encode_key(std::string* dst, const small::type::Datum& datum);
+
+// Decode a datum produced by "encode_key" from the front of "input", the
+// consumed bytes are removed from "input".
+small::type::Datum decode_key(std::string_view* input, small::type::Type type);
+
+// A row is stored as a single value which packs the encoded columns one after
+// another. Each column is tagged with its column ID and prefixed with its
+// length, both as varints:
+//
+//   <varint id_0><varint len_0><column_0><varint id_1><varint len_1>...
+//
+// Columns are identified by ID instead of position, so a reader can skip the
+// columns it doesn't know and treat missing columns as NULL.
+std::string encode_row(const std::vector<int64_t>& column_ids,
+                       const std::vector<std::string>& columns);
+
+// Encode a datum as a column of a packed row:
+//
+// - Int64: 8 bytes little-endian.
+// - String: the bytes as is.
+//
+// The length of a column is in the row, and a NULL column is left out of the
+// row, so neither needs a marker in the value. Unlike "encode", an integer is
+// decoded by a single load instead of parsing text.
+std::string encode_value(const small::type::Datum& datum);
+
+small::type::Datum decode_value(std::string_view value,
+                                small::type::Type type);
+
+// Decode an Int64 column of a packed row, return false if the value isn't 8
+// bytes.
+bool decode_int64(std::string_view value, int64_t* result);
+
+// Reads the columns of a packed row in order without copying them, the
+// returned views point into the underlying value.
+class RowReader {
+   public:
+    explicit RowReader(std::string_view row);
+
+    // Read the next column, return false if there is no more column.
+    bool Next(int64_t* column_id, std::string_view* column);
+
+   private:
+    std::string_view remaining;
+};
+
+void put_varint64(std::string* dst, uint64_t value);
+
+bool get_varint64(std::string_view* input, uint64_t* value);
+
 }  // namespace small::encode
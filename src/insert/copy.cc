@@ -0,0 +1,335 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <charconv>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// pg_query
+#include "pg_query.pb-c.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/catalog/catalog.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+#include "src/semantics/extract.h"
+#include "src/server_info/info.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/insert/copy.h"
+
+namespace small::insert {
+
+namespace {
+
+class CopyOptions {
+   public:
+    // CSV (quoted fields) or text, the default format of postgres
+    bool csv = false;
+
+    // skip the first line
+    bool header = false;
+
+    char delimiter = '\t';
+};
+
+// Return the argument of an option as a string, "true" if it has none (e.g.
+// "HEADER").
+std::string get_option_arg(PgQuery__DefElem* def_elem) {
+    if (def_elem->arg == nullptr) {
+        return "true";
+    }
+    switch (def_elem->arg->node_case) {
+        case PG_QUERY__NODE__NODE_STRING:
+            return def_elem->arg->string->sval;
+        case PG_QUERY__NODE__NODE_BOOLEAN:
+            return def_elem->arg->boolean->boolval ? "true" : "false";
+        case PG_QUERY__NODE__NODE_INTEGER:
+            return std::to_string(def_elem->arg->integer->ival);
+        default:
+            return "";
+    }
+}
+
+absl::StatusOr<CopyOptions> get_options(PgQuery__CopyStmt* copy_stmt) {
+    CopyOptions options;
+    std::string delimiter;
+    for (int i = 0; i < copy_stmt->n_options; i++) {
+        auto def_elem = copy_stmt->options[i]->def_elem;
+        std::string name = def_elem->defname;
+        std::string arg = get_option_arg(def_elem);
+        if (name == "format") {
+            if (arg != "csv" && arg != "text") {
+                return absl::UnimplementedError(
+                    fmt::format("unsupported COPY format: {}", arg));
+            }
+            options.csv = arg == "csv";
+        } else if (name == "header") {
+            if (arg == "true" || arg == "on" || arg == "1") {
+                options.header = true;
+            } else if (arg == "false" || arg == "off" || arg == "0") {
+                options.header = false;
+            } else {
+                return absl::InvalidArgumentError(
+                    fmt::format("invalid HEADER value: {}", arg));
+            }
+        } else if (name == "delimiter") {
+            if (arg.size() != 1) {
+                return absl::InvalidArgumentError(
+                    "COPY delimiter must be a single character");
+            }
+            delimiter = arg;
+        } else {
+            return absl::UnimplementedError(
+                fmt::format("unsupported COPY option: {}", name));
+        }
+    }
+
+    if (!delimiter.empty()) {
+        options.delimiter = delimiter[0];
+    } else if (options.csv) {
+        options.delimiter = ',';
+    }
+    return options;
+}
+
+// Split a line of the file into fields. A CSV field may be quoted by '"', a
+// quote inside a quoted field is doubled.
+absl::StatusOr<std::vector<std::string>> split_line(
+    std::string_view line, const CopyOptions& options) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if (c != '"') {
+                field.push_back(c);
+            } else if (i + 1 < line.size() && line[i + 1] == '"') {
+                field.push_back('"');
+                i++;
+            } else {
+                quoted = false;
+            }
+            continue;
+        }
+
+        if (options.csv && c == '"') {
+            quoted = true;
+        } else if (c == options.delimiter) {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else {
+            field.push_back(c);
+        }
+    }
+    if (quoted) {
+        return absl::InvalidArgumentError("unterminated quoted field");
+    }
+    fields.push_back(std::move(field));
+    return fields;
+}
+
+// An empty field (or "\N" in the text format) is NULL, which is stored as the
+// default value of the type.
+absl::StatusOr<small::type::Datum> to_datum(const std::string& field,
+                                            small::type::Type type,
+                                            const CopyOptions& options) {
+    bool is_null = field.empty() || (!options.csv && field == "\\N");
+    if (type == small::type::Type::String) {
+        return is_null ? std::string() : field;
+    }
+    if (is_null) {
+        return int64_t(0);
+    }
+
+    int64_t value;
+    const char* end = field.data() + field.size();
+    auto [ptr, ec] = std::from_chars(field.data(), end, value);
+    if (ec != std::errc() || ptr != end) {
+        return absl::InvalidArgumentError(
+            fmt::format("invalid int64 value: {}", field));
+    }
+    return value;
+}
+
+}  // namespace
+
+absl::StatusOr<int64_t> copy_from(PgQuery__CopyStmt* copy_stmt) {
+    if (!copy_stmt->is_from) {
+        return absl::UnimplementedError("COPY TO is not supported");
+    }
+    if (copy_stmt->is_program || copy_stmt->query != nullptr) {
+        return absl::UnimplementedError(
+            "COPY FROM PROGRAM and COPY of a query are not supported");
+    }
+    std::string filename =
+        copy_stmt->filename == nullptr ? "" : copy_stmt->filename;
+    if (filename.empty()) {
+        return absl::UnimplementedError(
+            "COPY FROM STDIN is not supported, copy from a file of the server");
+    }
+
+    auto table_name = small::semantics::extract_table_name(copy_stmt->relation);
+    auto result = small::catalog::Catalog::GetInstance()->GetTable(table_name);
+    if (!result) {
+        return absl::NotFoundError(
+            fmt::format("table {} not found", table_name));
+    }
+    const auto& table = result.value();
+
+    auto options = get_options(copy_stmt);
+    if (!options.ok()) {
+        return options.status();
+    }
+
+    // columns of the fields in the order of the file
+    std::vector<int> columns;
+    for (int i = 0; i < copy_stmt->n_attlist; i++) {
+        std::string name = copy_stmt->attlist[i]->string->sval;
+        int column = table->get_column_index(name);
+        if (column == -1) {
+            return absl::InvalidArgumentError(
+                fmt::format("column {} not found", name));
+        }
+        columns.push_back(column);
+    }
+    if (columns.empty()) {
+        for (int c = 0; c < table->columns.size(); c++) {
+            columns.push_back(c);
+        }
+    }
+    bool has_pk = false;
+    for (int column : columns) {
+        has_pk |= table->columns[column].is_primary_key;
+    }
+    if (!has_pk) {
+        return absl::InvalidArgumentError(
+            fmt::format("COPY into table {} needs the primary key column",
+                        table_name));
+    }
+
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        return info.status();
+    }
+    auto db =
+        small::rocks::RocksDBWrapper::GetInstance(info.value()->db_path, {});
+
+    std::ifstream file(filename);
+    if (!file) {
+        return absl::NotFoundError(
+            fmt::format("failed to open file {}", filename));
+    }
+
+    // columns missing in the file keep their default values
+    const auto defaults = small::rocks::decode_row(*table, "");
+
+    std::vector<std::vector<small::type::Datum>> rows;
+    int64_t num_rows = 0;
+    int64_t line_number = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        line_number++;
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if ((line_number == 1 && options.value().header) || line.empty()) {
+            continue;
+        }
+
+        auto fields = split_line(line, options.value());
+        if (!fields.ok()) {
+            return absl::InvalidArgumentError(
+                fmt::format("line {}: {}", line_number,
+                            fields.status().message()));
+        }
+        if (fields.value().size() != columns.size()) {
+            return absl::InvalidArgumentError(fmt::format(
+                "line {}: expected {} fields, got {}", line_number,
+                columns.size(), fields.value().size()));
+        }
+
+        auto values = defaults;
+        for (size_t i = 0; i < columns.size(); i++) {
+            auto datum = to_datum(fields.value()[i],
+                                  table->columns[columns[i]].type,
+                                  options.value());
+            if (!datum.ok()) {
+                return absl::InvalidArgumentError(
+                    fmt::format("line {}: {}", line_number,
+                                datum.status().message()));
+            }
+            values[columns[i]] = std::move(datum.value());
+        }
+        rows.push_back(std::move(values));
+
+        if (rows.size() >= kCopyChunkRows) {
+            if (!db->IngestRows(table, rows)) {
+                return absl::InternalError("failed to ingest rows");
+            }
+            num_rows += rows.size();
+            rows.clear();
+        }
+    }
+    if (file.bad()) {
+        return absl::InternalError(
+            fmt::format("failed to read file {}", filename));
+    }
+    if (!rows.empty()) {
+        if (!db->IngestRows(table, rows)) {
+            return absl::InternalError("failed to ingest rows");
+        }
+        num_rows += rows.size();
+    }
+
+    // ingested files overlapping existing rows land in L0, merge them
+    if (num_rows > 0 && !db->CompactTable(table->id)) {
+        return absl::InternalError("failed to compact table " + table_name);
+    }
+
+    SPDLOG_INFO("copied {} rows into table {} from {}", num_rows, table_name,
+                filename);
+    return num_rows;
+}
+
+}  // namespace small::insert
@@ -0,0 +1,52 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// absl
+#include "absl/status/statusor.h"
+
+namespace small::insert {
+
+// Rows of a COPY ingested as a single SST file.
+constexpr int64_t kCopyChunkRows = 1 << 20;
+
+// Bulk load a file of the server into a table:
+//
+//   COPY <table> [(<columns>)] FROM '<file>'
+//       [WITH (FORMAT csv | text, HEADER [true | false], DELIMITER '<c>')]
+//
+// Every chunk of "kCopyChunkRows" rows is sorted and ingested as an SST file,
+// skipping the memtable and the WAL, and the rows of the table are compacted
+// at the end. Columns not in the list get the default value of their type.
+//
+// Index entries of the rows are ingested with them (see
+// "RocksDBWrapper::IngestRows"). Return the number of loaded rows.
+absl::StatusOr<int64_t> copy_from(PgQuery__CopyStmt* copy_stmt);
+
+}  // namespace small::insert
@@ -27,6 +27,9 @@
 // c++ std
 // =====================================================================
 
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -139,8 +142,7 @@ class RowDescriptionResponse : public Message {
             const auto& field = schema->field(i);
 
             auto data_type =
-                small::type::from_string(field->type()->ToString().c_str())
-                    .value();
+                small::type::from_gandiva_type(field->type()).value();
 
             // The field name.
             append_cstring(buffer, field->name());
@@ -193,10 +195,23 @@ class DataRowResponse : public Message {
             append_int16(buffer, batch->num_columns());
 
             for (int j = 0; j < batch->num_columns(); ++j) {
-                auto string_column =
-                    std::static_pointer_cast<arrow::StringArray>(
-                        batch->column(j));
-                auto cell = string_column->GetString(i);
+                const auto& column = batch->column(j);
+                if (column->IsNull(i)) {
+                    // NULL is a length of -1 without bytes
+                    append_int32(buffer, -1);
+                    continue;
+                }
+
+                // the text format of the value
+                std::string cell;
+                if (column->type_id() == arrow::Type::INT64) {
+                    const auto& ints =
+                        static_cast<const arrow::Int64Array&>(*column);
+                    cell = std::to_string(ints.Value(i));
+                } else {
+                    cell = static_cast<const arrow::StringArray&>(*column)
+                               .GetString(i);
+                }
                 append_int32(buffer, cell.size());
                 buffer.insert(buffer.end(), cell.data(),
                               cell.data() + cell.size());
@@ -210,8 +225,12 @@ class DataRowResponse : public Message {
 };
 
 class CommandCompleteResponse : public Message {
+   private:
+    const int64_t num_rows;
+
    public:
-    CommandCompleteResponse() = default;
+    explicit CommandCompleteResponse(int64_t num_rows = 0)
+        : num_rows(num_rows) {}
 
     void encode(std::vector<char>& buffer) {
         // DataRow (B)
@@ -224,7 +243,7 @@ class CommandCompleteResponse : public Message {
         append_int32(buffer, 0);
 
         // command tag
-        append_cstring(buffer, "SELECT 0");
+        append_cstring(buffer, "SELECT " + std::to_string(num_rows));
 
         // update the message length
         int32_t message_length = buffer.size() - pre_bytes;
@@ -382,6 +401,22 @@ class ReadyForQuery : public Message {
     }
 };
 
+// Send the whole buffer, "send" may write only a part of it.
+void send_buffer(int sockfd, const std::vector<char>& buffer) {
+    size_t sent = 0;
+    while (sent < buffer.size()) {
+        ssize_t n = send(sockfd, buffer.data() + sent, buffer.size() - sent, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            SPDLOG_ERROR("send failed, error: {}", strerror(errno));
+            return;
+        }
+        sent += n;
+    }
+}
+
 class NetworkPackage {
    private:
     std::vector<Message*> messages;
@@ -397,7 +432,7 @@ class NetworkPackage {
             message->encode(buffer);
         }
 
-        send(sockfd, buffer.data(), buffer.size(), 0);
+        send_buffer(sockfd, buffer);
     }
 };
 
@@ -419,13 +454,30 @@ void send_ready(int sockfd) {
     network_package->send_all(sockfd);
 }
 
-void send_batch(int sockfd, const std::shared_ptr<arrow::RecordBatch>& batch) {
-    NetworkPackage* network_package = new NetworkPackage();
-    network_package->add_message(new RowDescriptionResponse(batch->schema()));
-    network_package->add_message(new DataRowResponse(batch));
-    network_package->add_message(new CommandCompleteResponse());
-    network_package->add_message(new ReadyForQuery());
-    network_package->send_all(sockfd);
+void ResultWriter::Write(const std::shared_ptr<arrow::RecordBatch>& batch) {
+    if (batch->num_rows() == 0) {
+        return;
+    }
+
+    std::vector<char> buffer;
+    if (num_rows_ == 0) {
+        RowDescriptionResponse(batch->schema()).encode(buffer);
+    }
+    DataRowResponse(batch).encode(buffer);
+    send_buffer(sockfd_, buffer);
+    num_rows_ += batch->num_rows();
+}
+
+void ResultWriter::Finish() {
+    if (num_rows_ == 0) {
+        send_empty_result(sockfd_);
+        return;
+    }
+
+    std::vector<char> buffer;
+    CommandCompleteResponse(num_rows_).encode(buffer);
+    ReadyForQuery().encode(buffer);
+    send_buffer(sockfd_, buffer);
 }
 
 void send_empty_result(int sockfd) {
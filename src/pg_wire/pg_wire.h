@@ -18,6 +18,7 @@
 // c++ std
 // =====================================================================
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -31,7 +32,22 @@ namespace small::pg_wire {
 
 void send_ready(int sockfd);
 
-void send_batch(int sockfd, const std::shared_ptr<arrow::RecordBatch>& batch);
+// Stream the result of a query: every batch is encoded and sent as soon as it
+// is written, the row description goes before the first rows.
+class ResultWriter {
+   public:
+    explicit ResultWriter(int sockfd) : sockfd_(sockfd) {}
+
+    void Write(const std::shared_ptr<arrow::RecordBatch>& batch);
+
+    // End the result with the command tag and ReadyForQuery, or with an empty
+    // query response if no row is written.
+    void Finish();
+
+   private:
+    int sockfd_;
+    int64_t num_rows_ = 0;
+};
 
 void send_empty_result(int sockfd);
 
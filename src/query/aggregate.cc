@@ -0,0 +1,883 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+
+// arrow
+#include "arrow/api.h"
+#include "arrow/compute/api_vector.h"
+#include "arrow/io/file.h"
+#include "arrow/ipc/api.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/server_info/info.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/aggregate.h"
+
+namespace query {
+
+namespace {
+
+// Spilled rows are split into 1 << kPartitionBits partitions by the top bits
+// of their hashes, every level of recursion takes the next bits.
+constexpr int kPartitionBits = 4;
+constexpr int kNumPartitions = 1 << kPartitionBits;
+
+constexpr size_t kInitialSlots = 1024;
+
+// digits after the point of AVG, like the numeric results of postgres
+constexpr int kAvgScale = 16;
+constexpr int64_t kAvgUnit = 10'000'000'000'000'000;
+
+constexpr uint64_t kNullHash = 0x9e3779b97f4a7c15ULL;
+
+std::atomic<uint64_t> spill_sequence{0};
+
+// The finalizer of murmur3, spreads every bit of the input over the output.
+inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t combine(uint64_t h, uint64_t value) {
+    return mix(h * kNullHash + value);
+}
+
+// Mix a key column into the hashes of the rows. Columns are hashed one at a
+// time, so the loop over the values of an int column has no branch and can
+// be vectorized by the compiler.
+void hash_column(const arrow::Array& array, std::vector<uint64_t>* hashes) {
+    uint64_t* h = hashes->data();
+    int64_t n = array.length();
+    if (array.type_id() == arrow::Type::INT64) {
+        const int64_t* values =
+            static_cast<const arrow::Int64Array&>(array).raw_values();
+        if (array.null_count() == 0) {
+            for (int64_t i = 0; i < n; i++) {
+                h[i] = combine(h[i], static_cast<uint64_t>(values[i]));
+            }
+            return;
+        }
+        for (int64_t i = 0; i < n; i++) {
+            h[i] = combine(h[i], array.IsNull(i)
+                                     ? kNullHash
+                                     : static_cast<uint64_t>(values[i]));
+        }
+        return;
+    }
+
+    const auto& strings = static_cast<const arrow::StringArray&>(array);
+    std::hash<std::string_view> hasher;
+    for (int64_t i = 0; i < n; i++) {
+        h[i] = combine(h[i], strings.IsNull(i) ? kNullHash
+                                               : hasher(strings.GetView(i)));
+    }
+}
+
+std::string int128_to_string(unsigned __int128 value) {
+    if (value == 0) {
+        return "0";
+    }
+    std::string digits;
+    while (value > 0) {
+        digits.push_back(static_cast<char>('0' + value % 10));
+        value /= 10;
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+// Format sum / count with "kAvgScale" digits after the point, rounded half
+// away from zero.
+std::string format_average(__int128 sum, int64_t count) {
+    bool negative = sum < 0;
+    unsigned __int128 value = negative ? -static_cast<unsigned __int128>(sum)
+                                       : static_cast<unsigned __int128>(sum);
+    unsigned __int128 integer = value / count;
+    unsigned __int128 remainder = value % count;
+    unsigned __int128 fraction = (remainder * kAvgUnit * 2 + count) /
+                                 (static_cast<unsigned __int128>(count) * 2);
+    if (fraction == static_cast<unsigned __int128>(kAvgUnit)) {
+        integer++;
+        fraction = 0;
+    }
+    if (integer == 0 && fraction == 0) {
+        negative = false;
+    }
+    std::string digits = int128_to_string(fraction);
+    return absl::StrFormat("%s%s.%s%s", negative ? "-" : "",
+                           int128_to_string(integer),
+                           std::string(kAvgScale - digits.size(), '0'),
+                           digits);
+}
+
+// COUNT(*) counts the rows, COUNT(x) the rows where x is not NULL.
+class CountAccumulator : public Accumulator {
+   public:
+    explicit CountAccumulator(bool star) : star_(star) {}
+
+    void Resize(size_t num_groups) override { counts_.resize(num_groups); }
+
+    void Update(const std::vector<int32_t>& group_ids,
+                const arrow::Array& input) override {
+        bool all = star_ || input.null_count() == 0;
+        for (size_t r = 0; r < group_ids.size(); r++) {
+            if (group_ids[r] >= 0 && (all || input.IsValid(r))) {
+                counts_[group_ids[r]]++;
+            }
+        }
+    }
+
+    absl::StatusOr<std::shared_ptr<arrow::Array>> Finish(
+        size_t begin, size_t end) override {
+        arrow::Int64Builder builder;
+        auto status = builder.AppendValues(counts_.data() + begin, end - begin);
+        if (!status.ok()) {
+            return absl::InternalError(status.ToString());
+        }
+        return builder.Finish().ValueOrDie();
+    }
+
+    int64_t memory() const override {
+        return counts_.capacity() * sizeof(int64_t);
+    }
+
+   private:
+    bool star_;
+    std::vector<int64_t> counts_;
+};
+
+// SUM and AVG of ints, the sums are 128 bits so they only overflow at the
+// end.
+class SumAccumulator : public Accumulator {
+   public:
+    explicit SumAccumulator(bool average) : average_(average) {}
+
+    void Resize(size_t num_groups) override {
+        sums_.resize(num_groups);
+        counts_.resize(num_groups);
+    }
+
+    void Update(const std::vector<int32_t>& group_ids,
+                const arrow::Array& input) override {
+        const int64_t* values =
+            static_cast<const arrow::Int64Array&>(input).raw_values();
+        bool all = input.null_count() == 0;
+        for (size_t r = 0; r < group_ids.size(); r++) {
+            int32_t group_id = group_ids[r];
+            if (group_id >= 0 && (all || input.IsValid(r))) {
+                sums_[group_id] += values[r];
+                counts_[group_id]++;
+            }
+        }
+    }
+
+    absl::StatusOr<std::shared_ptr<arrow::Array>> Finish(
+        size_t begin, size_t end) override {
+        std::shared_ptr<arrow::Array> array;
+        arrow::Status status;
+        if (average_) {
+            arrow::StringBuilder builder;
+            for (size_t g = begin; g < end && status.ok(); g++) {
+                status = counts_[g] == 0
+                             ? builder.AppendNull()
+                             : builder.Append(
+                                   format_average(sums_[g], counts_[g]));
+            }
+            if (status.ok()) {
+                status = builder.Finish(&array);
+            }
+        } else {
+            arrow::Int64Builder builder;
+            for (size_t g = begin; g < end && status.ok(); g++) {
+                if (sums_[g] > std::numeric_limits<int64_t>::max() ||
+                    sums_[g] < std::numeric_limits<int64_t>::min()) {
+                    return absl::OutOfRangeError("bigint out of range");
+                }
+                status = counts_[g] == 0
+                             ? builder.AppendNull()
+                             : builder.Append(static_cast<int64_t>(sums_[g]));
+            }
+            if (status.ok()) {
+                status = builder.Finish(&array);
+            }
+        }
+        if (!status.ok()) {
+            return absl::InternalError(status.ToString());
+        }
+        return array;
+    }
+
+    int64_t memory() const override {
+        return sums_.capacity() * sizeof(__int128) +
+               counts_.capacity() * sizeof(int64_t);
+    }
+
+   private:
+    bool average_;
+    std::vector<__int128> sums_;
+    std::vector<int64_t> counts_;
+};
+
+// MIN and MAX, "T" is int64_t or std::string.
+template <typename T, bool kMin>
+class MinMaxAccumulator : public Accumulator {
+   public:
+    using ArrayType =
+        std::conditional_t<std::is_same_v<T, std::string>, arrow::StringArray,
+                           arrow::Int64Array>;
+    using BuilderType =
+        std::conditional_t<std::is_same_v<T, std::string>,
+                           arrow::StringBuilder, arrow::Int64Builder>;
+
+    void Resize(size_t num_groups) override {
+        values_.resize(num_groups);
+        seen_.resize(num_groups);
+    }
+
+    void Update(const std::vector<int32_t>& group_ids,
+                const arrow::Array& input) override {
+        const auto& array = static_cast<const ArrayType&>(input);
+        for (size_t r = 0; r < group_ids.size(); r++) {
+            int32_t group_id = group_ids[r];
+            if (group_id < 0 || array.IsNull(r)) {
+                continue;
+            }
+            auto value = array.GetView(r);
+            T& current = values_[group_id];
+            if (seen_[group_id] && (kMin ? !(value < current)
+                                         : !(current < value))) {
+                continue;
+            }
+            if constexpr (std::is_same_v<T, std::string>) {
+                bytes_ += static_cast<int64_t>(value.size()) -
+                          static_cast<int64_t>(current.size());
+            }
+            current = T(value);
+            seen_[group_id] = 1;
+        }
+    }
+
+    absl::StatusOr<std::shared_ptr<arrow::Array>> Finish(
+        size_t begin, size_t end) override {
+        BuilderType builder;
+        arrow::Status status;
+        for (size_t g = begin; g < end && status.ok(); g++) {
+            status = seen_[g] ? builder.Append(values_[g])
+                              : builder.AppendNull();
+        }
+        std::shared_ptr<arrow::Array> array;
+        if (status.ok()) {
+            status = builder.Finish(&array);
+        }
+        if (!status.ok()) {
+            return absl::InternalError(status.ToString());
+        }
+        return array;
+    }
+
+    int64_t memory() const override {
+        return values_.capacity() * sizeof(T) + seen_.capacity() + bytes_;
+    }
+
+   private:
+    std::vector<T> values_;
+    std::vector<uint8_t> seen_;
+
+    // bytes of the strings out of "values_"
+    int64_t bytes_ = 0;
+};
+
+// Read back the batches of a spill file, the file is deleted with the
+// reader.
+class SpillReader : public Operator {
+   public:
+    static absl::StatusOr<std::unique_ptr<SpillReader>> Open(
+        const std::string& path) {
+        std::unique_ptr<SpillReader> op(new SpillReader());
+        op->path_ = path;
+        auto file = arrow::io::ReadableFile::Open(path);
+        if (!file.ok()) {
+            return absl::InternalError("failed to open spill file: " +
+                                       file.status().ToString());
+        }
+        op->file_ = file.ValueOrDie();
+        auto reader = arrow::ipc::RecordBatchStreamReader::Open(op->file_);
+        if (!reader.ok()) {
+            return absl::InternalError("failed to read spill file: " +
+                                       reader.status().ToString());
+        }
+        op->reader_ = reader.ValueOrDie();
+        return op;
+    }
+
+    ~SpillReader() override {
+        if (file_) {
+            auto _ = file_->Close();
+        }
+        std::error_code ec;
+        std::filesystem::remove(path_, ec);
+    }
+
+    std::shared_ptr<arrow::Schema> schema() const override {
+        return reader_->schema();
+    }
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override {
+        std::shared_ptr<arrow::RecordBatch> batch;
+        auto status = reader_->ReadNext(&batch);
+        if (!status.ok()) {
+            return absl::InternalError("failed to read spill file: " +
+                                       status.ToString());
+        }
+        return batch;
+    }
+
+   private:
+    SpillReader() = default;
+
+    std::string path_;
+    std::shared_ptr<arrow::io::ReadableFile> file_;
+    std::shared_ptr<arrow::ipc::RecordBatchReader> reader_;
+};
+
+}  // namespace
+
+std::optional<Aggregate::Kind> get_aggregate_kind(const std::string& name,
+                                                  bool star) {
+    if (name == "count") {
+        return star ? Aggregate::Kind::CountStar : Aggregate::Kind::Count;
+    }
+    if (star) {
+        return std::nullopt;
+    }
+    if (name == "sum") {
+        return Aggregate::Kind::Sum;
+    }
+    if (name == "avg") {
+        return Aggregate::Kind::Avg;
+    }
+    if (name == "min") {
+        return Aggregate::Kind::Min;
+    }
+    if (name == "max") {
+        return Aggregate::Kind::Max;
+    }
+    return std::nullopt;
+}
+
+absl::StatusOr<std::unique_ptr<Accumulator>> make_accumulator(
+    Aggregate::Kind kind, small::type::Type type) {
+    bool is_string = type == small::type::Type::String;
+    switch (kind) {
+        case Aggregate::Kind::CountStar:
+            return std::make_unique<CountAccumulator>(true);
+        case Aggregate::Kind::Count:
+            return std::make_unique<CountAccumulator>(false);
+        case Aggregate::Kind::Sum:
+        case Aggregate::Kind::Avg:
+            if (is_string) {
+                return absl::InvalidArgumentError(
+                    "sum and avg of strings are not supported");
+            }
+            return std::make_unique<SumAccumulator>(kind ==
+                                                    Aggregate::Kind::Avg);
+        case Aggregate::Kind::Min:
+            if (is_string) {
+                return std::make_unique<MinMaxAccumulator<std::string, true>>();
+            }
+            return std::make_unique<MinMaxAccumulator<int64_t, true>>();
+        case Aggregate::Kind::Max:
+            if (is_string) {
+                return std::make_unique<
+                    MinMaxAccumulator<std::string, false>>();
+            }
+            return std::make_unique<MinMaxAccumulator<int64_t, false>>();
+    }
+    return absl::InvalidArgumentError("unknown aggregate");
+}
+
+small::type::Type get_result_type(Aggregate::Kind kind,
+                                  small::type::Type type) {
+    switch (kind) {
+        case Aggregate::Kind::CountStar:
+        case Aggregate::Kind::Count:
+        case Aggregate::Kind::Sum:
+            return small::type::Type::Int64;
+        case Aggregate::Kind::Avg:
+            return small::type::Type::String;
+        default:
+            return type;
+    }
+}
+
+absl::StatusOr<std::unique_ptr<HashAggregate>> HashAggregate::Make(
+    std::unique_ptr<Operator> input, int num_keys,
+    const std::vector<Aggregate>& aggregates, int64_t memory_limit,
+    int max_depth) {
+    std::unique_ptr<HashAggregate> op(new HashAggregate());
+    auto input_schema = input->schema();
+    op->input_ = std::move(input);
+    op->num_keys_ = num_keys;
+    op->aggregates_ = aggregates;
+    op->memory_limit_ = memory_limit;
+    op->max_depth_ = max_depth;
+
+    arrow::FieldVector fields;
+    for (int k = 0; k < num_keys; k++) {
+        auto field = input_schema->field(k);
+        auto type = small::type::from_gandiva_type(field->type());
+        if (!type.ok()) {
+            return type.status();
+        }
+        op->keys_.push_back(KeyColumn{type.value()});
+        fields.push_back(field);
+    }
+
+    for (const auto& aggregate : aggregates) {
+        auto field = input_schema->field(aggregate.input);
+        auto type = small::type::from_gandiva_type(field->type());
+        if (!type.ok()) {
+            return type.status();
+        }
+        auto accumulator = make_accumulator(aggregate.kind, type.value());
+        if (!accumulator.ok()) {
+            return accumulator.status();
+        }
+        op->accumulators_.push_back(std::move(accumulator.value()));
+
+        auto result_type = get_result_type(aggregate.kind, type.value());
+        fields.push_back(arrow::field(
+            aggregate.name, small::type::get_gandiva_type(result_type)));
+    }
+    op->schema_ = arrow::schema(fields);
+    op->slots_.assign(kInitialSlots, -1);
+    return op;
+}
+
+HashAggregate::~HashAggregate() {
+    // the partitions not aggregated yet (e.g. the client went away)
+    for (size_t p = next_partition_; p < partitions_.size(); p++) {
+        if (partitions_[p].path.empty()) {
+            continue;
+        }
+        if (partitions_[p].writer) {
+            auto _ = partitions_[p].writer->Close();
+            _ = partitions_[p].file->Close();
+        }
+        std::error_code ec;
+        std::filesystem::remove(partitions_[p].path, ec);
+    }
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashAggregate::Next() {
+    if (!consumed_) {
+        while (true) {
+            auto batch = input_->Next();
+            if (!batch.ok()) {
+                return batch.status();
+            }
+            if (batch.value() == nullptr) {
+                break;
+            }
+            auto status = Consume(batch.value());
+            if (!status.ok()) {
+                return status;
+            }
+        }
+        consumed_ = true;
+
+        // an aggregate without GROUP BY always returns a row, e.g. 0 for
+        // COUNT(*) of an empty table
+        if (num_keys_ == 0 && num_groups_ == 0) {
+            group_hashes_.push_back(0);
+            num_groups_ = 1;
+            for (auto& accumulator : accumulators_) {
+                accumulator->Resize(num_groups_);
+            }
+        }
+
+        for (auto& partition : partitions_) {
+            if (!partition.writer) {
+                continue;
+            }
+            auto status = partition.writer->Close();
+            if (status.ok()) {
+                status = partition.file->Close();
+            }
+            partition.writer.reset();
+            if (!status.ok()) {
+                return absl::InternalError("failed to write spill file: " +
+                                           status.ToString());
+            }
+        }
+        SPDLOG_INFO("hash aggregate, depth: {}, groups: {}, spilled: {}",
+                    depth_, num_groups_, spilling_);
+    }
+
+    if (next_group_ < num_groups_) {
+        size_t end = std::min(next_group_ + static_cast<size_t>(kBatchRows),
+                              num_groups_);
+        auto batch = BuildBatch(next_group_, end);
+        next_group_ = end;
+        return batch;
+    }
+    return NextSpilled();
+}
+
+absl::Status HashAggregate::Consume(
+    const std::shared_ptr<arrow::RecordBatch>& batch) {
+    int64_t num_rows = batch->num_rows();
+    std::vector<int32_t> group_ids(num_rows, 0);
+    std::vector<uint64_t> hashes(num_rows, 0);
+    if (num_keys_ == 0) {
+        if (num_groups_ == 0) {
+            group_hashes_.push_back(0);
+            num_groups_ = 1;
+        }
+    } else {
+        for (int k = 0; k < num_keys_; k++) {
+            hash_column(*batch->column(k), &hashes);
+        }
+        FindGroups(*batch, hashes, &group_ids);
+    }
+
+    for (size_t i = 0; i < aggregates_.size(); i++) {
+        accumulators_[i]->Resize(num_groups_);
+        accumulators_[i]->Update(group_ids,
+                                 *batch->column(aggregates_[i].input));
+    }
+
+    if (spilling_) {
+        return Spill(batch, hashes, group_ids);
+    }
+
+    // new groups of the next batches go to disk, the groups already in
+    // memory keep aggregating in place
+    if (num_keys_ > 0 && depth_ < max_depth_ && Memory() > memory_limit_) {
+        SPDLOG_INFO("hash aggregate exceeds {} bytes with {} groups, spill",
+                    memory_limit_, num_groups_);
+        spilling_ = true;
+    }
+    return absl::OkStatus();
+}
+
+void HashAggregate::FindGroups(const arrow::RecordBatch& batch,
+                               const std::vector<uint64_t>& hashes,
+                               std::vector<int32_t>* group_ids) {
+    for (int64_t r = 0; r < batch.num_rows(); r++) {
+        // keep the load under 1/2 so probe sequences stay short
+        if ((num_groups_ + 1) * 2 > slots_.size()) {
+            Grow();
+        }
+        uint64_t hash = hashes[r];
+        size_t mask = slots_.size() - 1;
+        size_t slot = hash & mask;
+        while (true) {
+            int32_t group_id = slots_[slot];
+            if (group_id == -1) {
+                if (!spilling_) {
+                    group_id = AddGroup(batch, r, hash);
+                    slots_[slot] = group_id;
+                }
+                (*group_ids)[r] = group_id;
+                break;
+            }
+            if (group_hashes_[group_id] == hash &&
+                KeysEqual(group_id, batch, r)) {
+                (*group_ids)[r] = group_id;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+}
+
+bool HashAggregate::KeysEqual(int32_t group_id,
+                              const arrow::RecordBatch& batch,
+                              int64_t row) const {
+    for (int k = 0; k < num_keys_; k++) {
+        const auto& key = keys_[k];
+        const auto& array = *batch.column(k);
+        bool is_null = array.IsNull(row);
+        if (is_null != static_cast<bool>(key.nulls[group_id])) {
+            return false;
+        }
+        if (is_null) {
+            continue;
+        }
+        if (key.type == small::type::Type::Int64) {
+            auto value =
+                static_cast<const arrow::Int64Array&>(array).Value(row);
+            if (key.ints[group_id] != value) {
+                return false;
+            }
+        } else {
+            auto value =
+                static_cast<const arrow::StringArray&>(array).GetView(row);
+            if (key.strings[group_id] != value) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int32_t HashAggregate::AddGroup(const arrow::RecordBatch& batch, int64_t row,
+                                uint64_t hash) {
+    for (int k = 0; k < num_keys_; k++) {
+        auto& key = keys_[k];
+        const auto& array = *batch.column(k);
+        bool is_null = array.IsNull(row);
+        key.nulls.push_back(is_null);
+        if (key.type == small::type::Type::Int64) {
+            const auto& ints = static_cast<const arrow::Int64Array&>(array);
+            key.ints.push_back(is_null ? 0 : ints.Value(row));
+        } else {
+            const auto& strings = static_cast<const arrow::StringArray&>(array);
+            key.strings.emplace_back(is_null ? std::string_view()
+                                             : strings.GetView(row));
+            key_bytes_ += key.strings.back().size();
+        }
+    }
+    group_hashes_.push_back(hash);
+    return static_cast<int32_t>(num_groups_++);
+}
+
+void HashAggregate::Grow() {
+    slots_.assign(slots_.size() * 2, -1);
+    size_t mask = slots_.size() - 1;
+    for (size_t g = 0; g < num_groups_; g++) {
+        size_t slot = group_hashes_[g] & mask;
+        while (slots_[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = static_cast<int32_t>(g);
+    }
+}
+
+int64_t HashAggregate::Memory() const {
+    int64_t bytes = slots_.capacity() * sizeof(int32_t) +
+                    group_hashes_.capacity() * sizeof(uint64_t) + key_bytes_;
+    for (const auto& key : keys_) {
+        bytes += key.ints.capacity() * sizeof(int64_t) +
+                 key.strings.capacity() * sizeof(std::string) +
+                 key.nulls.capacity();
+    }
+    for (const auto& accumulator : accumulators_) {
+        bytes += accumulator->memory();
+    }
+    return bytes;
+}
+
+absl::Status HashAggregate::Spill(
+    const std::shared_ptr<arrow::RecordBatch>& batch,
+    const std::vector<uint64_t>& hashes,
+    const std::vector<int32_t>& group_ids) {
+    int shift = 64 - kPartitionBits * (depth_ + 1);
+    std::vector<arrow::Int32Builder> indices(kNumPartitions);
+    for (int64_t r = 0; r < batch->num_rows(); r++) {
+        if (group_ids[r] != -1) {
+            continue;
+        }
+        auto status = indices[(hashes[r] >> shift) & (kNumPartitions - 1)]
+                          .Append(static_cast<int32_t>(r));
+        if (!status.ok()) {
+            return absl::InternalError(status.ToString());
+        }
+    }
+
+    if (partitions_.empty()) {
+        partitions_.resize(kNumPartitions);
+    }
+    for (int p = 0; p < kNumPartitions; p++) {
+        if (indices[p].length() == 0) {
+            continue;
+        }
+        auto& partition = partitions_[p];
+        if (!partition.writer) {
+            auto status = OpenPartition(&partition, batch->schema());
+            if (!status.ok()) {
+                return status;
+            }
+        }
+
+        auto rows = indices[p].Finish();
+        std::shared_ptr<arrow::RecordBatch> spilled;
+        arrow::Status status = rows.status();
+        if (status.ok()) {
+            auto taken = arrow::compute::Take(batch, rows.ValueOrDie());
+            status = taken.status();
+            if (status.ok()) {
+                spilled = taken.ValueOrDie().record_batch();
+            }
+        }
+        if (status.ok()) {
+            status = partition.writer->WriteRecordBatch(*spilled);
+        }
+        if (!status.ok()) {
+            return absl::InternalError("failed to write spill file: " +
+                                       status.ToString());
+        }
+    }
+    return absl::OkStatus();
+}
+
+absl::Status HashAggregate::OpenPartition(
+    Partition* partition, const std::shared_ptr<arrow::Schema>& schema) {
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        return absl::InternalError("failed to get server info");
+    }
+    auto dir = std::filesystem::path(info.value()->db_path) / "spill";
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        return absl::InternalError("failed to create spill directory: " +
+                                   ec.message());
+    }
+    partition->path = (dir / absl::StrFormat("aggregate-%d.arrow",
+                                             spill_sequence++))
+                          .string();
+
+    auto file = arrow::io::FileOutputStream::Open(partition->path);
+    if (!file.ok()) {
+        return absl::InternalError("failed to create spill file: " +
+                                   file.status().ToString());
+    }
+    partition->file = file.ValueOrDie();
+    auto writer = arrow::ipc::MakeStreamWriter(partition->file, schema);
+    if (!writer.ok()) {
+        return absl::InternalError("failed to create spill writer: " +
+                                   writer.status().ToString());
+    }
+    partition->writer = writer.ValueOrDie();
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> HashAggregate::BuildBatch(
+    size_t begin, size_t end) {
+    arrow::ArrayVector arrays;
+    for (const auto& key : keys_) {
+        std::shared_ptr<arrow::Array> array;
+        arrow::Status status;
+        if (key.type == small::type::Type::Int64) {
+            arrow::Int64Builder builder;
+            for (size_t g = begin; g < end && status.ok(); g++) {
+                status = key.nulls[g] ? builder.AppendNull()
+                                      : builder.Append(key.ints[g]);
+            }
+            if (status.ok()) {
+                status = builder.Finish(&array);
+            }
+        } else {
+            arrow::StringBuilder builder;
+            for (size_t g = begin; g < end && status.ok(); g++) {
+                status = key.nulls[g] ? builder.AppendNull()
+                                      : builder.Append(key.strings[g]);
+            }
+            if (status.ok()) {
+                status = builder.Finish(&array);
+            }
+        }
+        if (!status.ok()) {
+            return absl::InternalError(status.ToString());
+        }
+        arrays.push_back(array);
+    }
+
+    for (auto& accumulator : accumulators_) {
+        auto array = accumulator->Finish(begin, end);
+        if (!array.ok()) {
+            return array.status();
+        }
+        arrays.push_back(array.value());
+    }
+    return arrow::RecordBatch::Make(schema_, end - begin, arrays);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>>
+HashAggregate::NextSpilled() {
+    while (true) {
+        if (partition_aggregate_) {
+            auto batch = partition_aggregate_->Next();
+            if (!batch.ok() || batch.value() != nullptr) {
+                return batch;
+            }
+            partition_aggregate_.reset();
+        }
+
+        if (next_partition_ >= partitions_.size()) {
+            return std::shared_ptr<arrow::RecordBatch>();
+        }
+        auto& partition = partitions_[next_partition_++];
+        if (partition.path.empty()) {
+            continue;
+        }
+
+        // the groups of a partition are disjoint from the groups in memory
+        // and of the other partitions
+        auto reader = SpillReader::Open(partition.path);
+        if (!reader.ok()) {
+            return reader.status();
+        }
+        auto child = Make(std::move(reader.value()), num_keys_, aggregates_,
+                          memory_limit_, max_depth_);
+        if (!child.ok()) {
+            return child.status();
+        }
+        child.value()->depth_ = depth_ + 1;
+        partition_aggregate_ = std::move(child.value());
+    }
+}
+
+}  // namespace query
@@ -0,0 +1,218 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+#include "arrow/io/file.h"
+#include "arrow/ipc/api.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/query/pipeline.h"
+#include "src/type/type.h"
+
+namespace query {
+
+// Memory budget of the groups of a hash aggregation, beyond it the rows of new
+// groups are spilled to disk.
+constexpr int64_t kAggregateMemoryLimit = 256 << 20;
+
+// Levels of recursion of the spilled partitions, the partitions of the last
+// level are aggregated in memory whatever their size.
+constexpr int kAggregateMaxDepth = 8;
+
+// An aggregate function of a SELECT.
+class Aggregate {
+   public:
+    enum class Kind {
+        CountStar,
+        Count,
+        Sum,
+        Avg,
+        Min,
+        Max,
+    };
+
+    Kind kind;
+
+    // index of the argument in the input batches, unused by COUNT(*)
+    int input = 0;
+
+    // name of the output column
+    std::string name;
+};
+
+// Return the kind of the aggregate function (e.g. "count"), or std::nullopt
+// if it isn't one.
+std::optional<Aggregate::Kind> get_aggregate_kind(const std::string& name,
+                                                  bool star);
+
+// The state of an aggregate for every group, specialized by the type of the
+// argument.
+class Accumulator {
+   public:
+    virtual ~Accumulator() = default;
+
+    // Make room for "num_groups" groups, new groups start empty.
+    virtual void Resize(size_t num_groups) = 0;
+
+    // Add the rows of the argument to their groups, rows of group -1 are
+    // skipped.
+    virtual void Update(const std::vector<int32_t>& group_ids,
+                        const arrow::Array& input) = 0;
+
+    // Build the results of the groups [begin, end).
+    virtual absl::StatusOr<std::shared_ptr<arrow::Array>> Finish(
+        size_t begin, size_t end) = 0;
+
+    // Approximate bytes of the states.
+    virtual int64_t memory() const = 0;
+};
+
+// Return an accumulator of the aggregate for arguments of "type".
+absl::StatusOr<std::unique_ptr<Accumulator>> make_accumulator(
+    Aggregate::Kind kind, small::type::Type type);
+
+// Return the type of the results of the aggregate.
+small::type::Type get_result_type(Aggregate::Kind kind, small::type::Type type);
+
+// Hash aggregation of the input batches: the first "num_keys" columns are the
+// group keys (no key means a single group), the aggregates read the other
+// columns. The output batches hold the keys then the aggregates.
+//
+// Rows are hashed a column at a time into an open-addressing table of group
+// IDs, then every accumulator adds a whole batch to its groups. Once the
+// groups exceed "memory_limit", rows of groups not in the table are
+// partitioned by hash into spill files, each partition is aggregated by
+// another HashAggregate after the groups in memory are produced, down to
+// "max_depth" levels.
+class HashAggregate : public Operator {
+   public:
+    static absl::StatusOr<std::unique_ptr<HashAggregate>> Make(
+        std::unique_ptr<Operator> input, int num_keys,
+        const std::vector<Aggregate>& aggregates,
+        int64_t memory_limit = kAggregateMemoryLimit,
+        int max_depth = kAggregateMaxDepth);
+
+    ~HashAggregate() override;
+
+    std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+   private:
+    HashAggregate() = default;
+
+    // A column of the group keys, indexed by group ID.
+    class KeyColumn {
+       public:
+        small::type::Type type;
+        std::vector<int64_t> ints;
+        std::vector<std::string> strings;
+        std::vector<uint8_t> nulls;
+    };
+
+    // A partition of the spilled rows.
+    class Partition {
+       public:
+        std::string path;
+        std::shared_ptr<arrow::io::FileOutputStream> file;
+        std::shared_ptr<arrow::ipc::RecordBatchWriter> writer;
+    };
+
+    std::unique_ptr<Operator> input_;
+    int num_keys_ = 0;
+    std::vector<Aggregate> aggregates_;
+    int64_t memory_limit_ = 0;
+    int max_depth_ = 0;
+
+    // level of recursion, partitions of a level are split by other bits of
+    // the hashes
+    int depth_ = 0;
+
+    std::shared_ptr<arrow::Schema> schema_;
+
+    std::vector<KeyColumn> keys_;
+    std::vector<std::unique_ptr<Accumulator>> accumulators_;
+    std::vector<uint64_t> group_hashes_;
+    size_t num_groups_ = 0;
+    int64_t key_bytes_ = 0;
+
+    // open addressing with linear probing, group ID or -1
+    std::vector<int32_t> slots_;
+
+    // set once the groups exceed the memory limit
+    bool spilling_ = false;
+    std::vector<Partition> partitions_;
+
+    bool consumed_ = false;
+    size_t next_group_ = 0;
+    size_t next_partition_ = 0;
+    std::unique_ptr<HashAggregate> partition_aggregate_;
+
+    absl::Status Consume(const std::shared_ptr<arrow::RecordBatch>& batch);
+
+    // Find or add the group of every row, -1 for the rows to spill.
+    void FindGroups(const arrow::RecordBatch& batch,
+                    const std::vector<uint64_t>& hashes,
+                    std::vector<int32_t>* group_ids);
+
+    bool KeysEqual(int32_t group_id, const arrow::RecordBatch& batch,
+                   int64_t row) const;
+
+    int32_t AddGroup(const arrow::RecordBatch& batch, int64_t row,
+                     uint64_t hash);
+
+    void Grow();
+
+    int64_t Memory() const;
+
+    // Append the rows of group -1 to the partitions of their hashes.
+    absl::Status Spill(const std::shared_ptr<arrow::RecordBatch>& batch,
+                       const std::vector<uint64_t>& hashes,
+                       const std::vector<int32_t>& group_ids);
+
+    // Create the spill file of a partition under "<db_path>/spill".
+    absl::Status OpenPartition(Partition* partition,
+                               const std::shared_ptr<arrow::Schema>& schema);
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> BuildBatch(
+        size_t begin, size_t end);
+
+    // Pull the next batch of the spilled partitions.
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> NextSpilled();
+};
+
+}  // namespace query
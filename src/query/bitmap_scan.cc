@@ -0,0 +1,337 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <exception>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// rocksdb
+#include "rocksdb/db.h"
+#include "rocksdb/write_batch.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/bitmap/bitmap.h"
+#include "src/columnar/row_batch.h"
+#include "src/encode/encode.h"
+#include "src/query/predicate.h"
+#include "src/query/scan.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/bitmap_scan.h"
+
+namespace query {
+
+namespace {
+
+// Containers written to the index in a single batch during a backfill, a
+// container takes at most 8KB.
+constexpr int kBackfillBatchContainers = 1024;
+
+using BitmapResult = absl::StatusOr<std::optional<small::bitmap::Bitmap>>;
+
+// Return the bitmap index on the column, or nullptr.
+const small::schema::Index* find_bitmap_index(const small::schema::Table& table,
+                                              int column_index) {
+    int64_t column_id = table.columns[column_index].id;
+    for (const auto& index : table.indexes) {
+        if (index.method == small::schema::Index::Method::Bitmap &&
+            index.column_ids[0] == column_id) {
+            return &index;
+        }
+    }
+    return nullptr;
+}
+
+// Read the row IDs of a value, the containers of the value are stored
+// together.
+absl::StatusOr<small::bitmap::Bitmap> read_bitmap(
+    const small::schema::Index& index, const small::type::Datum& datum,
+    small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options) {
+    std::string prefix = small::rocks::table_prefix(index.id);
+    small::encode::encode_key(&prefix, datum);
+
+    small::bitmap::Bitmap bitmap;
+    bool corrupted = false;
+    auto visitor = [&](const rocksdb::Slice& key,
+                       const rocksdb::Slice& value) {
+        // the rest of the key is the big-endian high 48 bits of the row IDs
+        if (key.size() != prefix.size() + 6) {
+            corrupted = true;
+            return false;
+        }
+        uint64_t high = 0;
+        for (size_t i = prefix.size(); i < key.size(); i++) {
+            high = (high << 8) | static_cast<uint8_t>(key[i]);
+        }
+
+        small::bitmap::Container container;
+        if (!small::bitmap::Container::Deserialize(
+                std::string_view(value.data(), value.size()), &container)) {
+            corrupted = true;
+            return false;
+        }
+        bitmap.SetContainer(high, std::move(container));
+        return true;
+    };
+
+    try {
+        db->Scan("BitmapCF", prefix, small::rocks::prefix_successor(prefix),
+                 visitor, options);
+    } catch (const std::exception& e) {
+        SPDLOG_ERROR("bitmap scan failed: {}", e.what());
+        return absl::InternalError(std::string("bitmap scan failed: ") +
+                                   e.what());
+    }
+    if (corrupted) {
+        return absl::DataLossError("corrupted bitmap index: " + index.name);
+    }
+    return bitmap;
+}
+
+// Evaluate "<column> = <constant>" or "<column> IN (<constants>)".
+BitmapResult evaluate_a_expr(const small::schema::Table& table,
+                             PgQuery__AExpr* a_expr,
+                             small::rocks::RocksDBWrapper* db,
+                             const small::rocks::ScanOptions& options) {
+    // "IN" is named "=", "NOT IN" is named "<>"
+    if (a_expr->n_name != 1 || a_expr->lexpr == nullptr ||
+        a_expr->rexpr == nullptr ||
+        std::string(a_expr->name[0]->string->sval) != "=") {
+        return std::nullopt;
+    }
+
+    PgQuery__Node* column = a_expr->lexpr;
+    std::vector<PgQuery__Node*> constants;
+    if (a_expr->kind == PG_QUERY__A__EXPR__KIND__AEXPR_OP) {
+        PgQuery__Node* constant = a_expr->rexpr;
+        if (column->node_case == PG_QUERY__NODE__NODE_A_CONST) {
+            std::swap(column, constant);
+        }
+        constants.push_back(constant);
+    } else if (a_expr->kind == PG_QUERY__A__EXPR__KIND__AEXPR_IN &&
+               a_expr->rexpr->node_case == PG_QUERY__NODE__NODE_LIST) {
+        auto list = a_expr->rexpr->list;
+        constants.assign(list->items, list->items + list->n_items);
+    } else {
+        return std::nullopt;
+    }
+
+    int column_index = get_column_index(table, column);
+    if (column_index == -1) {
+        return std::nullopt;
+    }
+    auto index = find_bitmap_index(table, column_index);
+    if (index == nullptr) {
+        return std::nullopt;
+    }
+
+    std::vector<small::type::Datum> values;
+    for (auto constant : constants) {
+        auto value = get_constant(table, column_index, constant);
+        if (!value.has_value()) {
+            return std::nullopt;
+        }
+        values.push_back(std::move(value.value()));
+    }
+
+    small::bitmap::Bitmap result;
+    for (const auto& value : values) {
+        auto bitmap = read_bitmap(*index, value, db, options);
+        if (!bitmap.ok()) {
+            return bitmap.status();
+        }
+        result.UnionWith(bitmap.value());
+    }
+    return result;
+}
+
+BitmapResult evaluate(const small::schema::Table& table, PgQuery__Node* node,
+                      small::rocks::RocksDBWrapper* db,
+                      const small::rocks::ScanOptions& options) {
+    if (node->node_case == PG_QUERY__NODE__NODE_A_EXPR) {
+        return evaluate_a_expr(table, node->a_expr, db, options);
+    }
+    if (node->node_case != PG_QUERY__NODE__NODE_BOOL_EXPR) {
+        return std::nullopt;
+    }
+
+    auto bool_expr = node->bool_expr;
+    std::optional<small::bitmap::Bitmap> result;
+    switch (bool_expr->boolop) {
+        case PG_QUERY__BOOL_EXPR_TYPE__AND_EXPR:
+            for (int i = 0; i < bool_expr->n_args; i++) {
+                auto arg = evaluate(table, bool_expr->args[i], db, options);
+                if (!arg.ok()) {
+                    return arg.status();
+                }
+                if (!arg.value().has_value()) {
+                    continue;
+                }
+                if (result.has_value()) {
+                    result->IntersectWith(arg.value().value());
+                } else {
+                    result = std::move(arg.value());
+                }
+            }
+            return result;
+        case PG_QUERY__BOOL_EXPR_TYPE__OR_EXPR:
+            result.emplace();
+            for (int i = 0; i < bool_expr->n_args; i++) {
+                auto arg = evaluate(table, bool_expr->args[i], db, options);
+                if (!arg.ok()) {
+                    return arg.status();
+                }
+                if (!arg.value().has_value()) {
+                    return std::nullopt;
+                }
+                result->UnionWith(arg.value().value());
+            }
+            return result;
+        default:
+            return std::nullopt;
+    }
+}
+
+}  // namespace
+
+BitmapResult evaluate_bitmap(const small::schema::Table& table,
+                             PgQuery__Node* where_clause,
+                             small::rocks::RocksDBWrapper* db,
+                             const small::rocks::ScanOptions& options) {
+    if (where_clause == nullptr) {
+        return std::nullopt;
+    }
+    bool has_bitmap_index = false;
+    for (const auto& index : table.indexes) {
+        if (index.method == small::schema::Index::Method::Bitmap) {
+            has_bitmap_index = true;
+            break;
+        }
+    }
+    if (!has_bitmap_index) {
+        return std::nullopt;
+    }
+    return evaluate(table, where_clause, db, options);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> bitmap_scan(
+    const std::shared_ptr<small::schema::Table>& table,
+    const small::bitmap::Bitmap& row_ids, small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options) {
+    std::vector<small::type::Datum> pks;
+    pks.reserve(row_ids.Cardinality());
+    row_ids.ForEach([&](uint64_t row_id) {
+        pks.emplace_back(small::bitmap::to_pk(row_id));
+    });
+
+    small::columnar::RowBatchBuilder builder(*table, options.columns);
+    auto visitor = [&](size_t i, std::string_view row) {
+        return builder.Append(row);
+    };
+    auto status = lookup_rows(*table, pks, db, visitor, options);
+    if (!status.ok()) {
+        return status;
+    }
+
+    SPDLOG_INFO("bitmap scan, table: {}, row ids: {}, rows: {}", table->name,
+                pks.size(), builder.num_rows());
+    return builder.Finish();
+}
+
+absl::Status backfill_bitmap_index(
+    const std::shared_ptr<small::schema::Table>& table,
+    const small::schema::Index& index, small::rocks::RocksDBWrapper* db) {
+    int pk_index = table->get_pk_index();
+    auto rows = scan_table(table, pk_index, db);
+    if (!rows.ok()) {
+        return rows.status();
+    }
+
+    const auto& batch = *rows.value();
+    int column_index = table->get_column_index(index.column_ids[0]);
+    const auto& pks =
+        static_cast<const arrow::Int64Array&>(*batch.column(pk_index));
+    const auto& column = *batch.column(column_index);
+    auto type = table->columns[column_index].type;
+
+    // a NULL is equal to no value, so its rows are in no bitmap
+    std::map<small::type::Datum, small::bitmap::Bitmap> bitmaps;
+    for (int64_t r = 0; r < batch.num_rows(); r++) {
+        if (column.IsNull(r)) {
+            continue;
+        }
+        bitmaps[get_datum(column, r, type)].Add(
+            small::bitmap::to_row_id(pks.Value(r)));
+    }
+
+    rocksdb::WriteBatch write_batch;
+    for (const auto& [value, bitmap] : bitmaps) {
+        for (const auto& [high, container] : bitmap.containers()) {
+            db->Put(&write_batch, "BitmapCF",
+                    small::rocks::bitmap_key(index.id, value, high),
+                    container.Serialize());
+
+            if (write_batch.Count() >= kBackfillBatchContainers) {
+                if (!db->Write(&write_batch)) {
+                    return absl::InternalError(
+                        "failed to write bitmap containers");
+                }
+                write_batch.Clear();
+            }
+        }
+    }
+    if (write_batch.Count() > 0 && !db->Write(&write_batch)) {
+        return absl::InternalError("failed to write bitmap containers");
+    }
+
+    SPDLOG_INFO("backfilled bitmap index {} of table {}, rows: {}, values: {}",
+                index.name, table->name, batch.num_rows(), bitmaps.size());
+    return absl::OkStatus();
+}
+
+}  // namespace query
@@ -0,0 +1,75 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <memory>
+#include <optional>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/bitmap/bitmap.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+
+namespace query {
+
+// Evaluate the WHERE clause by the bitmap indexes of the table into the set of
+// matching row IDs: "=" and "IN" on an indexed column read the bitmaps of the
+// values, AND intersects them and OR unions them.
+//
+// Conditions of an AND without a bitmap index are skipped, so the result may
+// be a superset of the matching rows. An OR is only evaluated if all of its
+// arms are. Return std::nullopt if no bitmap index applies, "where_clause" may
+// be nullptr.
+absl::StatusOr<std::optional<small::bitmap::Bitmap>> evaluate_bitmap(
+    const small::schema::Table& table, PgQuery__Node* where_clause,
+    small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options = {});
+
+// Fetch the rows of the row IDs in a batched lookup, in row ID (primary key)
+// order. Use the snapshot the bitmaps are read from.
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> bitmap_scan(
+    const std::shared_ptr<small::schema::Table>& table,
+    const small::bitmap::Bitmap& row_ids, small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options = {});
+
+// Build the bitmaps of all existing rows of the table in memory and write
+// them to the index.
+absl::Status backfill_bitmap_index(
+    const std::shared_ptr<small::schema::Table>& table,
+    const small::schema::Index& index, small::rocks::RocksDBWrapper* db);
+
+}  // namespace query
@@ -0,0 +1,161 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// arrow gandiva
+#include "gandiva/condition.h"
+#include "gandiva/configuration.h"
+#include "gandiva/expression.h"
+#include "gandiva/filter.h"
+#include "gandiva/projector.h"
+#include "gandiva/selection_vector.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/expression_cache.h"
+
+namespace query {
+
+ExpressionCache* ExpressionCache::instancePtr = nullptr;
+
+void ExpressionCache::InitInstance() {
+    if (instancePtr == nullptr) {
+        instancePtr = new ExpressionCache();
+    } else {
+        SPDLOG_ERROR("expression cache instance already initialized");
+    }
+}
+
+ExpressionCache* ExpressionCache::GetInstance() {
+    if (instancePtr == nullptr) {
+        SPDLOG_ERROR("expression cache instance not initialized");
+        return nullptr;
+    }
+    return instancePtr;
+}
+
+ExpressionCache::Entry ExpressionCache::Lookup(const std::string& key) {
+    std::lock_guard lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        misses++;
+        return Entry();
+    }
+
+    hits++;
+    lru.splice(lru.begin(), lru, it->second.position);
+    return it->second;
+}
+
+void ExpressionCache::Insert(const std::string& key, Entry entry) {
+    std::lock_guard lock(mutex);
+
+    // compiled concurrently by another statement
+    if (entries.count(key) > 0) {
+        return;
+    }
+
+    lru.push_front(key);
+    entry.position = lru.begin();
+    entries.emplace(key, std::move(entry));
+    while (entries.size() > kCapacity) {
+        entries.erase(lru.back());
+        lru.pop_back();
+    }
+}
+
+absl::StatusOr<std::shared_ptr<gandiva::Filter>> ExpressionCache::GetFilter(
+    const arrow::SchemaPtr& schema, const gandiva::ConditionPtr& condition,
+    const std::shared_ptr<gandiva::Configuration>& configuration) {
+    // literals are part of the string of the condition
+    std::string key = "filter|" + schema->ToString() + "|" +
+                      condition->ToString() + "|" +
+                      std::to_string(configuration->Hash());
+    auto entry = Lookup(key);
+    if (entry.filter) {
+        return entry.filter;
+    }
+
+    // compile without the lock, other statements keep using the cache
+    auto status =
+        gandiva::Filter::Make(schema, condition, configuration, &entry.filter);
+    if (!status.ok()) {
+        SPDLOG_ERROR("filter make failed: {}", status.ToString());
+        return absl::InvalidArgumentError("invalid condition: " +
+                                          status.ToString());
+    }
+    Insert(key, entry);
+    return entry.filter;
+}
+
+absl::StatusOr<std::shared_ptr<gandiva::Projector>>
+ExpressionCache::GetProjector(
+    const arrow::SchemaPtr& schema,
+    const gandiva::ExpressionVector& expressions,
+    gandiva::SelectionVector::Mode mode,
+    const std::shared_ptr<gandiva::Configuration>& configuration) {
+    // the names of the output fields are not part of the expressions
+    std::string key = "projector|" + schema->ToString() + "|" +
+                      std::to_string(mode) + "|";
+    for (const auto& expression : expressions) {
+        key += expression->result()->ToString() + " = " +
+               expression->ToString() + ";";
+    }
+    key += "|" + std::to_string(configuration->Hash());
+    auto entry = Lookup(key);
+    if (entry.projector) {
+        return entry.projector;
+    }
+
+    auto status = gandiva::Projector::Make(schema, expressions, mode,
+                                           configuration, &entry.projector);
+    if (!status.ok()) {
+        SPDLOG_ERROR("projector make failed: {}", status.ToString());
+        return absl::InternalError("projector make failed: " +
+                                   status.ToString());
+    }
+    Insert(key, entry);
+    return entry.projector;
+}
+
+size_t ExpressionCache::size() {
+    std::lock_guard lock(mutex);
+    return entries.size();
+}
+
+}  // namespace query
@@ -0,0 +1,125 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// arrow gandiva
+#include "gandiva/condition.h"
+#include "gandiva/configuration.h"
+#include "gandiva/expression.h"
+#include "gandiva/filter.h"
+#include "gandiva/projector.h"
+#include "gandiva/selection_vector.h"
+
+namespace query {
+
+// Cache of compiled gandiva filters and projectors, shared by all statements.
+// Compiling an expression tree with LLVM takes milliseconds, a cached
+// filter or projector is reused by every statement with the same input
+// schema, expressions (literals included) and configuration. Filters and
+// projectors are stateless once compiled, so they are evaluated concurrently.
+//
+// The least recently used entries are evicted beyond "kCapacity" entries.
+class ExpressionCache {
+   private:
+    // singleton instance - the only instance
+    static ExpressionCache* instancePtr;
+
+    // singleton instance - constructor protector
+    ExpressionCache() = default;
+
+    // singleton instance - destructor protector
+    ~ExpressionCache() = default;
+
+    static constexpr size_t kCapacity = 1024;
+
+    class Entry {
+       public:
+        std::shared_ptr<gandiva::Filter> filter;
+        std::shared_ptr<gandiva::Projector> projector;
+
+        // position in "lru"
+        std::list<std::string>::iterator position;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+
+    // keys, the most recently used first
+    std::list<std::string> lru;
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+    // Return the cached entry of the key (and mark it used), or an empty one.
+    Entry Lookup(const std::string& key);
+
+    void Insert(const std::string& key, Entry entry);
+
+   public:
+    // singleton instance - assignment-blocker
+    void operator=(const ExpressionCache&) = delete;
+
+    // singleton instance - copy-blocker
+    ExpressionCache(const ExpressionCache&) = delete;
+
+    // singleton instance - get api
+    static ExpressionCache* GetInstance();
+
+    // singleton instance - init api
+    static void InitInstance();
+
+    // Return the filter of the condition over batches of the schema, compile
+    // it on a miss.
+    absl::StatusOr<std::shared_ptr<gandiva::Filter>> GetFilter(
+        const arrow::SchemaPtr& schema, const gandiva::ConditionPtr& condition,
+        const std::shared_ptr<gandiva::Configuration>& configuration);
+
+    // Return the projector of the expressions over batches of the schema,
+    // compile it on a miss.
+    absl::StatusOr<std::shared_ptr<gandiva::Projector>> GetProjector(
+        const arrow::SchemaPtr& schema,
+        const gandiva::ExpressionVector& expressions,
+        gandiva::SelectionVector::Mode mode,
+        const std::shared_ptr<gandiva::Configuration>& configuration);
+
+    uint64_t num_hits() const { return hits; }
+
+    uint64_t num_misses() const { return misses; }
+
+    size_t size();
+};
+
+}  // namespace query
@@ -0,0 +1,349 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// arrow gandiva
+#include "gandiva/condition.h"
+#include "gandiva/configuration.h"
+#include "gandiva/filter.h"
+#include "gandiva/selection_vector.h"
+#include "gandiva/tree_expr_builder.h"
+
+// magic_enum
+#include "magic_enum/magic_enum.hpp"
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/query/expression_cache.h"
+#include "src/query/predicate.h"
+#include "src/schema/schema.h"
+#include "src/semantics/extract.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/filter.h"
+
+namespace query {
+
+namespace {
+
+// gandiva functions of the binary operators, "~~" is LIKE
+const std::unordered_map<std::string, std::string> kComparisons = {
+    {"=", "equal"},
+    {"<>", "not_equal"},
+    {"<", "less_than"},
+    {"<=", "less_than_or_equal_to"},
+    {">", "greater_than"},
+    {">=", "greater_than_or_equal_to"},
+    {"~~", "like"},
+};
+
+const std::unordered_map<std::string, std::string> kArithmetics = {
+    {"+", "add"},
+    {"-", "subtract"},
+    {"*", "multiply"},
+    {"/", "divide"},
+    {"%", "mod"},
+};
+
+absl::Status unsupported(PgQuery__Node* node) {
+    return absl::InvalidArgumentError(
+        "unsupported condition: " +
+        std::string(magic_enum::enum_name(node->node_case)));
+}
+
+absl::StatusOr<gandiva::NodePtr> make_node(const small::schema::Table& table,
+                                           const arrow::SchemaPtr& schema,
+                                           PgQuery__Node* node,
+                                           std::vector<int>* columns);
+
+absl::StatusOr<gandiva::NodePtr> make_constant(PgQuery__Node* node) {
+    auto value = small::semantics::extract_const(node->a_const);
+    if (!value.has_value()) {
+        return unsupported(node);
+    }
+    if (std::holds_alternative<int64_t>(value.value())) {
+        return gandiva::TreeExprBuilder::MakeLiteral(
+            std::get<int64_t>(value.value()));
+    }
+    return gandiva::TreeExprBuilder::MakeStringLiteral(
+        std::get<std::string>(value.value()));
+}
+
+// "<expr> [NOT] IN (<constant>, ...)", the constants must have the type of
+// the expression.
+absl::StatusOr<gandiva::NodePtr> make_in(const small::schema::Table& table,
+                                         const arrow::SchemaPtr& schema,
+                                         PgQuery__AExpr* a_expr,
+                                         std::vector<int>* columns) {
+    auto lhs = make_node(table, schema, a_expr->lexpr, columns);
+    if (!lhs.ok()) {
+        return lhs.status();
+    }
+    bool is_int = lhs.value()->return_type()->id() == arrow::Type::INT64;
+
+    std::unordered_set<int64_t> ints;
+    std::unordered_set<std::string> strings;
+    auto list = a_expr->rexpr->list;
+    for (int i = 0; i < list->n_items; i++) {
+        auto item = list->items[i];
+        if (item->node_case != PG_QUERY__NODE__NODE_A_CONST) {
+            return unsupported(item);
+        }
+        auto value = small::semantics::extract_const(item->a_const);
+        if (!value.has_value() ||
+            std::holds_alternative<int64_t>(value.value()) != is_int) {
+            return absl::InvalidArgumentError(
+                "IN list doesn't match the type of the expression");
+        }
+        if (is_int) {
+            ints.insert(std::get<int64_t>(value.value()));
+        } else {
+            strings.insert(std::get<std::string>(value.value()));
+        }
+    }
+
+    auto in = is_int ? gandiva::TreeExprBuilder::MakeInExpressionInt64(
+                           lhs.value(), ints)
+                     : gandiva::TreeExprBuilder::MakeInExpressionString(
+                           lhs.value(), strings);
+    // "IN" is named "=", "NOT IN" is named "<>"
+    if (std::string(a_expr->name[0]->string->sval) == "<>") {
+        return gandiva::TreeExprBuilder::MakeFunction("not", {in},
+                                                      arrow::boolean());
+    }
+    return in;
+}
+
+absl::StatusOr<gandiva::NodePtr> make_a_expr(const small::schema::Table& table,
+                                             const arrow::SchemaPtr& schema,
+                                             PgQuery__Node* node,
+                                             std::vector<int>* columns) {
+    auto a_expr = node->a_expr;
+    if (a_expr->n_name != 1 || a_expr->rexpr == nullptr) {
+        return unsupported(node);
+    }
+    if (a_expr->kind == PG_QUERY__A__EXPR__KIND__AEXPR_IN &&
+        a_expr->rexpr->node_case == PG_QUERY__NODE__NODE_LIST) {
+        return make_in(table, schema, a_expr, columns);
+    }
+    if (a_expr->kind != PG_QUERY__A__EXPR__KIND__AEXPR_OP &&
+        a_expr->kind != PG_QUERY__A__EXPR__KIND__AEXPR_LIKE) {
+        return unsupported(node);
+    }
+
+    std::string op = a_expr->name[0]->string->sval;
+    auto rhs = make_node(table, schema, a_expr->rexpr, columns);
+    if (!rhs.ok()) {
+        return rhs.status();
+    }
+
+    // unary minus
+    if (a_expr->lexpr == nullptr) {
+        if (op != "-") {
+            return unsupported(node);
+        }
+        return gandiva::TreeExprBuilder::MakeFunction(
+            "subtract",
+            {gandiva::TreeExprBuilder::MakeLiteral(int64_t(0)), rhs.value()},
+            rhs.value()->return_type());
+    }
+
+    auto lhs = make_node(table, schema, a_expr->lexpr, columns);
+    if (!lhs.ok()) {
+        return lhs.status();
+    }
+
+    // "!~~" is NOT LIKE
+    bool negated = op == "!~~";
+    if (negated) {
+        op = "~~";
+    }
+    gandiva::NodePtr result;
+    auto comparison = kComparisons.find(op);
+    auto arithmetic = kArithmetics.find(op);
+    if (comparison != kComparisons.end()) {
+        result = gandiva::TreeExprBuilder::MakeFunction(
+            comparison->second, {lhs.value(), rhs.value()}, arrow::boolean());
+    } else if (arithmetic != kArithmetics.end()) {
+        result = gandiva::TreeExprBuilder::MakeFunction(
+            arithmetic->second, {lhs.value(), rhs.value()},
+            lhs.value()->return_type());
+    } else {
+        return absl::InvalidArgumentError("unsupported operator: " + op);
+    }
+    if (negated) {
+        return gandiva::TreeExprBuilder::MakeFunction("not", {result},
+                                                      arrow::boolean());
+    }
+    return result;
+}
+
+absl::StatusOr<gandiva::NodePtr> make_bool_expr(
+    const small::schema::Table& table, const arrow::SchemaPtr& schema,
+    PgQuery__BoolExpr* bool_expr, std::vector<int>* columns) {
+    gandiva::NodeVector args;
+    for (int i = 0; i < bool_expr->n_args; i++) {
+        auto arg = make_node(table, schema, bool_expr->args[i], columns);
+        if (!arg.ok()) {
+            return arg.status();
+        }
+        args.push_back(arg.value());
+    }
+
+    switch (bool_expr->boolop) {
+        case PG_QUERY__BOOL_EXPR_TYPE__AND_EXPR:
+            return gandiva::TreeExprBuilder::MakeAnd(args);
+        case PG_QUERY__BOOL_EXPR_TYPE__OR_EXPR:
+            return gandiva::TreeExprBuilder::MakeOr(args);
+        case PG_QUERY__BOOL_EXPR_TYPE__NOT_EXPR:
+            return gandiva::TreeExprBuilder::MakeFunction("not", args,
+                                                          arrow::boolean());
+        default:
+            return absl::InvalidArgumentError(
+                "unsupported boolean expression: " +
+                std::string(magic_enum::enum_name(bool_expr->boolop)));
+    }
+}
+
+absl::StatusOr<gandiva::NodePtr> make_node(const small::schema::Table& table,
+                                           const arrow::SchemaPtr& schema,
+                                           PgQuery__Node* node,
+                                           std::vector<int>* columns) {
+    switch (node->node_case) {
+        case PG_QUERY__NODE__NODE_COLUMN_REF: {
+            int index = get_column_index(table, node);
+            if (index == -1) {
+                return absl::InvalidArgumentError(
+                    "column not found in the condition");
+            }
+            columns->push_back(index);
+            return gandiva::TreeExprBuilder::MakeField(schema->field(index));
+        }
+        case PG_QUERY__NODE__NODE_A_CONST:
+            return make_constant(node);
+        case PG_QUERY__NODE__NODE_A_EXPR:
+            return make_a_expr(table, schema, node, columns);
+        case PG_QUERY__NODE__NODE_BOOL_EXPR:
+            return make_bool_expr(table, schema, node->bool_expr, columns);
+        case PG_QUERY__NODE__NODE_NULL_TEST: {
+            auto null_test = node->null_test;
+            auto arg = make_node(table, schema, null_test->arg, columns);
+            if (!arg.ok()) {
+                return arg.status();
+            }
+            bool is_null = null_test->nulltesttype ==
+                           PG_QUERY__NULL_TEST_TYPE__IS_NULL;
+            return gandiva::TreeExprBuilder::MakeFunction(
+                is_null ? "isnull" : "isnotnull", {arg.value()},
+                arrow::boolean());
+        }
+        default:
+            return unsupported(node);
+    }
+}
+
+}  // namespace
+
+absl::StatusOr<gandiva::NodePtr> make_expression(
+    const small::schema::Table& table, const arrow::SchemaPtr& schema,
+    PgQuery__Node* node, std::vector<int>* columns) {
+    return make_node(table, schema, node, columns);
+}
+
+absl::StatusOr<gandiva::ConditionPtr> make_condition(
+    const small::schema::Table& table, const arrow::SchemaPtr& schema,
+    PgQuery__Node* where_clause, std::vector<int>* columns) {
+    if (where_clause == nullptr) {
+        return gandiva::ConditionPtr();
+    }
+    auto root = make_expression(table, schema, where_clause, columns);
+    if (!root.ok()) {
+        return root.status();
+    }
+    return gandiva::TreeExprBuilder::MakeCondition(root.value());
+}
+
+absl::StatusOr<std::shared_ptr<gandiva::Filter>> make_filter(
+    const arrow::SchemaPtr& schema, const gandiva::ConditionPtr& condition) {
+    auto configuration = gandiva::ConfigurationBuilder::DefaultConfiguration();
+    auto cache = ExpressionCache::GetInstance();
+    if (cache) {
+        return cache->GetFilter(schema, condition, configuration);
+    }
+
+    std::shared_ptr<gandiva::Filter> filter;
+    auto status =
+        gandiva::Filter::Make(schema, condition, configuration, &filter);
+    if (!status.ok()) {
+        SPDLOG_ERROR("filter make failed: {}", status.ToString());
+        return absl::InvalidArgumentError("invalid condition: " +
+                                          status.ToString());
+    }
+    return filter;
+}
+
+absl::StatusOr<std::shared_ptr<gandiva::SelectionVector>> filter_batch(
+    gandiva::Filter* filter, const arrow::RecordBatch& batch) {
+    std::shared_ptr<gandiva::SelectionVector> selection;
+    auto status = gandiva::SelectionVector::MakeInt32(
+        batch.num_rows(), arrow::default_memory_pool(), &selection);
+    if (!status.ok()) {
+        return absl::InternalError("selection vector make failed: " +
+                                   status.ToString());
+    }
+
+    // errors of the evaluation, e.g. a division by zero
+    status = filter->Evaluate(batch, selection);
+    if (!status.ok()) {
+        SPDLOG_ERROR("filter evaluate failed: {}", status.ToString());
+        return absl::InvalidArgumentError("filter evaluate failed: " +
+                                          status.ToString());
+    }
+    return selection;
+}
+
+}  // namespace query
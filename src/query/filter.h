@@ -0,0 +1,81 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <memory>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// arrow gandiva
+#include "gandiva/condition.h"
+#include "gandiva/filter.h"
+#include "gandiva/node.h"
+#include "gandiva/selection_vector.h"
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/schema/schema.h"
+
+namespace query {
+
+// Translate an expression into a gandiva node over the batches of the table,
+// see "make_condition" for what is supported. Append the indexes of the
+// referenced columns to "columns".
+absl::StatusOr<gandiva::NodePtr> make_expression(
+    const small::schema::Table& table, const arrow::SchemaPtr& schema,
+    PgQuery__Node* node, std::vector<int>* columns);
+
+// Translate the WHERE clause into a gandiva condition over the batches of the
+// table ("schema", see "small::columnar::get_arrow_schema"). Supported are
+// comparisons, +, -, *, / and % of ints, [NOT] LIKE, [NOT] IN of constants,
+// IS [NOT] NULL, AND, OR and NOT over columns and constants.
+//
+// Append the indexes of the columns referenced by the clause to "columns".
+// Return nullptr if "where_clause" is nullptr.
+absl::StatusOr<gandiva::ConditionPtr> make_condition(
+    const small::schema::Table& table, const arrow::SchemaPtr& schema,
+    PgQuery__Node* where_clause, std::vector<int>* columns);
+
+// Compile the condition into JIT code for batches of the schema, or get it
+// from "ExpressionCache". The signatures of the functions (e.g.
+// "int = string") are checked here.
+absl::StatusOr<std::shared_ptr<gandiva::Filter>> make_filter(
+    const arrow::SchemaPtr& schema, const gandiva::ConditionPtr& condition);
+
+// Evaluate the filter over the batch, return the indexes of the matching rows
+// (mode "SelectionVector::MODE_UINT32").
+absl::StatusOr<std::shared_ptr<gandiva::SelectionVector>> filter_batch(
+    gandiva::Filter* filter, const arrow::RecordBatch& batch);
+
+}  // namespace query
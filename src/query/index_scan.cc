@@ -0,0 +1,324 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+
+// rocksdb
+#include "rocksdb/db.h"
+#include "rocksdb/write_batch.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/columnar/row_batch.h"
+#include "src/encode/encode.h"
+#include "src/query/bitmap_scan.h"
+#include "src/query/predicate.h"
+#include "src/query/scan.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/index_scan.h"
+
+namespace query {
+
+namespace {
+
+// Entries written to the index in a single batch during a backfill.
+constexpr int kBackfillBatchRows = 10000;
+
+// Return true if "p" is a tighter lower (upper) bound than "current".
+bool tighter(const Predicate& p, const Predicate& current, bool lower) {
+    if (p.value == current.value) {
+        // an exclusive bound is tighter than an inclusive one
+        return p.op.size() == 1;
+    }
+    return lower ? current.value < p.value : p.value < current.value;
+}
+
+// Fetch the rows of the primary keys found in the index, rows whose key
+// columns no longer match the entry are skipped.
+absl::Status fetch_rows(const small::schema::Table& table,
+                        const small::schema::Index& index,
+                        const std::vector<small::type::Datum>& pks,
+                        const std::vector<std::vector<small::type::Datum>>&
+                            entry_keys,
+                        small::rocks::RocksDBWrapper* db,
+                        const small::rocks::ScanOptions& options,
+                        small::columnar::RowBatchBuilder* builder) {
+    auto visitor = [&](size_t i, std::string_view row) {
+        auto row_values = small::rocks::decode_row(table, row);
+        for (size_t k = 0; k < index.column_ids.size(); k++) {
+            int column = table.get_column_index(index.column_ids[k]);
+            if (row_values[column] != entry_keys[i][k]) {
+                return absl::OkStatus();
+            }
+        }
+        return builder->Append(row);
+    };
+    return lookup_rows(table, pks, db, visitor, options);
+}
+
+}  // namespace
+
+std::optional<IndexScan> plan_index_scan(
+    const small::schema::Table& table,
+    const std::vector<Predicate>& predicates) {
+    std::optional<IndexScan> best;
+    int best_score = 0;
+    for (const auto& index : table.indexes) {
+        if (index.method != small::schema::Index::Method::BTree) {
+            continue;
+        }
+
+        IndexScan scan;
+        scan.index = &index;
+
+        // entries of the index start with the varint index ID
+        std::string prefix = small::rocks::table_prefix(index.id);
+
+        // equality on the leading key columns
+        for (int64_t column_id : index.column_ids) {
+            int column = table.get_column_index(column_id);
+            const Predicate* eq = nullptr;
+            for (const auto& p : predicates) {
+                if (p.column_index == column && p.op == "=") {
+                    eq = &p;
+                    break;
+                }
+            }
+            if (eq == nullptr) {
+                break;
+            }
+            small::encode::encode_key(&prefix, eq->value);
+            scan.num_eq_columns++;
+        }
+
+        // range on the next key column
+        const Predicate* lower = nullptr;
+        const Predicate* upper = nullptr;
+        if (scan.num_eq_columns < index.column_ids.size()) {
+            int column = table.get_column_index(
+                index.column_ids[scan.num_eq_columns]);
+            for (const auto& p : predicates) {
+                if (p.column_index != column) {
+                    continue;
+                }
+                if ((p.op == ">" || p.op == ">=") &&
+                    (lower == nullptr || tighter(p, *lower, true))) {
+                    lower = &p;
+                }
+                if ((p.op == "<" || p.op == "<=") &&
+                    (upper == nullptr || tighter(p, *upper, false))) {
+                    upper = &p;
+                }
+            }
+        }
+
+        int score = scan.num_eq_columns * 2 + (lower != nullptr) +
+                    (upper != nullptr);
+        if (score <= best_score) {
+            continue;
+        }
+
+        scan.lower_bound = prefix;
+        if (lower != nullptr) {
+            auto key = prefix;
+            small::encode::encode_key(&key, lower->value);
+            scan.lower_bound = lower->op == ">="
+                                   ? key
+                                   : small::rocks::prefix_successor(key);
+        }
+        scan.upper_bound = small::rocks::prefix_successor(prefix);
+        if (upper != nullptr) {
+            auto key = prefix;
+            small::encode::encode_key(&key, upper->value);
+            scan.upper_bound = upper->op == "<="
+                                   ? small::rocks::prefix_successor(key)
+                                   : key;
+        }
+
+        best = scan;
+        best_score = score;
+    }
+    return best;
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> index_scan(
+    const std::shared_ptr<small::schema::Table>& table, const IndexScan& scan,
+    const std::vector<int>& columns, small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options) {
+    const auto& index = *scan.index;
+
+    // the rows must be fetched from the snapshot of the entries
+    small::rocks::ScanOptions scan_options = options;
+    if (!scan_options.snapshot) {
+        scan_options.snapshot = db->GetSnapshot();
+    }
+
+    int pk_index = table->get_pk_index();
+    const auto& pk_column = table->columns[pk_index];
+
+    bool index_only = true;
+    for (int column : columns) {
+        if (column != pk_index && !index.covers(table->columns[column].id)) {
+            index_only = false;
+            break;
+        }
+    }
+
+    small::columnar::RowBatchBuilder builder(*table, columns);
+
+    // primary keys and key columns of the entries, to fetch and verify rows
+    std::vector<small::type::Datum> pks;
+    std::vector<std::vector<small::type::Datum>> entry_keys;
+
+    std::vector<int64_t> null_column_ids;
+    absl::Status status = absl::OkStatus();
+    auto visitor = [&](const rocksdb::Slice& key,
+                       const rocksdb::Slice& value) {
+        std::string_view input(key.data(), key.size());
+        uint64_t index_id;
+        small::encode::get_varint64(&input, &index_id);
+
+        std::vector<small::type::Datum> key_values;
+        for (int64_t column_id : index.column_ids) {
+            auto type = table->columns[table->get_column_index(column_id)].type;
+            key_values.push_back(small::encode::decode_key(&input, type));
+        }
+        auto pk = small::encode::decode_key(&input, pk_column.type);
+
+        if (!index_only) {
+            pks.push_back(std::move(pk));
+            entry_keys.push_back(std::move(key_values));
+            return true;
+        }
+
+        // build the row from the key columns, the primary key and the
+        // included columns in the value, NULL columns are left out
+        auto included = small::rocks::split_index_value(
+            std::string_view(value.data(), value.size()), &null_column_ids);
+        std::vector<int64_t> column_ids;
+        std::vector<std::string> cells;
+        for (size_t k = 0; k < index.column_ids.size(); k++) {
+            if (std::find(null_column_ids.begin(), null_column_ids.end(),
+                          index.column_ids[k]) != null_column_ids.end()) {
+                continue;
+            }
+            column_ids.push_back(index.column_ids[k]);
+            cells.push_back(small::encode::encode_value(key_values[k]));
+        }
+        column_ids.push_back(pk_column.id);
+        cells.push_back(small::encode::encode_value(pk));
+        auto row = small::encode::encode_row(column_ids, cells);
+        row.append(included);
+
+        status = builder.Append(row);
+        return status.ok();
+    };
+
+    try {
+        db->Scan("IndexCF", scan.lower_bound, scan.upper_bound, visitor,
+                 scan_options);
+    } catch (const std::exception& e) {
+        SPDLOG_ERROR("index scan failed: {}", e.what());
+        return absl::InternalError(std::string("index scan failed: ") +
+                                   e.what());
+    }
+    if (!status.ok()) {
+        return status;
+    }
+
+    if (!index_only) {
+        status = fetch_rows(*table, index, pks, entry_keys, db, scan_options,
+                            &builder);
+        if (!status.ok()) {
+            return status;
+        }
+    }
+
+    SPDLOG_INFO("index scan, table: {}, index: {}, index only: {}, rows: {}",
+                table->name, index.name, index_only, builder.num_rows());
+    return builder.Finish();
+}
+
+absl::Status backfill_index(const std::shared_ptr<small::schema::Table>& table,
+                            const small::schema::Index& index,
+                            small::rocks::RocksDBWrapper* db) {
+    if (index.method == small::schema::Index::Method::Bitmap) {
+        return backfill_bitmap_index(table, index, db);
+    }
+
+    auto rows = scan_table(table, table->get_pk_index(), db);
+    if (!rows.ok()) {
+        return rows.status();
+    }
+
+    const auto& batch = *rows.value();
+    rocksdb::WriteBatch write_batch;
+    std::vector<small::type::Datum> values(table->columns.size());
+    std::vector<bool> nulls(table->columns.size());
+    for (int64_t r = 0; r < batch.num_rows(); r++) {
+        for (int c = 0; c < table->columns.size(); c++) {
+            values[c] = get_datum(*batch.column(c), r, table->columns[c].type);
+            nulls[c] = batch.column(c)->IsNull(r);
+        }
+        db->Put(&write_batch, "IndexCF",
+                small::rocks::index_key(*table, index, values),
+                small::rocks::index_value(*table, index, values, nulls));
+
+        if (write_batch.Count() >= kBackfillBatchRows) {
+            if (!db->Write(&write_batch)) {
+                return absl::InternalError("failed to write index entries");
+            }
+            write_batch.Clear();
+        }
+    }
+    if (write_batch.Count() > 0 && !db->Write(&write_batch)) {
+        return absl::InternalError("failed to write index entries");
+    }
+
+    SPDLOG_INFO("backfilled index {} of table {}, rows: {}", index.name,
+                table->name, batch.num_rows());
+    return absl::OkStatus();
+}
+
+}  // namespace query
@@ -0,0 +1,82 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/query/predicate.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+
+namespace query {
+
+// A range of index entries matching the predicates: equality on the leading
+// key columns and an optional range on the next key column.
+class IndexScan {
+   public:
+    const small::schema::Index* index = nullptr;
+
+    // number of key columns fixed by "=" predicates
+    int num_eq_columns = 0;
+
+    // [lower_bound, upper_bound) in "IndexCF"
+    std::string lower_bound;
+    std::string upper_bound;
+};
+
+// Choose the btree index matching most predicates, prefer equality over range.
+// Return std::nullopt if no index matches any predicate.
+std::optional<IndexScan> plan_index_scan(
+    const small::schema::Table& table,
+    const std::vector<Predicate>& predicates);
+
+// Read the rows in the range of the index scan. If the index covers all
+// "columns" (indexes of the columns in the table) the rows are built from the
+// entries alone (index-only scan), other columns of the batch are NULL.
+// Otherwise rows are fetched by their primary keys in a batched lookup, from
+// the same snapshot as the entries.
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> index_scan(
+    const std::shared_ptr<small::schema::Table>& table, const IndexScan& scan,
+    const std::vector<int>& columns, small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options = {});
+
+// Write the entries of all existing rows of the table to the index.
+absl::Status backfill_index(const std::shared_ptr<small::schema::Table>& table,
+                            const small::schema::Index& index,
+                            small::rocks::RocksDBWrapper* db);
+
+}  // namespace query
@@ -0,0 +1,184 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// arrow gandiva
+#include "gandiva/condition.h"
+#include "gandiva/configuration.h"
+#include "gandiva/expression.h"
+#include "gandiva/filter.h"
+#include "gandiva/projector.h"
+#include "gandiva/selection_vector.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/query/expression_cache.h"
+#include "src/query/filter.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/pipeline.h"
+
+namespace query {
+
+BatchSource::BatchSource(std::shared_ptr<arrow::RecordBatch> batch)
+    : batch_(std::move(batch)) {}
+
+std::shared_ptr<arrow::Schema> BatchSource::schema() const {
+    return batch_->schema();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> BatchSource::Next() {
+    if (offset_ >= batch_->num_rows()) {
+        return std::shared_ptr<arrow::RecordBatch>();
+    }
+    int64_t length = std::min(kBatchRows, batch_->num_rows() - offset_);
+    auto slice = batch_->Slice(offset_, length);
+    offset_ += length;
+    return slice;
+}
+
+absl::StatusOr<std::unique_ptr<FilterProject>> FilterProject::Make(
+    std::unique_ptr<Operator> input, const gandiva::ConditionPtr& condition,
+    const gandiva::ExpressionVector& expressions) {
+    std::unique_ptr<FilterProject> op(new FilterProject());
+    auto input_schema = input->schema();
+    op->input_ = std::move(input);
+
+    if (condition) {
+        auto filter = make_filter(input_schema, condition);
+        if (!filter.ok()) {
+            return filter.status();
+        }
+        op->filter_ = filter.value();
+    }
+
+    arrow::FieldVector fields;
+    for (const auto& expression : expressions) {
+        fields.push_back(expression->result());
+    }
+    op->schema_ = arrow::schema(fields);
+
+    auto mode = op->filter_ ? gandiva::SelectionVector::MODE_UINT32
+                            : gandiva::SelectionVector::MODE_NONE;
+    auto configuration = gandiva::ConfigurationBuilder::DefaultConfiguration();
+    auto cache = ExpressionCache::GetInstance();
+    if (cache) {
+        auto projector = cache->GetProjector(input_schema, expressions, mode,
+                                             configuration);
+        if (!projector.ok()) {
+            return projector.status();
+        }
+        op->projector_ = projector.value();
+        return op;
+    }
+
+    auto status = gandiva::Projector::Make(input_schema, expressions, mode,
+                                           configuration, &op->projector_);
+    if (!status.ok()) {
+        SPDLOG_ERROR("projector make failed: {}", status.ToString());
+        return absl::InternalError("projector make failed: " +
+                                   status.ToString());
+    }
+    return op;
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> FilterProject::Next() {
+    // skip the input batches without any matching row
+    while (true) {
+        auto input = input_->Next();
+        if (!input.ok() || input.value() == nullptr) {
+            return input;
+        }
+        const auto& batch = *input.value();
+
+        std::shared_ptr<gandiva::SelectionVector> selection;
+        int64_t num_rows = batch.num_rows();
+        if (filter_) {
+            auto filtered = filter_batch(filter_.get(), batch);
+            if (!filtered.ok()) {
+                return filtered.status();
+            }
+            selection = filtered.value();
+            num_rows = selection->GetNumSlots();
+        }
+        if (num_rows == 0) {
+            continue;
+        }
+
+        arrow::ArrayVector outputs;
+        auto status = projector_->Evaluate(batch, selection.get(),
+                                           arrow::default_memory_pool(),
+                                           &outputs);
+        if (!status.ok()) {
+            SPDLOG_ERROR("projector evaluate failed: {}", status.ToString());
+            return absl::InternalError("projector evaluate failed: " +
+                                       status.ToString());
+        }
+        return arrow::RecordBatch::Make(schema_, num_rows, outputs);
+    }
+}
+
+SelectColumns::SelectColumns(std::unique_ptr<Operator> input,
+                             std::vector<int> indexes,
+                             const std::vector<std::string>& names)
+    : input_(std::move(input)), indexes_(std::move(indexes)) {
+    auto input_schema = input_->schema();
+    arrow::FieldVector fields;
+    for (size_t i = 0; i < indexes_.size(); i++) {
+        fields.push_back(input_schema->field(indexes_[i])->WithName(names[i]));
+    }
+    schema_ = arrow::schema(fields);
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> SelectColumns::Next() {
+    auto input = input_->Next();
+    if (!input.ok() || input.value() == nullptr) {
+        return input;
+    }
+    const auto& batch = *input.value();
+    arrow::ArrayVector columns;
+    for (int index : indexes_) {
+        columns.push_back(batch.column(index));
+    }
+    return arrow::RecordBatch::Make(schema_, batch.num_rows(), columns);
+}
+
+}  // namespace query
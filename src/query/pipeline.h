@@ -0,0 +1,120 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// arrow gandiva
+#include "gandiva/condition.h"
+#include "gandiva/expression.h"
+#include "gandiva/filter.h"
+#include "gandiva/projector.h"
+
+namespace query {
+
+// Max rows of a batch produced by an operator, results are sent to the client
+// batch by batch.
+constexpr int64_t kBatchRows = 16 * 1024;
+
+// An operator of a pull-based pipeline (scan -> filter and project -> sink):
+// every call of "Next" pulls batches from the input operator and returns the
+// next output batch.
+class Operator {
+   public:
+    virtual ~Operator() = default;
+
+    // Schema of the output batches.
+    virtual std::shared_ptr<arrow::Schema> schema() const = 0;
+
+    // Return the next batch of at most "kBatchRows" rows, or nullptr after
+    // the last batch.
+    virtual absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() = 0;
+};
+
+// Produce the slices of a batch already in memory (e.g. the rows of an index
+// scan), the slices share the memory of the batch.
+class BatchSource : public Operator {
+   public:
+    explicit BatchSource(std::shared_ptr<arrow::RecordBatch> batch);
+
+    std::shared_ptr<arrow::Schema> schema() const override;
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+   private:
+    std::shared_ptr<arrow::RecordBatch> batch_;
+    int64_t offset_ = 0;
+};
+
+// Filter the batches of the input by the condition (nullptr keeps all rows)
+// and evaluate the expressions over the rows left. The filter only selects
+// rows, the projector reads them through the selection vector, so rows are
+// copied once.
+class FilterProject : public Operator {
+   public:
+    // Compile the condition and the expressions against the schema of the
+    // input.
+    static absl::StatusOr<std::unique_ptr<FilterProject>> Make(
+        std::unique_ptr<Operator> input, const gandiva::ConditionPtr& condition,
+        const gandiva::ExpressionVector& expressions);
+
+    std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+   private:
+    FilterProject() = default;
+
+    std::unique_ptr<Operator> input_;
+    std::shared_ptr<gandiva::Filter> filter_;
+    std::shared_ptr<gandiva::Projector> projector_;
+    std::shared_ptr<arrow::Schema> schema_;
+};
+
+// Pick the columns of the input batches by index and rename them, the
+// columns are shared with the input batches.
+class SelectColumns : public Operator {
+   public:
+    SelectColumns(std::unique_ptr<Operator> input, std::vector<int> indexes,
+                  const std::vector<std::string>& names);
+
+    std::shared_ptr<arrow::Schema> schema() const override { return schema_; }
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+   private:
+    std::unique_ptr<Operator> input_;
+    std::vector<int> indexes_;
+    std::shared_ptr<arrow::Schema> schema_;
+};
+
+}  // namespace query
@@ -0,0 +1,148 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/schema/schema.h"
+#include "src/semantics/extract.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/predicate.h"
+
+namespace query {
+
+namespace {
+
+// The operator with the operands swapped, e.g. "a < b" is "b > a".
+std::string commute(const std::string& op) {
+    if (op == "<") return ">";
+    if (op == "<=") return ">=";
+    if (op == ">") return "<";
+    if (op == ">=") return "<=";
+    return op;
+}
+
+void collect(const small::schema::Table& table, PgQuery__Node* node,
+             std::vector<Predicate>* predicates) {
+    if (node->node_case == PG_QUERY__NODE__NODE_BOOL_EXPR) {
+        auto bool_expr = node->bool_expr;
+        if (bool_expr->boolop == PG_QUERY__BOOL_EXPR_TYPE__AND_EXPR) {
+            for (int i = 0; i < bool_expr->n_args; i++) {
+                collect(table, bool_expr->args[i], predicates);
+            }
+        }
+        return;
+    }
+
+    if (node->node_case != PG_QUERY__NODE__NODE_A_EXPR) {
+        return;
+    }
+    auto a_expr = node->a_expr;
+    if (a_expr->kind != PG_QUERY__A__EXPR__KIND__AEXPR_OP ||
+        a_expr->n_name != 1 || a_expr->lexpr == nullptr ||
+        a_expr->rexpr == nullptr) {
+        return;
+    }
+
+    std::string op = a_expr->name[0]->string->sval;
+    if (op != "=" && op != "<" && op != "<=" && op != ">" && op != ">=") {
+        return;
+    }
+
+    PgQuery__Node* column = a_expr->lexpr;
+    PgQuery__Node* constant = a_expr->rexpr;
+    if (column->node_case == PG_QUERY__NODE__NODE_A_CONST) {
+        std::swap(column, constant);
+        op = commute(op);
+    }
+
+    int index = get_column_index(table, column);
+    if (index == -1) {
+        return;
+    }
+    auto value = get_constant(table, index, constant);
+    if (!value.has_value()) {
+        return;
+    }
+
+    predicates->push_back(Predicate{index, op, value.value()});
+}
+
+}  // namespace
+
+int get_column_index(const small::schema::Table& table, PgQuery__Node* node) {
+    if (node->node_case != PG_QUERY__NODE__NODE_COLUMN_REF) {
+        return -1;
+    }
+    auto column_ref = node->column_ref;
+    auto last = column_ref->fields[column_ref->n_fields - 1];
+    if (last->node_case != PG_QUERY__NODE__NODE_STRING) {
+        return -1;
+    }
+    return table.get_column_index(std::string(last->string->sval));
+}
+
+std::optional<small::type::Datum> get_constant(
+    const small::schema::Table& table, int column_index, PgQuery__Node* node) {
+    if (node->node_case != PG_QUERY__NODE__NODE_A_CONST) {
+        return std::nullopt;
+    }
+    auto value = small::semantics::extract_const(node->a_const);
+    if (!value.has_value()) {
+        return std::nullopt;
+    }
+
+    // the constant must have the type of the column
+    bool is_int = std::holds_alternative<int64_t>(value.value());
+    if (is_int !=
+        (table.columns[column_index].type == small::type::Type::Int64)) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::vector<Predicate> extract_predicates(const small::schema::Table& table,
+                                          PgQuery__Node* where_clause) {
+    std::vector<Predicate> predicates;
+    if (where_clause != nullptr) {
+        collect(table, where_clause, &predicates);
+    }
+    return predicates;
+}
+
+}  // namespace query
@@ -0,0 +1,70 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/schema/schema.h"
+#include "src/type/type.h"
+
+namespace query {
+
+// A predicate "<column> <op> <constant>" of the WHERE clause.
+class Predicate {
+   public:
+    // index of the column in the table
+    int column_index;
+
+    // one of "=", "<", "<=", ">", ">="
+    std::string op;
+
+    small::type::Datum value;
+};
+
+// Return the index of the column referenced by the node in the table, or -1
+// if the node isn't a reference to a column of the table.
+int get_column_index(const small::schema::Table& table, PgQuery__Node* node);
+
+// Return the value of a constant node with the type of the column, or
+// std::nullopt if the node isn't such a constant.
+std::optional<small::type::Datum> get_constant(
+    const small::schema::Table& table, int column_index, PgQuery__Node* node);
+
+// Collect the predicates ANDed at the top level of the WHERE clause, a
+// constant on the left side is moved to the right side ("1 < id" becomes
+// "id > 1"). Other conditions (OR, functions, mismatched types, ...) are
+// skipped, "where_clause" may be nullptr.
+std::vector<Predicate> extract_predicates(const small::schema::Table& table,
+                                          PgQuery__Node* where_clause);
+
+}  // namespace query
@@ -16,10 +16,13 @@
 // c++ std
 // =====================================================================
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 // =====================================================================
@@ -39,22 +42,28 @@
 #include "arrow/status.h"
 
 // arrow gandiva
-#include "gandiva/filter.h"
-#include "gandiva/projector.h"
-#include "gandiva/selection_vector.h"
+#include "gandiva/expression.h"
 #include "gandiva/tree_expr_builder.h"
 
-// magic_enum
-#include "magic_enum/magic_enum.hpp"
-
 // =====================================================================
 // local libraries
 // =====================================================================
 
 #include "src/catalog/catalog.h"
+#include "src/columnar/row_batch.h"
+#include "src/columnar/scan_cache.h"
+#include "src/encode/encode.h"
+#include "src/query/aggregate.h"
+#include "src/query/bitmap_scan.h"
+#include "src/query/filter.h"
+#include "src/query/index_scan.h"
+#include "src/query/pipeline.h"
+#include "src/query/predicate.h"
+#include "src/query/scan.h"
 #include "src/rocks/rocks.h"
 #include "src/schema/const.h"
 #include "src/schema/schema.h"
+#include "src/semantics/extract.h"
 #include "src/server_info/info.h"
 
 // =====================================================================
@@ -66,76 +75,245 @@
 namespace query {
 
 // parse key from rocksdb, the format is:
-// /<table_name>/<pk>/column_<column_id>
-std::tuple<std::string_view, std::string_view, int> parse_key(
-    const std::string& key) {
-    size_t first_slash = key.find('/');
-    if (first_slash == std::string::npos) {
-        throw std::invalid_argument("Invalid key format: missing first slash");
+// <varint table_id><pk>
+//
+// See "small::rocks::row_key" for details.
+std::tuple<int64_t, small::type::Datum> parse_key(std::string_view key,
+                                                  small::type::Type pk_type) {
+    uint64_t table_id;
+    if (!small::encode::get_varint64(&key, &table_id)) {
+        throw std::invalid_argument("Invalid key format: missing table id");
     }
 
-    size_t second_slash = key.find('/', first_slash + 1);
-    if (second_slash == std::string::npos) {
-        throw std::invalid_argument("Invalid key format: missing second slash");
+    auto pk = small::encode::decode_key(&key, pk_type);
+    if (!key.empty()) {
+        throw std::invalid_argument("Invalid key format: trailing bytes");
     }
 
-    size_t third_slash = key.find('/', second_slash + 1);
-    if (third_slash == std::string::npos) {
-        throw std::invalid_argument("Invalid key format: missing third slash");
-    }
+    return {static_cast<int64_t>(table_id), pk};
+}
+
+// An expression in the SELECT list.
+class Target {
+   public:
+    gandiva::NodePtr expression;
+
+    // name of the column in the result
+    std::string name;
+};
+
+// Translate the SELECT list, "*" expands to all columns of the table. Append
+// the indexes of the referenced columns to "columns".
+absl::StatusOr<std::vector<Target>> get_targets(
+    const small::schema::Table& table, const arrow::SchemaPtr& schema,
+    PgQuery__SelectStmt* select_stmt, std::vector<int>* columns) {
+    std::vector<Target> targets;
+    for (int i = 0; i < select_stmt->n_target_list; i++) {
+        auto res_target = select_stmt->target_list[i]->res_target;
+        auto val = res_target->val;
+
+        PgQuery__Node* field = nullptr;
+        if (val->node_case == PG_QUERY__NODE__NODE_COLUMN_REF) {
+            auto column_ref = val->column_ref;
+            field = column_ref->fields[column_ref->n_fields - 1];
+        }
+        if (field != nullptr &&
+            field->node_case == PG_QUERY__NODE__NODE_A_STAR) {
+            for (int c = 0; c < table.columns.size(); c++) {
+                columns->push_back(c);
+                targets.push_back(Target{
+                    gandiva::TreeExprBuilder::MakeField(schema->field(c)),
+                    table.columns[c].name});
+            }
+            continue;
+        }
+
+        auto expression = make_expression(table, schema, val, columns);
+        if (!expression.ok()) {
+            return expression.status();
+        }
 
-    std::string_view table_name = std::string_view(key).substr(
-        first_slash + 1, second_slash - first_slash - 1);
-    std::string_view pk = std::string_view(key).substr(
-        second_slash + 1, third_slash - second_slash - 1);
+        // the results can only hold the types of the columns
+        auto type = expression.value()->return_type();
+        if (type->id() != arrow::Type::INT64 &&
+            type->id() != arrow::Type::STRING) {
+            return absl::InvalidArgumentError("unsupported target type: " +
+                                              type->ToString());
+        }
 
-    std::string_view column_part =
-        std::string_view(key).substr(third_slash + 1);
-    if (column_part.find("column_") != 0) {
-        throw std::invalid_argument(
-            "Invalid key format: missing 'column_' prefix");
+        // named like postgres: the alias, the column or "?column?"
+        std::string name = res_target->name;
+        if (name.empty()) {
+            name = field != nullptr &&
+                           field->node_case == PG_QUERY__NODE__NODE_STRING
+                       ? field->string->sval
+                       : "?column?";
+        }
+        targets.push_back(Target{expression.value(), name});
     }
-    int column_id = std::stoi(std::string(column_part.substr(7)));
+    return targets;
+}
 
-    return {table_name, pk, column_id};
+// The aggregation of a SELECT with a GROUP BY or aggregate functions.
+class AggregatePlan {
+   public:
+    // the group keys then the arguments of the aggregates, evaluated over the
+    // rows before the aggregation
+    std::vector<Target> inputs;
+    int num_keys = 0;
+    std::vector<Aggregate> aggregates;
+
+    // the column of every target in the output of the aggregation, and its
+    // name
+    std::vector<int> outputs;
+    std::vector<std::string> names;
+};
+
+// Return the function call of the target, or nullptr if it isn't one.
+PgQuery__FuncCall* get_func_call(PgQuery__Node* node) {
+    return node->node_case == PG_QUERY__NODE__NODE_FUNC_CALL ? node->func_call
+                                                             : nullptr;
 }
 
-std::shared_ptr<arrow::Schema> get_input_schema(
-    const small::schema::Table& table) {
-    arrow::FieldVector fields;
-    for (const auto& column : table.columns) {
-        fields.push_back(arrow::field(
-            column.name, small::type::get_gandiva_type(column.type)));
+// The name of a function, without the schema (e.g. "pg_catalog.count").
+std::string get_func_name(PgQuery__FuncCall* func_call) {
+    auto last = func_call->funcname[func_call->n_funcname - 1];
+    return last->node_case == PG_QUERY__NODE__NODE_STRING ? last->string->sval
+                                                          : "";
+}
+
+bool is_aggregate(PgQuery__SelectStmt* select_stmt) {
+    if (select_stmt->n_group_clause > 0) {
+        return true;
+    }
+    for (int i = 0; i < select_stmt->n_target_list; i++) {
+        auto func_call =
+            get_func_call(select_stmt->target_list[i]->res_target->val);
+        if (func_call != nullptr &&
+            get_aggregate_kind(get_func_name(func_call), func_call->agg_star)
+                .has_value()) {
+            return true;
+        }
     }
-    return arrow::schema(fields);
+    return false;
 }
 
-std::vector<std::shared_ptr<arrow::ArrayBuilder>> get_builders(
-    const small::schema::Table& table) {
-    std::vector<std::shared_ptr<arrow::ArrayBuilder>> builders;
-    for (const auto& column : table.columns) {
-        switch (column.type) {
-            case small::type::Type::Int64:
-                builders.push_back(std::make_shared<arrow::Int64Builder>());
-                break;
-            case small::type::Type::String:
-                builders.push_back(std::make_shared<arrow::StringBuilder>());
-                break;
-            default:
-                SPDLOG_ERROR("unsupported type: {}",
-                             small::type::to_string(column.type));
-                break;
+// Translate the GROUP BY clause and the SELECT list of an aggregation. Every
+// target is either an aggregate function or one of the group keys. Append
+// the indexes of the referenced columns to "columns".
+absl::StatusOr<AggregatePlan> plan_aggregate(const small::schema::Table& table,
+                                             const arrow::SchemaPtr& schema,
+                                             PgQuery__SelectStmt* select_stmt,
+                                             std::vector<int>* columns) {
+    if (select_stmt->having_clause != nullptr) {
+        return absl::InvalidArgumentError("HAVING is not supported");
+    }
+
+    AggregatePlan plan;
+    std::vector<std::string> keys;
+    for (int i = 0; i < select_stmt->n_group_clause; i++) {
+        auto node = select_stmt->group_clause[i];
+        if (node->node_case == PG_QUERY__NODE__NODE_A_CONST) {
+            return absl::InvalidArgumentError(
+                "GROUP BY position is not supported");
+        }
+        auto key = make_expression(table, schema, node, columns);
+        if (!key.ok()) {
+            return key.status();
         }
+        keys.push_back(key.value()->ToString());
+        plan.inputs.push_back(Target{key.value(), "key" + std::to_string(i)});
     }
-    return builders;
+    plan.num_keys = plan.inputs.size();
+
+    std::vector<Target> arguments;
+    for (int i = 0; i < select_stmt->n_target_list; i++) {
+        auto res_target = select_stmt->target_list[i]->res_target;
+        auto val = res_target->val;
+        std::string name = res_target->name;
+
+        auto func_call = get_func_call(val);
+        if (func_call != nullptr) {
+            auto func_name = get_func_name(func_call);
+            auto kind = get_aggregate_kind(func_name, func_call->agg_star);
+            if (!kind.has_value()) {
+                return absl::InvalidArgumentError("unsupported function: " +
+                                                  func_name);
+            }
+            if (func_call->agg_distinct || func_call->agg_filter != nullptr ||
+                func_call->over != nullptr || func_call->n_agg_order > 0) {
+                return absl::InvalidArgumentError(
+                    "DISTINCT, FILTER, ORDER BY and OVER of aggregates are "
+                    "not supported");
+            }
+
+            Aggregate aggregate;
+            aggregate.kind = kind.value();
+            aggregate.name = name.empty() ? func_name : name;
+            if (kind.value() != Aggregate::Kind::CountStar) {
+                if (func_call->n_args != 1) {
+                    return absl::InvalidArgumentError(
+                        func_name + " takes exactly one argument");
+                }
+                auto argument =
+                    make_expression(table, schema, func_call->args[0], columns);
+                if (!argument.ok()) {
+                    return argument.status();
+                }
+                aggregate.input = plan.num_keys + arguments.size();
+                arguments.push_back(
+                    Target{argument.value(),
+                           "argument" + std::to_string(arguments.size())});
+            }
+            plan.outputs.push_back(plan.num_keys + plan.aggregates.size());
+            plan.names.push_back(aggregate.name);
+            plan.aggregates.push_back(aggregate);
+            continue;
+        }
+
+        // other targets must be a group key, e.g. "country" of "GROUP BY
+        // country"
+        std::vector<int> key_columns;
+        auto expression = make_expression(table, schema, val, &key_columns);
+        if (!expression.ok()) {
+            return expression.status();
+        }
+        auto it = std::find(keys.begin(), keys.end(),
+                            expression.value()->ToString());
+        if (it == keys.end()) {
+            return absl::InvalidArgumentError(
+                "targets must appear in the GROUP BY clause or be used in an "
+                "aggregate function");
+        }
+        if (name.empty()) {
+            auto field = val->node_case == PG_QUERY__NODE__NODE_COLUMN_REF
+                             ? val->column_ref
+                                   ->fields[val->column_ref->n_fields - 1]
+                             : nullptr;
+            name = field != nullptr &&
+                           field->node_case == PG_QUERY__NODE__NODE_STRING
+                       ? field->string->sval
+                       : "?column?";
+        }
+        plan.outputs.push_back(it - keys.begin());
+        plan.names.push_back(name);
+    }
+    plan.inputs.insert(plan.inputs.end(), arguments.begin(), arguments.end());
+
+    // COUNT(*) alone still needs rows to count
+    if (plan.inputs.empty()) {
+        int pk_index = table.get_pk_index();
+        plan.inputs.push_back(Target{
+            gandiva::TreeExprBuilder::MakeField(schema->field(pk_index)),
+            "pk"});
+    }
+    return plan;
 }
 
-absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> query(
+absl::StatusOr<std::unique_ptr<Operator>> query(
     PgQuery__SelectStmt* select_stmt) {
-    auto schemaname = select_stmt->from_clause[0]->range_var->schemaname;
-    auto relname = select_stmt->from_clause[0]->range_var->relname;
-
-    auto table_name = std::string(schemaname) + "." + std::string(relname);
+    auto table_name = small::semantics::extract_table_name(
+        select_stmt->from_clause[0]->range_var);
 
     // get the input schema
     auto table = small::catalog::Catalog::GetInstance()->GetTable(table_name);
@@ -144,134 +322,160 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> query(
         return absl::Status(absl::StatusCode::kNotFound,
                             "table not found: " + table_name);
     }
-    auto input_schema = get_input_schema(*table.value());
+    int pk_index = table.value()->get_pk_index();
+    if (pk_index == -1) {
+        SPDLOG_ERROR("primary key not found");
+        return absl::Status(absl::StatusCode::kInvalidArgument,
+                            "primary key not found");
+    }
+
+    auto input_schema = small::columnar::get_arrow_schema(*table.value());
     SPDLOG_INFO("schema: {}", input_schema->ToString());
 
-    // read kv pairs from rocksdb
+    // the columns referenced by the statement, the primary key is always
+    // read to merge the rows with the segment
+    std::vector<int> columns = {pk_index};
+    std::optional<AggregatePlan> aggregate_plan;
+    std::vector<Target> targets;
+    if (is_aggregate(select_stmt)) {
+        auto plan = plan_aggregate(*table.value(), input_schema, select_stmt,
+                                   &columns);
+        if (!plan.ok()) {
+            return plan.status();
+        }
+        aggregate_plan = std::move(plan.value());
+        targets = aggregate_plan->inputs;
+    } else {
+        auto got =
+            get_targets(*table.value(), input_schema, select_stmt, &columns);
+        if (!got.ok()) {
+            return got.status();
+        }
+        targets = std::move(got.value());
+    }
+    auto condition = make_condition(*table.value(), input_schema,
+                                    select_stmt->where_clause, &columns);
+    if (!condition.ok()) {
+        return condition.status();
+    }
+    std::sort(columns.begin(), columns.end());
+    columns.erase(std::unique(columns.begin(), columns.end()), columns.end());
+
     auto info = small::server_info::get_info();
     if (!info.ok())
         return absl::Status(absl::StatusCode::kInternal,
                             "failed to get server info");
     std::string db_path = info.value()->db_path;
     auto db = small::rocks::RocksDBWrapper::GetInstance(db_path, {});
-    auto scan_preix = "/" + table_name + "/";
-    auto kv_pairs = db->GetAll(scan_preix);
 
-    // init builders
-    auto builders = get_builders(*table.value());
+    // the version must be read before the snapshot, see "GetTableVersion"
+    uint64_t version = db->GetTableVersion(table.value()->id);
 
-    int pk_index = table.value()->get_pk_index();
-    if (pk_index == -1) {
-        SPDLOG_ERROR("primary key not found");
-        return absl::Status(absl::StatusCode::kInvalidArgument,
-                            "primary key not found");
+    // every read of the statement sees the same point-in-time view, writers
+    // are never blocked by it
+    small::rocks::ScanOptions scan_options;
+    scan_options.snapshot = db->GetSnapshot();
+
+    // unreferenced columns are neither copied nor decoded by the scans
+    if (columns.size() < table.value()->columns.size()) {
+        scan_options.columns = columns;
     }
 
-    for (const auto& [key, value] : kv_pairs) {
-        SPDLOG_INFO("key: {}, value: {}", key, value);
-
-        auto [_, _, column_id] = parse_key(key);
-
-        // append to builder
-        auto& builder = builders[column_id];
-        if (auto int_builder =
-                std::dynamic_pointer_cast<arrow::Int64Builder>(builder)) {
-            int64_t int_value = std::stoll(value);
-            auto result = int_builder->Append(int_value);
-            if (!result.ok()) {
-                SPDLOG_ERROR("Failed to append value: {}", result.ToString());
-                return absl::Status(absl::StatusCode::kInternal,
-                                    "Failed to append value");
-            }
-        } else if (auto string_builder =
-                       std::dynamic_pointer_cast<arrow::StringBuilder>(
-                           builder)) {
-            auto result = string_builder->Append(value);
-            if (!result.ok()) {
-                SPDLOG_ERROR("Failed to append value: {}", result.ToString());
-                return absl::Status(absl::StatusCode::kInternal,
-                                    "Failed to append value");
-            }
-        } else {
-            SPDLOG_ERROR("Unsupported builder type for column_id: {}",
-                         column_id);
-            return absl::Status(absl::StatusCode::kInvalidArgument,
-                                "Unsupported builder type for column_id: " +
-                                    std::to_string(column_id));
+    std::shared_ptr<arrow::RecordBatch> in_batch;
+
+    // read through an index if the WHERE clause matches one
+    auto predicates =
+        extract_predicates(*table.value(), select_stmt->where_clause);
+    auto plan = plan_index_scan(*table.value(), predicates);
+    if (plan.has_value()) {
+        auto scanned = index_scan(table.value(), plan.value(), columns, db,
+                                  scan_options);
+        if (!scanned.ok()) {
+            return scanned.status();
         }
+        in_batch = scanned.value();
     }
 
-    arrow::ArrayVector columns;
-    for (const auto& builder : builders) {
-        auto result = builder->Finish();
-        if (!result.ok()) {
-            return absl::Status(
-                absl::StatusCode::kInternal,
-                "Failed to finish builder: " + result.status().ToString());
+    // otherwise through the bitmap indexes
+    if (!in_batch) {
+        auto row_ids = evaluate_bitmap(
+            *table.value(), select_stmt->where_clause, db, scan_options);
+        if (!row_ids.ok()) {
+            return row_ids.status();
+        }
+        if (row_ids.value().has_value()) {
+            auto scanned = bitmap_scan(
+                table.value(), row_ids.value().value(), db, scan_options);
+            if (!scanned.ok()) {
+                return scanned.status();
+            }
+            in_batch = scanned.value();
         }
-        auto column = result.ValueOrDie();
-        columns.push_back(column);
     }
 
-    int num_records = columns[0]->length();
-
-    auto in_batch =
-        arrow::RecordBatch::Make(input_schema, num_records, columns);
-
-    std::vector<std::shared_ptr<arrow::Field>> output_fields;
-
-    // get result schema
-    std::vector<std::shared_ptr<gandiva::Expression>> expressions;
-    auto column_ref = select_stmt->target_list[0]->res_target->val->column_ref;
-    for (int i = 0; i < column_ref->n_fields; i++) {
-        auto field = column_ref->fields[i];
-        switch (field->node_case) {
-            case PG_QUERY__NODE__NODE_A_STAR:
-                for (auto field : input_schema->fields()) {
-                    auto column_ref =
-                        gandiva::TreeExprBuilder::MakeField(field);
-                    auto expression = gandiva::TreeExprBuilder::MakeExpression(
-                        column_ref, field);
-                    expressions.push_back(expression);
-
-                    output_fields.push_back(field);
-                }
-                break;
-            default:
-                SPDLOG_ERROR("unsupported field type");
-                return absl::Status(
-                    absl::StatusCode::kInvalidArgument,
-                    "unsupported field type: " +
-                        std::string(magic_enum::enum_name(field->node_case)));
+    auto scan_cache = small::columnar::ScanCache::GetInstance();
+    if (!in_batch && scan_cache) {
+        in_batch = scan_cache->Get(table.value()->id, version);
+        if (in_batch) {
+            SPDLOG_INFO("scan cache hit, table: {}, version: {}", table_name,
+                        version);
         }
     }
 
-    gandiva::SchemaPtr output_schema = arrow::schema(output_fields);
-    SPDLOG_INFO("output schema: {}", output_schema->ToString());
+    // large tables are streamed batch by batch
+    std::unique_ptr<Operator> source;
+    if (!in_batch) {
+        source = TableScan::Open(table.value(), db, scan_options);
+    }
+    if (!source && !in_batch) {
+        auto scanned = scan_table(table.value(), pk_index, db, scan_options);
+        if (!scanned.ok()) {
+            return scanned.status();
+        }
+        in_batch = scanned.value();
 
-    std::shared_ptr<gandiva::Projector> projector;
-    arrow::Status status;
-    status = gandiva::Projector::Make(input_schema, expressions, &projector);
-    if (!status.ok()) {
-        SPDLOG_ERROR("projector make failed: {}", status.ToString());
-        return absl::Status(absl::StatusCode::kInternal,
-                            "projector make failed: " + status.ToString());
+        // only batches of all columns are cached, they serve any statement
+        if (scan_cache && scan_options.columns.empty()) {
+            scan_cache->Put(table.value()->id, version, in_batch);
+        }
+    }
+    if (!source) {
+        source = std::make_unique<BatchSource>(in_batch);
     }
 
-    auto pool = arrow::default_memory_pool();
-    arrow::ArrayVector outputs;
-    status = projector->Evaluate(*in_batch, pool, &outputs);
-    if (!status.ok()) {
-        SPDLOG_ERROR("projector evaluate failed: {}", status.ToString());
-        return absl::Status(absl::StatusCode::kInternal,
-                            "projector evaluate failed: " + status.ToString());
+    gandiva::ExpressionVector expressions;
+    for (const auto& target : targets) {
+        auto output_field =
+            arrow::field(target.name, target.expression->return_type());
+        expressions.push_back(gandiva::TreeExprBuilder::MakeExpression(
+            target.expression, output_field));
     }
-    std::shared_ptr<arrow::RecordBatch> result =
-        arrow::RecordBatch::Make(output_schema, outputs[0]->length(), outputs);
 
-    SPDLOG_INFO("project result: {}", result->ToString());
+    // the access paths may return a superset of the matching rows (e.g. an
+    // index scan only applies the predicates on the index), the whole WHERE
+    // clause is evaluated on the batches
+    auto project = FilterProject::Make(std::move(source), condition.value(),
+                                       expressions);
+    if (!project.ok()) {
+        return project.status();
+    }
+    if (!aggregate_plan) {
+        SPDLOG_INFO("output schema: {}",
+                    project.value()->schema()->ToString());
+        return std::unique_ptr<Operator>(std::move(project.value()));
+    }
 
-    return result;
+    auto aggregate = HashAggregate::Make(std::move(project.value()),
+                                         aggregate_plan->num_keys,
+                                         aggregate_plan->aggregates);
+    if (!aggregate.ok()) {
+        return aggregate.status();
+    }
+    auto output = std::make_unique<SelectColumns>(
+        std::move(aggregate.value()), aggregate_plan->outputs,
+        aggregate_plan->names);
+    SPDLOG_INFO("output schema: {}", output->schema()->ToString());
+    return std::unique_ptr<Operator>(std::move(output));
 }
 
 }  // namespace query
@@ -28,9 +28,17 @@
 // arrow
 #include "arrow/api.h"
 
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/query/pipeline.h"
+
 namespace query {
 
-absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> query(
+// Plan the SELECT into a pipeline, the result is pulled from it batch by
+// batch. All reads of the pipeline use the snapshot taken here.
+absl::StatusOr<std::unique_ptr<Operator>> query(
     PgQuery__SelectStmt* select_stmt);
 
 }
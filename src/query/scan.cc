@@ -0,0 +1,446 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// arrow
+#include "arrow/api.h"
+
+// rocksdb
+#include "rocksdb/db.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/columnar/row_batch.h"
+#include "src/columnar/segment.h"
+#include "src/rocks/config.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/scan.h"
+
+namespace query {
+
+namespace {
+
+// Whether a scan of the table reads much more than the block cache holds,
+// see "ScanOptions::large". The rows moved into "segment" count too.
+bool is_large_table(const small::schema::Table& table,
+                    small::rocks::RocksDBWrapper* db,
+                    const small::columnar::Segment* segment = nullptr) {
+    auto block_cache_size =
+        small::rocks::get_storage_config().block_cache_size;
+    uint64_t size = db->GetApproximateTableSize(table.id);
+    if (segment) {
+        std::error_code ec;
+        auto file_size = std::filesystem::file_size(segment->path, ec);
+        if (!ec) {
+            size += file_size;
+        }
+    }
+    return size > block_cache_size / 4;
+}
+
+// Number of rows of the batch, sorted by the primary key, whose row key is not
+// greater than "key".
+int64_t rows_up_to(const small::schema::Table& table,
+                   const arrow::RecordBatch& batch, int pk_index,
+                   const std::string& key) {
+    const auto& pk = *batch.column(pk_index);
+    auto pk_type = table.columns[pk_index].type;
+    int64_t low = 0;
+    int64_t high = batch.num_rows();
+    while (low < high) {
+        int64_t mid = low + (high - low) / 2;
+        if (small::rocks::row_key(table.id, get_datum(pk, mid, pk_type)) <=
+            key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+}  // namespace
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> scan_table(
+    const std::shared_ptr<small::schema::Table>& table, int pk_index,
+    small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options) {
+    small::columnar::RowBatchBuilder builder(*table, options.columns);
+
+    // the snapshot must be taken before getting the segment, see
+    // "SegmentStore::GetSegment"
+    small::rocks::ScanOptions scan_options = options;
+    if (!scan_options.snapshot) {
+        scan_options.snapshot = db->GetSnapshot();
+    }
+    if (is_large_table(*table, db)) {
+        scan_options.large = true;
+    }
+    auto segment_store = small::columnar::SegmentStore::GetInstance();
+    std::shared_ptr<small::columnar::Segment> segment;
+    if (segment_store) {
+        segment = segment_store->GetSegment(
+            table->id, scan_options.snapshot->GetSequenceNumber());
+    }
+
+    // stream the delta (rows not moved into the segment yet) from rocksdb
+    // into the builder
+    absl::Status scan_status = absl::OkStatus();
+    try {
+        db->ScanRows(
+            *table,
+            [&](std::string_view key, std::string_view row) {
+                scan_status = builder.Append(row);
+                return scan_status.ok();
+            },
+            scan_options);
+    } catch (const std::runtime_error& e) {
+        SPDLOG_ERROR("scan failed: {}", e.what());
+        return absl::InternalError(std::string("scan failed: ") + e.what());
+    }
+    if (!scan_status.ok()) {
+        return scan_status;
+    }
+
+    auto delta = builder.Finish();
+    if (!delta.ok()) {
+        return delta.status();
+    }
+    SPDLOG_INFO("scanned {} rows from table {}", delta.value()->num_rows(),
+                table->name);
+
+    std::shared_ptr<arrow::RecordBatch> batch = delta.value();
+    if (segment) {
+        auto merged = small::columnar::merge_by_pk(segment->data,
+                                                   delta.value(), pk_index);
+        if (!merged.ok()) {
+            return merged.status();
+        }
+        auto combined = merged.value()->CombineChunksToBatch();
+        if (!combined.ok()) {
+            return absl::InternalError("failed to combine segment: " +
+                                       combined.status().ToString());
+        }
+        batch = combined.ValueOrDie();
+    }
+    if (segment_store) {
+        segment_store->MaybeScheduleCompaction(table,
+                                               delta.value()->num_rows());
+    }
+    return batch;
+}
+
+std::unique_ptr<TableScan> TableScan::Open(
+    const std::shared_ptr<small::schema::Table>& table,
+    small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options) {
+    small::rocks::ScanOptions scan_options = options;
+    if (!scan_options.snapshot) {
+        scan_options.snapshot = db->GetSnapshot();
+    }
+    auto segment_store = small::columnar::SegmentStore::GetInstance();
+    std::shared_ptr<small::columnar::Segment> segment;
+    if (segment_store) {
+        segment = segment_store->GetSegment(
+            table->id, scan_options.snapshot->GetSequenceNumber());
+    }
+    if (!is_large_table(*table, db, segment.get())) {
+        return nullptr;
+    }
+
+    scan_options.large = true;
+    return std::unique_ptr<TableScan>(
+        new TableScan(table, db, scan_options, segment));
+}
+
+TableScan::TableScan(const std::shared_ptr<small::schema::Table>& table,
+                     small::rocks::RocksDBWrapper* db,
+                     const small::rocks::ScanOptions& options,
+                     const std::shared_ptr<small::columnar::Segment>& segment)
+    : table_(table),
+      db_(db),
+      options_(options),
+      builder_(*table, options.columns),
+      pk_index_(table->get_pk_index()),
+      segment_(segment) {
+    if (segment_) {
+        // half a batch of each side, a merged window fits in a batch
+        segment_reader_ =
+            std::make_unique<arrow::TableBatchReader>(segment_->data);
+        segment_reader_->set_chunksize(kBatchRows / 2);
+    }
+}
+
+std::shared_ptr<arrow::Schema> TableScan::schema() const {
+    return builder_.schema();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> TableScan::Next() {
+    if (done_) {
+        return std::shared_ptr<arrow::RecordBatch>();
+    }
+
+    auto batch = segment_ ? NextMerged() : NextDelta();
+    if (batch.ok() && batch.value() == nullptr) {
+        done_ = true;
+        SPDLOG_INFO("scanned {} rows from table {}", num_rows_, table_->name);
+
+        // only the rows of the delta count, the segment is compacted already
+        auto segment_store = small::columnar::SegmentStore::GetInstance();
+        if (segment_store) {
+            segment_store->MaybeScheduleCompaction(table_, num_rows_);
+        }
+    }
+    return batch;
+}
+
+absl::Status TableScan::ReadDelta(int64_t limit, const std::string& bound,
+                                  bool* limited, std::string* last_key) {
+    *limited = false;
+    if (delta_done_) {
+        return absl::OkStatus();
+    }
+
+    bool at_bound = false;
+    absl::Status scan_status = absl::OkStatus();
+    try {
+        db_->ScanRows(
+            *table_,
+            [&](std::string_view key, std::string_view row) {
+                if (!bound.empty() && key > bound) {
+                    // the row is read again by the next window
+                    start_.assign(key);
+                    at_bound = true;
+                    return false;
+                }
+                scan_status = builder_.Append(row);
+                if (!scan_status.ok()) {
+                    return false;
+                }
+                last_key->assign(key);
+                return builder_.num_rows() < limit;
+            },
+            options_, start_);
+    } catch (const std::runtime_error& e) {
+        SPDLOG_ERROR("scan failed: {}", e.what());
+        return absl::InternalError(std::string("scan failed: ") + e.what());
+    }
+    if (!scan_status.ok()) {
+        return scan_status;
+    }
+
+    num_rows_ += builder_.num_rows();
+    if (at_bound) {
+        return absl::OkStatus();
+    }
+    if (builder_.num_rows() == limit) {
+        start_ = small::rocks::prefix_successor(*last_key);
+        *limited = !start_.empty();
+    }
+    delta_done_ = !*limited;
+    return absl::OkStatus();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> TableScan::NextDelta() {
+    bool limited;
+    std::string last_key;
+    auto status = ReadDelta(kBatchRows, "", &limited, &last_key);
+    if (!status.ok()) {
+        return status;
+    }
+    if (builder_.num_rows() == 0) {
+        return std::shared_ptr<arrow::RecordBatch>();
+    }
+    return builder_.Finish();
+}
+
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> TableScan::NextMerged() {
+    if (segment_rows_ && segment_rows_->num_rows() == 0) {
+        segment_rows_.reset();
+    }
+    while (!segment_rows_ && segment_reader_) {
+        auto status = segment_reader_->ReadNext(&segment_rows_);
+        if (!status.ok()) {
+            return absl::InternalError("failed to read segment: " +
+                                       status.ToString());
+        }
+        if (!segment_rows_) {
+            segment_reader_.reset();
+        } else if (segment_rows_->num_rows() == 0) {
+            segment_rows_.reset();
+        }
+    }
+    if (!segment_rows_) {
+        // the rest of the delta is after the segment
+        return NextDelta();
+    }
+
+    // the rows of the delta up to the last primary key of the window
+    auto bound = small::rocks::row_key(
+        table_->id,
+        get_datum(*segment_rows_->column(pk_index_),
+                  segment_rows_->num_rows() - 1,
+                  table_->columns[pk_index_].type));
+    bool limited;
+    std::string last_key;
+    auto status = ReadDelta(kBatchRows / 2, bound, &limited, &last_key);
+    if (!status.ok()) {
+        return status;
+    }
+    if (builder_.num_rows() == 0) {
+        auto batch = segment_rows_;
+        segment_rows_.reset();
+        return batch;
+    }
+    auto delta = builder_.Finish();
+    if (!delta.ok()) {
+        return delta.status();
+    }
+
+    // if the delta has more rows before the bound, only the segment rows up
+    // to the last one read are merged now
+    int64_t num_rows = segment_rows_->num_rows();
+    if (limited) {
+        num_rows = rows_up_to(*table_, *segment_rows_, pk_index_, last_key);
+    }
+    auto base = segment_rows_->Slice(0, num_rows);
+    segment_rows_ = segment_rows_->Slice(num_rows);
+    if (num_rows == 0) {
+        return delta;
+    }
+
+    auto base_table = arrow::Table::FromRecordBatches({base});
+    if (!base_table.ok()) {
+        return absl::InternalError("invalid segment: " +
+                                   base_table.status().ToString());
+    }
+    auto merged = small::columnar::merge_by_pk(base_table.ValueOrDie(),
+                                               delta.value(), pk_index_);
+    if (!merged.ok()) {
+        return merged.status();
+    }
+    auto combined = merged.value()->CombineChunksToBatch();
+    if (!combined.ok()) {
+        return absl::InternalError("failed to combine segment: " +
+                                   combined.status().ToString());
+    }
+    return combined.ValueOrDie();
+}
+
+small::type::Datum get_datum(const arrow::Array& array, int64_t i,
+                             small::type::Type type) {
+    if (type == small::type::Type::Int64) {
+        if (array.IsNull(i)) {
+            return int64_t(0);
+        }
+        return static_cast<const arrow::Int64Array&>(array).Value(i);
+    }
+    if (array.IsNull(i)) {
+        return std::string();
+    }
+    return static_cast<const arrow::StringArray&>(array).GetString(i);
+}
+
+absl::Status lookup_rows(const small::schema::Table& table,
+                         const std::vector<small::type::Datum>& pks,
+                         small::rocks::RocksDBWrapper* db,
+                         const RowVisitor& visitor,
+                         const small::rocks::ScanOptions& options) {
+    // the keys of all families of a row, see "family_keys"
+    size_t num_families = table.families.size() + 1;
+    std::vector<std::string> keys;
+    keys.reserve(pks.size() * num_families);
+    for (const auto& pk : pks) {
+        for (auto& key : small::rocks::family_keys(
+                 table, small::rocks::row_key(table.id, pk))) {
+            keys.push_back(std::move(key));
+        }
+    }
+
+    std::vector<rocksdb::PinnableSlice> values;
+    std::vector<rocksdb::Status> statuses;
+    db->MultiGet(rocksdb::kDefaultColumnFamilyName, keys, &values, &statuses,
+                 /*sorted_input=*/false, options);
+
+    // rows moved out of rocksdb before the snapshot are in its segment
+    uint64_t sequence = options.snapshot
+                            ? options.snapshot->GetSequenceNumber()
+                            : std::numeric_limits<uint64_t>::max();
+    auto segment_store = small::columnar::SegmentStore::GetInstance();
+    std::string assembled;
+    for (size_t i = 0; i < pks.size(); i++) {
+        size_t offset = i * num_families;
+        std::string_view row;
+        std::string cold_row;
+        bool found = num_families == 1 && statuses[offset].ok() &&
+                     !values[offset].empty();
+        if (found) {
+            // a single value, read it in place
+            row = std::string_view(values[offset].data(),
+                                   values[offset].size());
+        } else {
+            try {
+                found = small::rocks::assemble_row(table, values, statuses,
+                                                   offset, &assembled);
+            } catch (const std::runtime_error& e) {
+                return absl::InternalError(e.what());
+            }
+            row = assembled;
+        }
+        if (!found) {
+            // missing in rocksdb, the row may be moved into the segment
+            if (segment_store == nullptr ||
+                !segment_store->GetRow(table, pks[i], sequence, &cold_row)) {
+                continue;
+            }
+            row = cold_row;
+        }
+
+        auto status = visitor(i, row);
+        if (!status.ok()) {
+            return status;
+        }
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace query
@@ -0,0 +1,139 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/columnar/row_batch.h"
+#include "src/columnar/segment.h"
+#include "src/query/pipeline.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+#include "src/type/type.h"
+
+namespace query {
+
+// Called for each row found by "lookup_rows" with the position of its primary
+// key, the row is only valid during the call.
+using RowVisitor = std::function<absl::Status(size_t i, std::string_view row)>;
+
+// Scan all rows of the table: the segment merged with the delta still in
+// rocksdb, sorted by the primary key.
+//
+// The rows are read from the snapshot of "options" (a new one if it has
+// none), and so is the segment (see "SegmentStore::GetSegment").
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> scan_table(
+    const std::shared_ptr<small::schema::Table>& table, int pk_index,
+    small::rocks::RocksDBWrapper* db,
+    const small::rocks::ScanOptions& options = {});
+
+// A scan of all rows of a table in batches of "kBatchRows" rows: each batch
+// is read by a rocksdb scan resumed after the last row of the previous one,
+// from the same snapshot, so the rows are never all in memory.
+//
+// The record batches of the segment (if any) are merged with the delta one
+// window at a time: a window of the segment and the rows of the delta up to
+// its last primary key, so neither is read at once either.
+class TableScan : public Operator {
+   public:
+    // Open a scan from the snapshot of "options". Return nullptr if the table
+    // is small and must be read at once by "scan_table", its batch is worth
+    // caching (see "small::columnar::ScanCache").
+    static std::unique_ptr<TableScan> Open(
+        const std::shared_ptr<small::schema::Table>& table,
+        small::rocks::RocksDBWrapper* db,
+        const small::rocks::ScanOptions& options);
+
+    std::shared_ptr<arrow::Schema> schema() const override;
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override;
+
+   private:
+    TableScan(const std::shared_ptr<small::schema::Table>& table,
+              small::rocks::RocksDBWrapper* db,
+              const small::rocks::ScanOptions& options,
+              const std::shared_ptr<small::columnar::Segment>& segment);
+
+    std::shared_ptr<small::schema::Table> table_;
+    small::rocks::RocksDBWrapper* db_;
+    small::rocks::ScanOptions options_;
+    small::columnar::RowBatchBuilder builder_;
+    int pk_index_;
+
+    // the key to resume the delta from, empty before the first batch
+    std::string start_;
+    bool delta_done_ = false;
+
+    // the segment at the snapshot (nullptr if none), its batches point into
+    // the mapping of its file
+    std::shared_ptr<small::columnar::Segment> segment_;
+    std::unique_ptr<arrow::TableBatchReader> segment_reader_;
+
+    // rows of the current segment window not returned yet
+    std::shared_ptr<arrow::RecordBatch> segment_rows_;
+
+    bool done_ = false;
+    int64_t num_rows_ = 0;
+
+    // Read the next rows of the delta into "builder_": at most "limit" rows,
+    // with a row key not greater than "bound" unless it's empty. Set
+    // "limited" if the limit stopped the scan before the bound.
+    absl::Status ReadDelta(int64_t limit, const std::string& bound,
+                           bool* limited, std::string* last_key);
+
+    // The next batch of the delta alone.
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> NextDelta();
+
+    // The next batch of the segment merged with the delta.
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> NextMerged();
+};
+
+// Read the value at row "i" of a column, NULL is the default value of the
+// type.
+small::type::Datum get_datum(const arrow::Array& array, int64_t i,
+                             small::type::Type type);
+
+// Read the rows of the primary keys in a single batched lookup, rows moved
+// into the segment are read from it. Missing rows are skipped.
+absl::Status lookup_rows(const small::schema::Table& table,
+                         const std::vector<small::type::Datum>& pks,
+                         small::rocks::RocksDBWrapper* db,
+                         const RowVisitor& visitor,
+                         const small::rocks::ScanOptions& options = {});
+
+}  // namespace query
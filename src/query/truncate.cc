@@ -0,0 +1,86 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <memory>
+#include <string>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// rocksdb
+#include "rocksdb/db.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/columnar/scan_cache.h"
+#include "src/columnar/segment.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/truncate.h"
+
+namespace query {
+
+absl::Status truncate_table(const std::shared_ptr<small::schema::Table>& table,
+                            bool drop, small::rocks::RocksDBWrapper* db) {
+    for (const auto& index : table->indexes) {
+        auto cf_name = small::rocks::index_column_family(index);
+        if (!db->DeletePrefix(cf_name, index.id)) {
+            return absl::InternalError("failed to delete entries of index " +
+                                       index.name);
+        }
+        if (drop && !db->MarkPrefixDead(cf_name, index.id)) {
+            return absl::InternalError("failed to drop index " + index.name);
+        }
+    }
+
+    if (!db->DeletePrefix(rocksdb::kDefaultColumnFamilyName, table->id)) {
+        return absl::InternalError("failed to delete rows of table " +
+                                   table->name);
+    }
+    if (drop &&
+        !db->MarkPrefixDead(rocksdb::kDefaultColumnFamilyName, table->id)) {
+        return absl::InternalError("failed to drop table " + table->name);
+    }
+
+    // the segment holds rows deleted above, drop it after the delete so a
+    // compaction in flight can tell its delta is stale
+    auto segment_store = small::columnar::SegmentStore::GetInstance();
+    if (segment_store) {
+        segment_store->Drop(table->id, db->GetLatestSequenceNumber());
+    }
+    auto scan_cache = small::columnar::ScanCache::GetInstance();
+    if (scan_cache) {
+        scan_cache->Remove(table->id);
+    }
+
+    SPDLOG_INFO("{} table {}", drop ? "dropped" : "truncated", table->name);
+    return absl::OkStatus();
+}
+
+}  // namespace query
@@ -0,0 +1,48 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <memory>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/status.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/rocks/rocks.h"
+#include "src/schema/schema.h"
+
+namespace query {
+
+// Delete all rows of the table and the entries of its indexes in constant
+// time (see "RocksDBWrapper::DeletePrefix"), then forget its segment and
+// cached scans.
+//
+// Set "drop" if the table is dropped: the IDs of the table and its indexes
+// are dead, compactions remove their remaining keys.
+absl::Status truncate_table(const std::shared_ptr<small::schema::Table>& table,
+                            bool drop, small::rocks::RocksDBWrapper* db);
+
+}  // namespace query
@@ -0,0 +1,266 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// rocksdb
+#include "rocksdb/write_batch.h"
+
+// absl
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/catalog/catalog.h"
+#include "src/query/predicate.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/const.h"
+#include "src/schema/schema.h"
+#include "src/semantics/extract.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/query/update.h"
+
+namespace query {
+
+namespace {
+
+// "SET <column> = <value>" of an UPDATE.
+class Assignment {
+   public:
+    // index of the column in the table
+    int column_index;
+
+    // set if the value is "<column> + <delta>"
+    bool increment;
+
+    // the new value, or the delta of an increment
+    small::type::Datum value;
+};
+
+int64_t add_wrapping(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) +
+                                static_cast<uint64_t>(b));
+}
+
+// Return the delta of "<column> + <constant>", "<constant> + <column>" or
+// "<column> - <constant>", or std::nullopt if the node isn't an increment of
+// the Int64 column.
+std::optional<int64_t> get_delta(const small::schema::Table& table,
+                                 int column_index, PgQuery__Node* node) {
+    if (table.columns[column_index].type != small::type::Type::Int64 ||
+        node->node_case != PG_QUERY__NODE__NODE_A_EXPR) {
+        return std::nullopt;
+    }
+    auto a_expr = node->a_expr;
+    if (a_expr->kind != PG_QUERY__A__EXPR__KIND__AEXPR_OP ||
+        a_expr->n_name != 1 || a_expr->lexpr == nullptr ||
+        a_expr->rexpr == nullptr) {
+        return std::nullopt;
+    }
+
+    std::string op = a_expr->name[0]->string->sval;
+    if (op != "+" && op != "-") {
+        return std::nullopt;
+    }
+    PgQuery__Node* column = a_expr->lexpr;
+    PgQuery__Node* constant = a_expr->rexpr;
+    if (op == "+" && column->node_case == PG_QUERY__NODE__NODE_A_CONST) {
+        std::swap(column, constant);
+    }
+    if (get_column_index(table, column) != column_index) {
+        return std::nullopt;
+    }
+    auto delta = get_constant(table, column_index, constant);
+    if (!delta.has_value()) {
+        return std::nullopt;
+    }
+
+    int64_t value = std::get<int64_t>(delta.value());
+    return op == "+" ? value
+                     : static_cast<int64_t>(0 - static_cast<uint64_t>(value));
+}
+
+absl::StatusOr<std::vector<Assignment>> get_assignments(
+    const small::schema::Table& table, PgQuery__UpdateStmt* update_stmt) {
+    std::vector<Assignment> assignments;
+    std::vector<bool> assigned(table.columns.size(), false);
+    for (int i = 0; i < update_stmt->n_target_list; i++) {
+        auto res_target = update_stmt->target_list[i]->res_target;
+        std::string name = res_target->name;
+        int column_index = table.get_column_index(name);
+        if (column_index == -1) {
+            return absl::InvalidArgumentError("column not found: " + name);
+        }
+        if (column_index == table.get_pk_index()) {
+            return absl::UnimplementedError(
+                "updating the primary key is not supported");
+        }
+        if (assigned[column_index]) {
+            return absl::InvalidArgumentError(
+                "multiple assignments to the same column: " + name);
+        }
+        assigned[column_index] = true;
+
+        auto delta = get_delta(table, column_index, res_target->val);
+        if (delta.has_value()) {
+            assignments.push_back(Assignment{column_index, true, *delta});
+            continue;
+        }
+        auto value = get_constant(table, column_index, res_target->val);
+        if (!value.has_value()) {
+            return absl::UnimplementedError(
+                "unsupported value of column " + name +
+                ", must be a constant or an increment of the column");
+        }
+        assignments.push_back(Assignment{column_index, false, *value});
+    }
+    return assignments;
+}
+
+// Return true if the row can be updated by a blind merge.
+bool is_blind(const small::schema::Table& table,
+              const std::vector<Assignment>& assignments) {
+    for (const auto& assignment : assignments) {
+        if (!assignment.increment) {
+            return false;
+        }
+        int64_t column_id = table.columns[assignment.column_index].id;
+        for (const auto& index : table.indexes) {
+            if (index.covers(column_id)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+absl::Status update(PgQuery__UpdateStmt* update_stmt,
+                    small::rocks::RocksDBWrapper* db) {
+    auto table_name =
+        small::semantics::extract_table_name(update_stmt->relation);
+    auto result = small::catalog::Catalog::GetInstance()->GetTable(table_name);
+    if (!result.has_value()) {
+        return absl::NotFoundError("Table not found: " + table_name);
+    }
+    const auto& table = result.value();
+    if (table->id < small::schema::kFirstUserTableID) {
+        return absl::InvalidArgumentError("can't update system table: " +
+                                          table_name);
+    }
+    if (update_stmt->n_from_clause > 0 || update_stmt->n_returning_list > 0) {
+        return absl::UnimplementedError(
+            "UPDATE with FROM or RETURNING is not supported");
+    }
+    int pk_index = table->get_pk_index();
+    if (pk_index == -1) {
+        return absl::InvalidArgumentError("primary key not found: " +
+                                          table_name);
+    }
+
+    // the row must be picked by a single "<pk> = <constant>"
+    auto where_clause = update_stmt->where_clause;
+    auto predicates = extract_predicates(*table, where_clause);
+    if (where_clause == nullptr ||
+        where_clause->node_case != PG_QUERY__NODE__NODE_A_EXPR ||
+        predicates.size() != 1 || predicates[0].column_index != pk_index ||
+        predicates[0].op != "=") {
+        return absl::UnimplementedError(
+            "UPDATE is only supported by \"<primary key> = <constant>\"");
+    }
+    const auto& pk = predicates[0].value;
+
+    auto assignments = get_assignments(*table, update_stmt);
+    if (!assignments.ok()) {
+        return assignments.status();
+    }
+
+    if (is_blind(*table, assignments.value())) {
+        std::vector<int64_t> column_ids;
+        std::vector<int64_t> deltas;
+        for (const auto& assignment : assignments.value()) {
+            column_ids.push_back(table->columns[assignment.column_index].id);
+            deltas.push_back(std::get<int64_t>(assignment.value));
+        }
+        if (!db->IncrementRow(*table, pk, column_ids, deltas)) {
+            return absl::InternalError("failed to update row of table " +
+                                       table_name);
+        }
+        return absl::OkStatus();
+    }
+
+    try {
+        // held until the batch is committed, so no concurrent writer of the
+        // row reads the version whose index entries are replaced here
+        auto lock = db->LockRows(*table, {pk});
+        std::string row;
+        if (!db->GetRow(*table, pk, &row)) {
+            return absl::OkStatus();
+        }
+        auto values = small::rocks::decode_row(*table, row);
+        for (const auto& assignment : assignments.value()) {
+            auto& value = values[assignment.column_index];
+            if (assignment.increment) {
+                value = add_wrapping(std::get<int64_t>(value),
+                                     std::get<int64_t>(assignment.value));
+            } else {
+                value = assignment.value;
+            }
+        }
+
+        rocksdb::WriteBatch batch;
+        db->PutRow(&batch, table, values);
+        if (!db->Write(&batch)) {
+            return absl::InternalError("failed to update row of table " +
+                                       table_name);
+        }
+    } catch (const std::exception& e) {
+        SPDLOG_ERROR("update failed: {}", e.what());
+        return absl::InternalError(std::string("update failed: ") + e.what());
+    }
+    return absl::OkStatus();
+}
+
+}  // namespace query
@@ -0,0 +1,51 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// pg_query
+#include "pg_query.h"
+#include "pg_query.pb-c.h"
+
+// absl
+#include "absl/status/status.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/rocks/rocks.h"
+
+namespace query {
+
+// Update a row by its primary key:
+//
+//   UPDATE <table> SET <column> = <value> [, ...] WHERE <pk> = <constant>
+//
+// where <value> is a constant, or "<column> + <constant>" ("<column> -
+// <constant>") of the assigned Int64 column. If every assignment is such an
+// increment of a column no index covers, the row is incremented by a blind
+// merge (see "RocksDBWrapper::IncrementRow"), so hot counters never read the
+// row from rocksdb. Otherwise the row is read, updated and written back with
+// its index entries.
+//
+// Updating a missing row does nothing.
+absl::Status update(PgQuery__UpdateStmt* update_stmt,
+                    small::rocks::RocksDBWrapper* db);
+
+}  // namespace query
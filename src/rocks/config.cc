@@ -0,0 +1,222 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/statusor.h"
+
+// json
+#include "nlohmann/json.hpp"
+
+// rocksdb
+#include "rocksdb/cache.h"
+#include "rocksdb/rate_limiter.h"
+
+// spdlog
+#include "spdlog/spdlog.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/rocks/config.h"
+
+namespace small::rocks {
+
+NLOHMANN_JSON_SERIALIZE_ENUM(ColumnFamilyConfig::Compression,
+                             {
+                                 {ColumnFamilyConfig::Compression::None,
+                                  "none"},
+                                 {ColumnFamilyConfig::Compression::Snappy,
+                                  "snappy"},
+                                 {ColumnFamilyConfig::Compression::LZ4, "lz4"},
+                                 {ColumnFamilyConfig::Compression::ZSTD,
+                                  "zstd"},
+                             })
+
+NLOHMANN_JSON_SERIALIZE_ENUM(StorageConfig::CacheType,
+                             {
+                                 {StorageConfig::CacheType::LRU, "lru"},
+                                 {StorageConfig::CacheType::HyperClock,
+                                  "hyper_clock"},
+                             })
+
+void to_json(nlohmann::json& j, const ColumnFamilyConfig& c) {
+    j = nlohmann::json{
+        {"write_buffer_size", c.write_buffer_size},
+        {"max_write_buffer_number", c.max_write_buffer_number},
+        {"level0_file_num_compaction_trigger",
+         c.level0_file_num_compaction_trigger},
+        {"target_file_size_base", c.target_file_size_base},
+        {"max_bytes_for_level_base", c.max_bytes_for_level_base},
+        {"compression", c.compression},
+        {"bottommost_compression", c.bottommost_compression},
+        {"max_dict_bytes", c.max_dict_bytes},
+        {"zstd_max_train_bytes", c.zstd_max_train_bytes},
+    };
+}
+
+void from_json(const nlohmann::json& j, ColumnFamilyConfig& c) {
+    c.write_buffer_size = j.value("write_buffer_size", c.write_buffer_size);
+    c.max_write_buffer_number =
+        j.value("max_write_buffer_number", c.max_write_buffer_number);
+    c.level0_file_num_compaction_trigger =
+        j.value("level0_file_num_compaction_trigger",
+                c.level0_file_num_compaction_trigger);
+    c.target_file_size_base =
+        j.value("target_file_size_base", c.target_file_size_base);
+    c.max_bytes_for_level_base =
+        j.value("max_bytes_for_level_base", c.max_bytes_for_level_base);
+    c.compression = j.value("compression", c.compression);
+    c.bottommost_compression =
+        j.value("bottommost_compression", c.bottommost_compression);
+    c.max_dict_bytes = j.value("max_dict_bytes", c.max_dict_bytes);
+    c.zstd_max_train_bytes =
+        j.value("zstd_max_train_bytes", c.zstd_max_train_bytes);
+}
+
+void to_json(nlohmann::json& j, const StorageConfig& c) {
+    j = nlohmann::json{
+        {"block_cache_type", c.block_cache_type},
+        {"block_cache_size", c.block_cache_size},
+        {"write_buffer_budget", c.write_buffer_budget},
+        {"max_background_jobs", c.max_background_jobs},
+        {"compaction_rate_limit", c.compaction_rate_limit},
+        {"statistics", c.statistics},
+        {"scan_cache_size", c.scan_cache_size},
+        {"default_column_family", c.default_column_family},
+        {"column_families", c.column_families},
+    };
+}
+
+void from_json(const nlohmann::json& j, StorageConfig& c) {
+    c.block_cache_type = j.value("block_cache_type", c.block_cache_type);
+    c.block_cache_size = j.value("block_cache_size", c.block_cache_size);
+    c.write_buffer_budget =
+        j.value("write_buffer_budget", c.write_buffer_budget);
+    c.max_background_jobs =
+        j.value("max_background_jobs", c.max_background_jobs);
+    c.compaction_rate_limit =
+        j.value("compaction_rate_limit", c.compaction_rate_limit);
+    c.statistics = j.value("statistics", c.statistics);
+    c.scan_cache_size = j.value("scan_cache_size", c.scan_cache_size);
+    if (j.contains("default_column_family")) {
+        from_json(j.at("default_column_family"), c.default_column_family);
+    }
+    if (j.contains("column_families")) {
+        for (const auto& [name, cf_json] : j.at("column_families").items()) {
+            // column families start from the default settings
+            ColumnFamilyConfig cf = c.default_column_family;
+            from_json(cf_json, cf);
+            c.column_families[name] = cf;
+        }
+    }
+}
+
+const ColumnFamilyConfig& StorageConfig::get_column_family(
+    const std::string& cf_name) const {
+    auto it = column_families.find(cf_name);
+    if (it != column_families.end()) {
+        return it->second;
+    }
+    return default_column_family;
+}
+
+std::string StorageConfig::to_string() const {
+    return nlohmann::json(*this).dump();
+}
+
+absl::StatusOr<StorageConfig> load_storage_config(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return absl::NotFoundError("failed to open storage config: " + path);
+    }
+
+    try {
+        return nlohmann::json::parse(file).get<StorageConfig>();
+    } catch (const nlohmann::json::exception& e) {
+        return absl::InvalidArgumentError(
+            "invalid storage config " + path + ": " + e.what());
+    }
+}
+
+namespace {
+
+StorageConfig storage_config;
+
+std::once_flag block_cache_once;
+std::shared_ptr<rocksdb::Cache> block_cache;
+
+std::once_flag rate_limiter_once;
+std::shared_ptr<rocksdb::RateLimiter> rate_limiter;
+
+}  // namespace
+
+void init_storage_config(const StorageConfig& config) {
+    storage_config = config;
+}
+
+const StorageConfig& get_storage_config() { return storage_config; }
+
+std::shared_ptr<rocksdb::Cache> get_block_cache() {
+    std::call_once(block_cache_once, []() {
+        const auto& config = get_storage_config();
+        switch (config.block_cache_type) {
+            case StorageConfig::CacheType::HyperClock: {
+                // estimated_entry_charge = 0 lets the cache size its table
+                // automatically
+                rocksdb::HyperClockCacheOptions options(
+                    config.block_cache_size, /*estimated_entry_charge=*/0);
+                block_cache = options.MakeSharedCache();
+                break;
+            }
+            case StorageConfig::CacheType::LRU:
+            default: {
+                // keep half of the cache for index and filter blocks (they
+                // are inserted with high priority)
+                rocksdb::LRUCacheOptions options;
+                options.capacity = config.block_cache_size;
+                options.high_pri_pool_ratio = 0.5;
+                block_cache = options.MakeSharedCache();
+                break;
+            }
+        }
+    });
+    return block_cache;
+}
+
+std::shared_ptr<rocksdb::RateLimiter> get_rate_limiter() {
+    std::call_once(rate_limiter_once, []() {
+        const auto& config = get_storage_config();
+        if (config.compaction_rate_limit > 0) {
+            rate_limiter.reset(
+                rocksdb::NewGenericRateLimiter(config.compaction_rate_limit));
+        }
+    });
+    return rate_limiter;
+}
+
+}  // namespace small::rocks
@@ -0,0 +1,170 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/statusor.h"
+
+// json
+#include "nlohmann/json.hpp"
+
+// rocksdb
+#include "rocksdb/cache.h"
+#include "rocksdb/rate_limiter.h"
+
+namespace small::rocks {
+
+// Memtable, compaction and compression settings of a column family.
+class ColumnFamilyConfig {
+   public:
+    enum class Compression {
+        None,
+        Snappy,
+        LZ4,
+        ZSTD,
+    };
+
+    // size of a single memtable
+    uint64_t write_buffer_size = 64 << 20;
+
+    // max number of memtables (active + immutable) before writes stall
+    int max_write_buffer_number = 4;
+
+    // number of L0 files to trigger a compaction into L1
+    int level0_file_num_compaction_trigger = 4;
+
+    // target size of SST files in L1, grows by 10x per level
+    uint64_t target_file_size_base = 64 << 20;
+
+    // max total size of L1
+    uint64_t max_bytes_for_level_base = 256 << 20;
+
+    // compression of SST files above the last level
+    Compression compression = Compression::Snappy;
+
+    // compression of the last level, which holds most of the data
+    Compression bottommost_compression = Compression::Snappy;
+
+    // Max size of the ZSTD dictionary of an SST file, 0 disables dictionaries.
+    // Only used by the levels compressed by ZSTD.
+    // A dictionary is built from samples of the blocks written by a
+    // compaction, so small blocks of similar values (names, JSON, ...)
+    // compress well although each block is compressed alone.
+    uint32_t max_dict_bytes = 0;
+
+    // Bytes of samples to train the dictionary on (about 100x
+    // "max_dict_bytes"), 0 uses the raw samples as the dictionary.
+    uint32_t zstd_max_train_bytes = 0;
+};
+
+// Storage settings of a server, they are applied when rocksdb is opened. They
+// can be loaded from a JSON file, for example:
+//
+// {
+//     "block_cache_type": "hyper_clock",
+//     "block_cache_size": 4294967296,
+//     "max_background_jobs": 8,
+//     "compaction_rate_limit": 104857600,
+//     "column_families": {
+//         "default": {"write_buffer_size": 134217728,
+//                     "bottommost_compression": "zstd",
+//                     "max_dict_bytes": 16384,
+//                     "zstd_max_train_bytes": 1638400}
+//     }
+// }
+//
+// Missing fields keep their default values.
+class StorageConfig {
+   public:
+    enum class CacheType {
+        LRU,
+        HyperClock,
+    };
+
+    // The block cache is shared by all column families (and all rocksdb
+    // instances of the process), so its size is the memory budget of the
+    // cached data/index/filter blocks.
+    CacheType block_cache_type = CacheType::LRU;
+    uint64_t block_cache_size = 512 << 20;
+
+    // Budget of all memtables across column families, charged to the block
+    // cache. 0 means no limit other than the per column family settings.
+    uint64_t write_buffer_budget = 0;
+
+    // max number of concurrent flushes and compactions
+    int max_background_jobs = 4;
+
+    // bytes per second of flushes and compactions, 0 means unlimited
+    uint64_t compaction_rate_limit = 0;
+
+    // Collect rocksdb statistics (e.g. the time spent decompressing blocks,
+    // see "RocksDBWrapper::GetStorageReport") at the cost of a few percent
+    // of CPU.
+    bool statistics = false;
+
+    // Disk (and page cache) budget of the scan cache, see
+    // "small::columnar::ScanCache". 0 disables the cache.
+    uint64_t scan_cache_size = 256 << 20;
+
+    // settings of column families without an entry in "column_families"
+    ColumnFamilyConfig default_column_family;
+
+    // settings of column families by name
+    std::map<std::string, ColumnFamilyConfig> column_families;
+
+    const ColumnFamilyConfig& get_column_family(
+        const std::string& cf_name) const;
+
+    std::string to_string() const;
+};
+
+void to_json(nlohmann::json& j, const ColumnFamilyConfig& c);
+
+void from_json(const nlohmann::json& j, ColumnFamilyConfig& c);
+
+void to_json(nlohmann::json& j, const StorageConfig& c);
+
+void from_json(const nlohmann::json& j, StorageConfig& c);
+
+absl::StatusOr<StorageConfig> load_storage_config(const std::string& path);
+
+// Set the storage config of the process, must be called before any rocksdb
+// instance is opened. The default config is used if it's never called.
+void init_storage_config(const StorageConfig& config);
+
+const StorageConfig& get_storage_config();
+
+// The block cache shared by all rocksdb instances of the process, created on
+// first use according to the storage config.
+std::shared_ptr<rocksdb::Cache> get_block_cache();
+
+// The rate limiter of flushes and compactions shared by all rocksdb instances
+// of the process, or nullptr if compactions are not rate limited.
+std::shared_ptr<rocksdb::RateLimiter> get_rate_limiter();
+
+}  // namespace small::rocks
@@ -0,0 +1,413 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <deque>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// rocksdb
+#include "rocksdb/compaction_filter.h"
+#include "rocksdb/db.h"
+#include "rocksdb/filter_policy.h"
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/slice_transform.h"
+#include "rocksdb/statistics.h"
+#include "rocksdb/table.h"
+#include "rocksdb/write_buffer_manager.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/bitmap/bitmap.h"
+#include "src/encode/encode.h"
+#include "src/rocks/config.h"
+#include "src/type/type.h"
+
+// =====================================================================
+// self header
+// =====================================================================
+
+#include "src/rocks/options.h"
+
+namespace small::rocks {
+
+namespace {
+
+// Length of the "<varint table ID>" prefix, or 0 if the key doesn't start
+// with a complete varint.
+size_t table_prefix_length(const rocksdb::Slice& key) {
+    std::string_view input(key.data(), key.size());
+    uint64_t table_id;
+    if (!small::encode::get_varint64(&input, &table_id)) {
+        return 0;
+    }
+    return key.size() - input.size();
+}
+
+// Return true if the key starts with a dead prefix.
+bool is_dead(const DeadPrefixes& dead_prefixes, const rocksdb::Slice& key) {
+    std::string_view input(key.data(), key.size());
+    uint64_t id;
+    if (!small::encode::get_varint64(&input, &id)) {
+        return false;
+    }
+    return dead_prefixes.Contains(static_cast<int64_t>(id));
+}
+
+// Column ID -> delta of increment operands.
+using Deltas = std::map<int64_t, int64_t>;
+
+int64_t add_wrapping(int64_t a, int64_t b) {
+    return static_cast<int64_t>(static_cast<uint64_t>(a) +
+                                static_cast<uint64_t>(b));
+}
+
+// Add the deltas of an increment operand to "deltas", return false if the
+// operand is corrupted.
+bool add_deltas(std::string_view operand, Deltas* deltas) {
+    try {
+        small::encode::RowReader reader(operand);
+        int64_t column_id;
+        std::string_view cell;
+        while (reader.Next(&column_id, &cell)) {
+            int64_t delta;
+            if (!small::encode::decode_int64(cell, &delta)) {
+                return false;
+            }
+            (*deltas)[column_id] = add_wrapping((*deltas)[column_id], delta);
+        }
+    } catch (const std::exception& e) {
+        return false;
+    }
+    return true;
+}
+
+std::string encode_deltas(const Deltas& deltas) {
+    std::vector<int64_t> column_ids;
+    std::vector<std::string> columns;
+    for (const auto& [column_id, delta] : deltas) {
+        column_ids.push_back(column_id);
+        columns.push_back(small::encode::encode_value(delta));
+    }
+    return small::encode::encode_row(column_ids, columns);
+}
+
+// Add the deltas to the columns of a packed row, columns missing in the row
+// are appended.
+bool apply_deltas(std::string_view row, Deltas deltas, std::string* new_row) {
+    std::vector<int64_t> column_ids;
+    std::vector<std::string> columns;
+    try {
+        small::encode::RowReader reader(row);
+        int64_t column_id;
+        std::string_view cell;
+        while (reader.Next(&column_id, &cell)) {
+            column_ids.push_back(column_id);
+            auto it = deltas.find(column_id);
+            if (it == deltas.end()) {
+                columns.emplace_back(cell);
+                continue;
+            }
+            int64_t value;
+            if (!small::encode::decode_int64(cell, &value)) {
+                return false;
+            }
+            columns.push_back(
+                small::encode::encode_value(add_wrapping(value, it->second)));
+            deltas.erase(it);
+        }
+    } catch (const std::exception& e) {
+        return false;
+    }
+
+    for (const auto& [column_id, delta] : deltas) {
+        column_ids.push_back(column_id);
+        columns.push_back(small::encode::encode_value(delta));
+    }
+    *new_row = small::encode::encode_row(column_ids, columns);
+    return true;
+}
+
+rocksdb::CompressionType to_compression_type(
+    ColumnFamilyConfig::Compression compression) {
+    switch (compression) {
+        case ColumnFamilyConfig::Compression::None:
+            return rocksdb::kNoCompression;
+        case ColumnFamilyConfig::Compression::LZ4:
+            return rocksdb::kLZ4Compression;
+        case ColumnFamilyConfig::Compression::ZSTD:
+            return rocksdb::kZSTD;
+        case ColumnFamilyConfig::Compression::Snappy:
+        default:
+            return rocksdb::kSnappyCompression;
+    }
+}
+
+rocksdb::BlockBasedTableOptions get_table_options() {
+    rocksdb::BlockBasedTableOptions table_options;
+    table_options.block_size = 16 * 1024;
+    table_options.block_cache = get_block_cache();
+
+    // Bloom filters for L0 (fast to build, L0 files are short-lived) and
+    // Ribbon filters for the other levels (~30% less memory for the same
+    // false positive rate).
+    table_options.filter_policy.reset(
+        rocksdb::NewRibbonFilterPolicy(10, /*bloom_before_level=*/1));
+
+    // Partition index and filters so only the top-level index has to stay in
+    // memory for large SST files, the partitions go through the block cache.
+    table_options.index_type =
+        rocksdb::BlockBasedTableOptions::IndexType::kTwoLevelIndexSearch;
+    table_options.partition_filters = true;
+    table_options.metadata_block_size = 4 * 1024;
+    table_options.cache_index_and_filter_blocks = true;
+    table_options.pin_top_level_index_and_filter = true;
+    table_options.cache_index_and_filter_blocks_with_high_priority = true;
+
+    // the readahead of sequential reads (e.g. large scans) doubles from 8KB
+    // up to this size
+    table_options.max_auto_readahead_size = 1 << 20;
+
+    return table_options;
+}
+
+}  // namespace
+
+rocksdb::Slice TablePrefixTransform::Transform(
+    const rocksdb::Slice& key) const {
+    return rocksdb::Slice(key.data(), table_prefix_length(key));
+}
+
+bool TablePrefixTransform::InDomain(const rocksdb::Slice& key) const {
+    return table_prefix_length(key) > 0;
+}
+
+void DeadPrefixes::Add(int64_t id) {
+    std::unique_lock lock(mutex_);
+    ids_.insert(id);
+}
+
+bool DeadPrefixes::Contains(int64_t id) const {
+    std::shared_lock lock(mutex_);
+    return ids_.count(id) > 0;
+}
+
+std::shared_ptr<DeadPrefixes> get_dead_prefixes(const std::string& cf_name) {
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<DeadPrefixes>>
+        dead_prefixes;
+
+    std::lock_guard lock(mutex);
+    auto& result = dead_prefixes[cf_name];
+    if (!result) {
+        result = std::make_shared<DeadPrefixes>();
+    }
+    return result;
+}
+
+DeadPrefixFilter::DeadPrefixFilter(std::shared_ptr<DeadPrefixes> dead_prefixes)
+    : dead_prefixes_(std::move(dead_prefixes)) {}
+
+bool DeadPrefixFilter::Filter(int level, const rocksdb::Slice& key,
+                              const rocksdb::Slice& existing_value,
+                              std::string* new_value,
+                              bool* value_changed) const {
+    return is_dead(*dead_prefixes_, key);
+}
+
+bool DeadPrefixFilter::FilterMergeOperand(int level, const rocksdb::Slice& key,
+                                          const rocksdb::Slice& operand) const {
+    return is_dead(*dead_prefixes_, key);
+}
+
+DeadPrefixFilterFactory::DeadPrefixFilterFactory(
+    std::shared_ptr<DeadPrefixes> dead_prefixes)
+    : dead_prefixes_(std::move(dead_prefixes)) {}
+
+std::unique_ptr<rocksdb::CompactionFilter>
+DeadPrefixFilterFactory::CreateCompactionFilter(
+    const rocksdb::CompactionFilter::Context& context) {
+    return std::make_unique<DeadPrefixFilter>(dead_prefixes_);
+}
+
+std::string increment_operand(const std::vector<int64_t>& column_ids,
+                              const std::vector<int64_t>& deltas) {
+    std::vector<std::string> columns;
+    columns.reserve(deltas.size());
+    for (int64_t delta : deltas) {
+        columns.push_back(small::encode::encode_value(delta));
+    }
+    return small::encode::encode_row(column_ids, columns);
+}
+
+bool apply_increment(std::string_view row, std::string_view operand,
+                     std::string* new_row) {
+    Deltas deltas;
+    if (!add_deltas(operand, &deltas)) {
+        return false;
+    }
+    return apply_deltas(row, std::move(deltas), new_row);
+}
+
+bool RowMergeOperator::FullMergeV2(const MergeOperationInput& merge_in,
+                                   MergeOperationOutput* merge_out) const {
+    // there is no row to increment
+    const rocksdb::Slice* existing = merge_in.existing_value;
+    if (existing == nullptr || existing->empty()) {
+        merge_out->new_value.clear();
+        return true;
+    }
+
+    Deltas deltas;
+    for (const auto& operand : merge_in.operand_list) {
+        if (!add_deltas(std::string_view(operand.data(), operand.size()),
+                        &deltas)) {
+            return false;
+        }
+    }
+    return apply_deltas(std::string_view(existing->data(), existing->size()),
+                        std::move(deltas), &merge_out->new_value);
+}
+
+bool RowMergeOperator::PartialMergeMulti(
+    const rocksdb::Slice& key, const std::deque<rocksdb::Slice>& operand_list,
+    std::string* new_value, rocksdb::Logger* logger) const {
+    Deltas deltas;
+    for (const auto& operand : operand_list) {
+        if (!add_deltas(std::string_view(operand.data(), operand.size()),
+                        &deltas)) {
+            return false;
+        }
+    }
+    *new_value = encode_deltas(deltas);
+    return true;
+}
+
+rocksdb::Options get_db_options() {
+    const auto& config = get_storage_config();
+
+    rocksdb::Options options;
+    options.create_if_missing = true;
+    options.create_missing_column_families = true;
+
+    options.max_background_jobs = config.max_background_jobs;
+    options.rate_limiter = get_rate_limiter();
+
+    // smooth out the write I/O of flushes and compactions
+    options.bytes_per_sync = 1 << 20;
+
+    if (config.statistics) {
+        // the detailed timers include the decompression time
+        options.statistics = rocksdb::CreateDBStatistics();
+        options.statistics->set_stats_level(
+            rocksdb::StatsLevel::kExceptTimeForMutex);
+    }
+
+    if (config.write_buffer_budget > 0) {
+        // charge memtables to the block cache, so the block cache size is
+        // the memory budget of both
+        options.write_buffer_manager =
+            std::make_shared<rocksdb::WriteBufferManager>(
+                config.write_buffer_budget, get_block_cache());
+    }
+
+    return options;
+}
+
+rocksdb::ColumnFamilyOptions get_cf_options(const std::string& cf_name) {
+    const auto& config = get_storage_config().get_column_family(cf_name);
+
+    rocksdb::ColumnFamilyOptions cf_options;
+    cf_options.write_buffer_size = config.write_buffer_size;
+    cf_options.max_write_buffer_number = config.max_write_buffer_number;
+    cf_options.level0_file_num_compaction_trigger =
+        config.level0_file_num_compaction_trigger;
+    cf_options.target_file_size_base = config.target_file_size_base;
+    cf_options.max_bytes_for_level_base = config.max_bytes_for_level_base;
+    cf_options.level_compaction_dynamic_level_bytes = true;
+
+    cf_options.compression = to_compression_type(config.compression);
+    cf_options.bottommost_compression =
+        to_compression_type(config.bottommost_compression);
+
+    // the dictionary is stored in the SST file and cached with the index and
+    // filter blocks, only ZSTD makes use of it
+    using Compression = ColumnFamilyConfig::Compression;
+    if (config.max_dict_bytes > 0 && config.compression == Compression::ZSTD) {
+        cf_options.compression_opts.max_dict_bytes = config.max_dict_bytes;
+        cf_options.compression_opts.zstd_max_train_bytes =
+            config.zstd_max_train_bytes;
+    }
+    if (config.max_dict_bytes > 0 &&
+        config.bottommost_compression == Compression::ZSTD) {
+        auto& opts = cf_options.bottommost_compression_opts;
+        opts.max_dict_bytes = config.max_dict_bytes;
+        opts.zstd_max_train_bytes = config.zstd_max_train_bytes;
+        opts.enabled = true;
+    }
+
+    auto table_options = get_table_options();
+
+    // whole key filter for point lookups
+    table_options.whole_key_filtering = true;
+
+    if (cf_name == rocksdb::kDefaultColumnFamilyName || cf_name == "IndexCF" ||
+        cf_name == "BitmapCF") {
+        // prefix filter for table (index) scans, also in the memtable, index
+        // entries are prefixed by the varint index ID the same way
+        cf_options.prefix_extractor = std::make_shared<TablePrefixTransform>();
+        cf_options.memtable_prefix_bloom_size_ratio = 0.02;
+
+        // keys of dropped tables (indexes)
+        cf_options.compaction_filter_factory =
+            std::make_shared<DeadPrefixFilterFactory>(
+                get_dead_prefixes(cf_name));
+    }
+
+    if (cf_name == rocksdb::kDefaultColumnFamilyName) {
+        // "UPDATE ... SET c = c + k" increments rows by merge operands
+        cf_options.merge_operator = std::make_shared<RowMergeOperator>();
+    }
+
+    if (cf_name == "BitmapCF") {
+        // row writes add/remove row IDs by merge operands
+        cf_options.merge_operator =
+            std::make_shared<small::bitmap::ContainerMergeOperator>();
+    }
+
+    cf_options.table_factory.reset(
+        rocksdb::NewBlockBasedTableFactory(table_options));
+    return cf_options;
+}
+
+}  // namespace small::rocks
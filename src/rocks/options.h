@@ -0,0 +1,154 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+#include "rocksdb/compaction_filter.h"
+#include "rocksdb/merge_operator.h"
+#include "rocksdb/options.h"
+#include "rocksdb/slice.h"
+#include "rocksdb/slice_transform.h"
+
+namespace small::rocks {
+
+// Extract the table prefix ("<varint table ID>") from a row key (see
+// "row_key"), so prefix bloom filters can tell whether an SST file contains
+// any row of a table.
+class TablePrefixTransform : public rocksdb::SliceTransform {
+   public:
+    const char* Name() const override { return "small.TablePrefix"; }
+
+    rocksdb::Slice Transform(const rocksdb::Slice& key) const override;
+
+    bool InDomain(const rocksdb::Slice& key) const override;
+};
+
+// IDs of the "<varint ID>" key prefixes (tables in the default column family,
+// indexes in "IndexCF" and "BitmapCF") whose keys are all dead, e.g. of a
+// dropped table. Compactions read it concurrently.
+//
+// The IDs are persisted by "RocksDBWrapper::MarkPrefixDead".
+class DeadPrefixes {
+   public:
+    void Add(int64_t id);
+
+    bool Contains(int64_t id) const;
+
+   private:
+    mutable std::shared_mutex mutex_;
+    std::unordered_set<int64_t> ids_;
+};
+
+// Return the dead prefixes of a column family.
+std::shared_ptr<DeadPrefixes> get_dead_prefixes(const std::string& cf_name);
+
+// Remove keys and merge operands with a dead prefix in every compaction, so
+// the space of a dropped table is reclaimed even where its range tombstone
+// isn't part of the compaction.
+class DeadPrefixFilter : public rocksdb::CompactionFilter {
+   public:
+    explicit DeadPrefixFilter(std::shared_ptr<DeadPrefixes> dead_prefixes);
+
+    const char* Name() const override { return "small.DeadPrefix"; }
+
+    bool Filter(int level, const rocksdb::Slice& key,
+                const rocksdb::Slice& existing_value, std::string* new_value,
+                bool* value_changed) const override;
+
+    bool FilterMergeOperand(int level, const rocksdb::Slice& key,
+                            const rocksdb::Slice& operand) const override;
+
+   private:
+    std::shared_ptr<DeadPrefixes> dead_prefixes_;
+};
+
+class DeadPrefixFilterFactory : public rocksdb::CompactionFilterFactory {
+   public:
+    explicit DeadPrefixFilterFactory(
+        std::shared_ptr<DeadPrefixes> dead_prefixes);
+
+    const char* Name() const override { return "small.DeadPrefixFactory"; }
+
+    std::unique_ptr<rocksdb::CompactionFilter> CreateCompactionFilter(
+        const rocksdb::CompactionFilter::Context& context) override;
+
+   private:
+    std::shared_ptr<DeadPrefixes> dead_prefixes_;
+};
+
+// A merge operand of a row adds deltas to Int64 columns, packed like a row
+// (see "small::encode::encode_row"): the delta of each column is encoded by
+// "small::encode::encode_value".
+std::string increment_operand(const std::vector<int64_t>& column_ids,
+                              const std::vector<int64_t>& deltas);
+
+// Apply an increment operand to a packed row, a column missing in the row
+// counts as 0. Additions wrap around on overflow. Return false if the row or
+// the operand is corrupted.
+bool apply_increment(std::string_view row, std::string_view operand,
+                     std::string* new_row);
+
+// Apply increment operands to rows, so "UPDATE ... SET c = c + k" is a blind
+// write instead of a read-modify-write. Increments of the same column are
+// associative, so operands are combined before the row is seen.
+//
+// A row with no base value doesn't exist (or was deleted), the increments
+// leave an empty value which readers treat as a missing row.
+class RowMergeOperator : public rocksdb::MergeOperator {
+   public:
+    bool FullMergeV2(const MergeOperationInput& merge_in,
+                     MergeOperationOutput* merge_out) const override;
+
+    bool PartialMergeMulti(const rocksdb::Slice& key,
+                           const std::deque<rocksdb::Slice>& operand_list,
+                           std::string* new_value,
+                           rocksdb::Logger* logger) const override;
+
+    const char* Name() const override { return "small.RowMerge"; }
+};
+
+// Options of the whole database.
+rocksdb::Options get_db_options();
+
+// Options of a column family, chosen by the layout of its keys:
+//
+// - "default": rows of all tables, keyed by "<varint table ID><pk>". Scans are
+//   always bounded to a table, so it gets a prefix bloom filter on the table
+//   prefix in addition to the whole key filter used by point lookups.
+//   Increments of Int64 columns are merged into the rows.
+// - "IndexCF" and "BitmapCF": index entries (bitmap containers), keyed by
+//   "<varint index ID>..." and scanned per index, so they get the same prefix
+//   bloom filter. "BitmapCF" merges add/remove operands into containers.
+// - others: catalog metadata, keyed by short strings (e.g. "T:<table ID>") and
+//   only accessed by point lookups, so it only gets a whole key filter.
+rocksdb::ColumnFamilyOptions get_cf_options(const std::string& cf_name);
+
+}  // namespace small::rocks
@@ -17,10 +17,18 @@
 // =====================================================================
 
 #include <filesystem>
+#include <algorithm>
+#include <charconv>
+#include <functional>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 // =====================================================================
@@ -29,19 +37,27 @@
 
 // rocksdb
 #include "rocksdb/db.h"
-#include "rocksdb/filter_policy.h"
+#include "rocksdb/convenience.h"
 #include "rocksdb/options.h"
-#include "rocksdb/slice_transform.h"
-#include "rocksdb/table.h"
+#include "rocksdb/sst_file_writer.h"
+#include "rocksdb/statistics.h"
+#include "rocksdb/table_properties.h"
+#include "rocksdb/write_batch.h"
 
 // absl
 #include "absl/strings/str_format.h"
 
+// spdlog
+#include "spdlog/spdlog.h"
+
 // =====================================================================
 // local libraries
 // =====================================================================
 
+#include "src/bitmap/bitmap.h"
 #include "src/encode/encode.h"
+#include "src/rocks/config.h"
+#include "src/rocks/options.h"
 #include "src/schema/schema.h"
 #include "src/type/type.h"
 
@@ -53,25 +69,399 @@
 
 namespace small::rocks {
 
+namespace {
+
+// Pack the columns of a family of a row, see "small::encode::encode_row".
+std::string pack_family(const small::schema::Table& table,
+                        const std::vector<small::type::Datum>& values,
+                        int64_t family_id) {
+    std::vector<int64_t> column_ids;
+    std::vector<std::string> columns;
+    column_ids.reserve(values.size());
+    columns.reserve(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+        int64_t column_id = table.columns[i].id;
+        if (!table.families.empty() &&
+            table.get_family_id(column_id) != family_id) {
+            continue;
+        }
+        column_ids.push_back(column_id);
+        columns.push_back(small::encode::encode_value(values[i]));
+    }
+    return small::encode::encode_row(column_ids, columns);
+}
+
+// Pack the families of a row, keyed by "family_key" with the primary family
+// first.
+std::vector<std::pair<std::string, std::string>> pack_families(
+    const small::schema::Table& table,
+    const std::vector<small::type::Datum>& values) {
+    auto key = row_key(table.id, values[table.get_pk_index()]);
+    std::vector<std::pair<std::string, std::string>> kv_pairs;
+    kv_pairs.emplace_back(key, pack_family(table, values, 0));
+    for (const auto& family : table.families) {
+        kv_pairs.emplace_back(family_key(key, family.id),
+                              pack_family(table, values, family.id));
+    }
+    return kv_pairs;
+}
+
+// Decode the values of a row received in the wire format.
+std::vector<small::type::Datum> decode_wire(
+    const small::schema::Table& table, const std::vector<std::string>& values) {
+    std::vector<small::type::Datum> datums;
+    datums.reserve(values.size());
+    for (int i = 0; i < values.size(); ++i) {
+        datums.push_back(
+            small::encode::decode(values[i], table.columns[i].type));
+    }
+    return datums;
+}
+
+// Collect IDs of the tables with rows in a write batch.
+class TableCollector : public rocksdb::WriteBatch::Handler {
+   public:
+    std::unordered_set<int64_t> table_ids;
+
+    rocksdb::Status PutCF(uint32_t cf_id, const rocksdb::Slice& key,
+                          const rocksdb::Slice& value) override {
+        Add(cf_id, key);
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status DeleteCF(uint32_t cf_id,
+                             const rocksdb::Slice& key) override {
+        Add(cf_id, key);
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status SingleDeleteCF(uint32_t cf_id,
+                                   const rocksdb::Slice& key) override {
+        Add(cf_id, key);
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status DeleteRangeCF(uint32_t cf_id,
+                                  const rocksdb::Slice& begin_key,
+                                  const rocksdb::Slice& end_key) override {
+        Add(cf_id, begin_key);
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status MergeCF(uint32_t cf_id, const rocksdb::Slice& key,
+                            const rocksdb::Slice& value) override {
+        Add(cf_id, key);
+        return rocksdb::Status::OK();
+    }
+
+   private:
+    void Add(uint32_t cf_id, const rocksdb::Slice& key) {
+        // rows are in the default column family, its ID is always 0
+        if (cf_id != 0) {
+            return;
+        }
+        std::string_view input(key.data(), key.size());
+        uint64_t table_id;
+        if (small::encode::get_varint64(&input, &table_id)) {
+            table_ids.insert(static_cast<int64_t>(table_id));
+        }
+    }
+};
+
+// Keys of the dead prefixes in "TablesCF" are "D:<column family>:<ID>".
+constexpr char kDeadPrefixTag[] = "D:";
+
+std::string dead_prefix_key(const std::string& cf_name, int64_t id) {
+    return kDeadPrefixTag + cf_name + ":" + std::to_string(id);
+}
+
+// Return whether each row is the last one with its primary key, the rows
+// before it are overridden.
+std::vector<bool> find_last_rows(
+    const small::schema::Table& table,
+    const std::vector<std::vector<small::type::Datum>>& rows) {
+    int pk_index = table.get_pk_index();
+    std::unordered_map<std::string, size_t> last_rows;
+    for (size_t i = 0; i < rows.size(); i++) {
+        last_rows[row_key(table.id, rows[i][pk_index])] = i;
+    }
+    std::vector<bool> is_last(rows.size());
+    for (const auto& [key, i] : last_rows) {
+        is_last[i] = true;
+    }
+    return is_last;
+}
+
+// An entry of an SST file written by "IngestRows".
+class SstEntry {
+   public:
+    enum class Op { kPut, kDelete, kMerge };
+
+    Op op;
+    std::string value;
+};
+
+// Collect the writes of a batch into the entries of SST files, keyed by
+// column family ID and sorted by key. An SST file holds one entry per key,
+// so the merge operands of a key are concatenated, see
+// "small::bitmap::ContainerMergeOperator".
+class SstEntryCollector : public rocksdb::WriteBatch::Handler {
+   public:
+    std::map<uint32_t, std::map<std::string, SstEntry>> entries;
+
+    rocksdb::Status PutCF(uint32_t cf_id, const rocksdb::Slice& key,
+                          const rocksdb::Slice& value) override {
+        entries[cf_id][key.ToString()] =
+            SstEntry{SstEntry::Op::kPut, value.ToString()};
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status DeleteCF(uint32_t cf_id,
+                             const rocksdb::Slice& key) override {
+        entries[cf_id][key.ToString()] = SstEntry{SstEntry::Op::kDelete, ""};
+        return rocksdb::Status::OK();
+    }
+
+    rocksdb::Status MergeCF(uint32_t cf_id, const rocksdb::Slice& key,
+                            const rocksdb::Slice& value) override {
+        auto [it, inserted] = entries[cf_id].try_emplace(
+            key.ToString(), SstEntry{SstEntry::Op::kMerge, ""});
+        if (it->second.op != SstEntry::Op::kMerge) {
+            return rocksdb::Status::NotSupported(
+                "merge after a put or delete of the same key");
+        }
+        it->second.value.append(value.data(), value.size());
+        return rocksdb::Status::OK();
+    }
+};
+
+// Write an SST file of a column family for "IngestRows", "add" adds the
+// entries in key order. The file is removed if it fails.
+rocksdb::Status write_sst_file(
+    const std::string& path, const std::string& cf_name,
+    rocksdb::ColumnFamilyHandle* handle,
+    const std::function<rocksdb::Status(rocksdb::SstFileWriter*)>& add) {
+    rocksdb::Options options(get_db_options(), get_cf_options(cf_name));
+    rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), options, handle);
+    rocksdb::Status status = writer.Open(path);
+    if (status.ok()) {
+        status = add(&writer);
+    }
+    if (status.ok()) {
+        status = writer.Finish();
+    }
+    if (!status.ok()) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+    return status;
+}
+
+// Return true if every key in [lower, upper) has the "<varint ID>" prefix of
+// "lower" (see "TablePrefixTransform"). "auto_prefix_mode" can't tell it for
+// a table scan, its upper bound is the successor of the prefix, which is
+// another prefix.
+bool within_prefix(const std::string& lower, const std::string& upper) {
+    TablePrefixTransform transform;
+    if (upper.empty() || !transform.InDomain(lower)) {
+        return false;
+    }
+    auto prefix = transform.Transform(lower).ToString();
+    return upper <= prefix_successor(prefix);
+}
+
+}  // namespace
+
+std::string table_prefix(int64_t table_id) {
+    std::string prefix;
+    small::encode::put_varint64(&prefix, table_id);
+    return prefix;
+}
+
+std::string row_key(int64_t table_id, const small::type::Datum& pk) {
+    std::string key = table_prefix(table_id);
+    small::encode::encode_key(&key, pk);
+    return key;
+}
+
+std::string family_key(const std::string& row_key, int64_t family_id) {
+    std::string key = row_key;
+    if (family_id != 0) {
+        small::encode::put_varint64(&key, family_id);
+    }
+    return key;
+}
+
+std::vector<std::string> family_keys(const small::schema::Table& table,
+                                     const std::string& row_key) {
+    std::vector<std::string> keys;
+    keys.reserve(table.families.size() + 1);
+    keys.push_back(row_key);
+    for (const auto& family : table.families) {
+        keys.push_back(family_key(row_key, family.id));
+    }
+    return keys;
+}
+
+bool assemble_row(const small::schema::Table& table,
+                  const std::vector<rocksdb::PinnableSlice>& values,
+                  const std::vector<rocksdb::Status>& statuses, size_t offset,
+                  std::string* row) {
+    row->clear();
+    for (size_t i = offset; i <= offset + table.families.size(); i++) {
+        if (statuses[i].IsNotFound()) {
+            if (i == offset) {
+                return false;
+            }
+            continue;
+        }
+        if (!statuses[i].ok()) {
+            throw std::runtime_error("failed to read row: " +
+                                     statuses[i].ToString());
+        }
+        if (i == offset && values[i].empty()) {
+            return false;
+        }
+        row->append(values[i].data(), values[i].size());
+    }
+    return true;
+}
+
+std::string index_key(const small::schema::Table& table,
+                      const small::schema::Index& index,
+                      const std::vector<small::type::Datum>& values) {
+    std::string key = table_prefix(index.id);
+    for (int64_t column_id : index.column_ids) {
+        small::encode::encode_key(&key,
+                                  values[table.get_column_index(column_id)]);
+    }
+    small::encode::encode_key(&key, values[table.get_pk_index()]);
+    return key;
+}
+
+std::string index_value(const small::schema::Table& table,
+                        const small::schema::Index& index,
+                        const std::vector<small::type::Datum>& values,
+                        const std::vector<bool>& nulls) {
+    auto is_null = [&](int64_t column_id) {
+        return !nulls.empty() && nulls[table.get_column_index(column_id)];
+    };
+
+    std::vector<int64_t> column_ids;
+    std::vector<std::string> columns;
+    std::string null_column_ids;
+    for (int64_t column_id : index.column_ids) {
+        if (is_null(column_id)) {
+            small::encode::put_varint64(&null_column_ids, column_id);
+        }
+    }
+    if (!null_column_ids.empty()) {
+        column_ids.push_back(0);
+        columns.push_back(std::move(null_column_ids));
+    }
+    for (int64_t column_id : index.include_column_ids) {
+        if (is_null(column_id)) {
+            continue;
+        }
+        column_ids.push_back(column_id);
+        columns.push_back(small::encode::encode_value(
+            values[table.get_column_index(column_id)]));
+    }
+    return small::encode::encode_row(column_ids, columns);
+}
+
+std::string_view split_index_value(std::string_view value,
+                                   std::vector<int64_t>* null_column_ids) {
+    null_column_ids->clear();
+    std::string_view input = value;
+    uint64_t column_id;
+    uint64_t size;
+    if (!small::encode::get_varint64(&input, &column_id) || column_id != 0 ||
+        !small::encode::get_varint64(&input, &size) || size > input.size()) {
+        return value;
+    }
+
+    std::string_view ids = input.substr(0, size);
+    while (small::encode::get_varint64(&ids, &column_id)) {
+        null_column_ids->push_back(static_cast<int64_t>(column_id));
+    }
+    return input.substr(size);
+}
+
+std::string bitmap_key(int64_t index_id, const small::type::Datum& value,
+                       uint64_t high) {
+    std::string key = table_prefix(index_id);
+    small::encode::encode_key(&key, value);
+    for (int shift = 40; shift >= 0; shift -= 8) {
+        key.push_back(static_cast<char>((high >> shift) & 0xff));
+    }
+    return key;
+}
+
+std::string index_column_family(const small::schema::Index& index) {
+    return index.method == small::schema::Index::Method::Bitmap ? "BitmapCF"
+                                                                : "IndexCF";
+}
+
+std::vector<small::type::Datum> decode_row(const small::schema::Table& table,
+                                           std::string_view row) {
+    std::vector<small::type::Datum> values;
+    values.reserve(table.columns.size());
+    for (const auto& column : table.columns) {
+        if (column.type == small::type::Type::Int64) {
+            values.emplace_back(int64_t(0));
+        } else {
+            values.emplace_back(std::string());
+        }
+    }
+
+    small::encode::RowReader reader(row);
+    int64_t column_id;
+    std::string_view cell;
+    while (reader.Next(&column_id, &cell)) {
+        int index = table.get_column_index(column_id);
+        if (index != -1) {
+            values[index] =
+                small::encode::decode_value(cell, table.columns[index].type);
+        }
+    }
+    return values;
+}
+
+std::string prefix_successor(const std::string& prefix) {
+    std::string successor = prefix;
+    while (!successor.empty()) {
+        auto last = static_cast<uint8_t>(successor.back());
+        if (last != 0xff) {
+            successor.back() = static_cast<char>(last + 1);
+            return successor;
+        }
+        successor.pop_back();
+    }
+    return successor;
+}
+
 RocksDBWrapper::RocksDBWrapper(
     const std::string& db_path,
     const std::vector<std::string>& column_family_names) {
     bool _ = std::filesystem::create_directories(db_path);
 
-    rocksdb::Options options;
-    options.create_if_missing = true;
-    options.create_missing_column_families = true;
+    SPDLOG_INFO("open rocksdb, path: {}, storage config: {}", db_path,
+                get_storage_config().to_string());
+
+    rocksdb::Options options = get_db_options();
 
     std::vector<rocksdb::ColumnFamilyDescriptor> cf_descriptors;
     std::vector<rocksdb::ColumnFamilyHandle*> handles;
 
     // Always add the default column family
-    cf_descriptors.emplace_back(rocksdb::kDefaultColumnFamilyName,
-                                rocksdb::ColumnFamilyOptions());
+    cf_descriptors.emplace_back(
+        rocksdb::kDefaultColumnFamilyName,
+        get_cf_options(rocksdb::kDefaultColumnFamilyName));
 
     // Add user-defined column families
     for (const auto& name : column_family_names) {
-        cf_descriptors.emplace_back(name, rocksdb::ColumnFamilyOptions());
+        cf_descriptors.emplace_back(name, get_cf_options(name));
     }
 
     // Open database with column families
@@ -86,6 +476,37 @@ RocksDBWrapper::RocksDBWrapper(
     for (size_t i = 0; i < cf_descriptors.size(); ++i) {
         cf_handles_[cf_descriptors[i].name] = handles[i];
     }
+
+    LoadDeadPrefixes();
+}
+
+void RocksDBWrapper::LoadDeadPrefixes() {
+    auto handle = cf_handles_.find("TablesCF");
+    if (handle == cf_handles_.end()) {
+        return;
+    }
+
+    std::unique_ptr<rocksdb::Iterator> it(
+        db_->NewIterator(rocksdb::ReadOptions(), handle->second));
+    rocksdb::Slice tag(kDeadPrefixTag);
+    for (it->Seek(tag); it->Valid() && it->key().starts_with(tag);
+         it->Next()) {
+        std::string_view key(it->key().data() + tag.size(),
+                             it->key().size() - tag.size());
+        auto pos = key.rfind(':');
+        int64_t id;
+        if (pos == std::string_view::npos ||
+            std::from_chars(key.data() + pos + 1, key.data() + key.size(), id)
+                    .ec != std::errc()) {
+            SPDLOG_ERROR("corrupted dead prefix: {}", it->key().ToString());
+            continue;
+        }
+        get_dead_prefixes(std::string(key.substr(0, pos)))->Add(id);
+    }
+    if (!it->status().ok()) {
+        throw std::runtime_error("failed to load dead prefixes: " +
+                                 it->status().ToString());
+    }
 }
 
 RocksDBWrapper::~RocksDBWrapper() { Close(); }
@@ -132,26 +553,210 @@ bool RocksDBWrapper::Get(const std::string& cf_name, const std::string& key,
     return status.ok();
 }
 
-std::vector<std::pair<std::string, std::string>> RocksDBWrapper::GetAll(
-    const std::string& prefix) {
-    rocksdb::Options options;
-    rocksdb::BlockBasedTableOptions table_options;
-    table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10, false));
-    table_options.whole_key_filtering = false;
-    options.table_factory.reset(
-        rocksdb::NewBlockBasedTableFactory(table_options));
-    options.prefix_extractor.reset(
-        rocksdb::NewCappedPrefixTransform(prefix.size()));
+void RocksDBWrapper::Scan(const std::string& cf_name,
+                          const std::string& lower_bound,
+                          const std::string& upper_bound,
+                          const ScanVisitor& visitor,
+                          const ScanOptions& options) {
+    auto* handle = GetColumnFamilyHandle(cf_name);
+
+    // the bounds must outlive the iterator
+    rocksdb::Slice lower(lower_bound);
+    rocksdb::Slice upper(upper_bound);
 
     rocksdb::ReadOptions read_options;
-    read_options.prefix_same_as_start = true;
+    read_options.snapshot = options.snapshot.get();
+    read_options.iterate_lower_bound = &lower;
+    if (!upper_bound.empty()) {
+        read_options.iterate_upper_bound = &upper;
+    }
 
-    std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(read_options));
-    std::vector<std::pair<std::string, std::string>> kv_pairs;
-    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix);
-         it->Next()) {
-        kv_pairs.emplace_back(it->key().ToString(), it->value().ToString());
+    // seek with the prefix filters (e.g. a table or index scan), they skip
+    // SST files without any key of the prefix. Other ranges seek in total
+    // order, ignoring the filters.
+    if (within_prefix(lower_bound, upper_bound)) {
+        read_options.prefix_same_as_start = true;
+    } else {
+        read_options.total_order_seek = true;
+    }
+    if (options.large) {
+        read_options.fill_cache = false;
+        read_options.async_io = true;
+        read_options.adaptive_readahead = true;
+    }
+
+    std::unique_ptr<rocksdb::Iterator> it(
+        db_->NewIterator(read_options, handle));
+    for (it->Seek(lower); it->Valid(); it->Next()) {
+        if (!visitor(it->key(), it->value())) {
+            break;
+        }
+    }
+
+    if (!it->status().ok()) {
+        throw std::runtime_error("Error during iteration: " +
+                                 it->status().ToString());
+    }
+}
+
+void RocksDBWrapper::ScanPrefix(const std::string& prefix,
+                                const ScanVisitor& visitor,
+                                const ScanOptions& options) {
+    Scan(rocksdb::kDefaultColumnFamilyName, prefix, prefix_successor(prefix),
+         visitor, options);
+}
+
+void RocksDBWrapper::ScanRows(const small::schema::Table& table,
+                              const RowScanVisitor& visitor,
+                              const ScanOptions& options,
+                              const std::string& start) {
+    auto prefix = table_prefix(table.id);
+    auto lower_bound = start.empty() ? prefix : start;
+    auto upper_bound = prefix_successor(prefix);
+    if (table.families.empty()) {
+        Scan(
+            rocksdb::kDefaultColumnFamilyName, lower_bound, upper_bound,
+            [&](const rocksdb::Slice& key, const rocksdb::Slice& value) {
+                // a missing row
+                if (value.empty()) {
+                    return true;
+                }
+                return visitor(std::string_view(key.data(), key.size()),
+                               std::string_view(value.data(), value.size()));
+            },
+            options);
+        return;
     }
+
+    // families with any of the columns, by family ID
+    int64_t max_family_id = 0;
+    for (const auto& family : table.families) {
+        max_family_id = std::max(max_family_id, family.id);
+    }
+    std::vector<bool> needed(max_family_id + 1, options.columns.empty());
+    needed[0] = true;
+    for (int column : options.columns) {
+        auto family_id = table.get_family_id(table.columns[column].id);
+        if (family_id < needed.size()) {
+            needed[family_id] = true;
+        }
+    }
+
+    // the keys of a row are adjacent, the primary family first
+    auto pk_type = table.columns[table.get_pk_index()].type;
+    std::string row_key;
+    std::string row;
+    bool missing = true;
+    bool stopped = false;
+    auto flush = [&]() { return missing || visitor(row_key, row); };
+    Scan(
+        rocksdb::kDefaultColumnFamilyName, lower_bound, upper_bound,
+        [&](const rocksdb::Slice& key, const rocksdb::Slice& value) {
+            std::string_view input(key.data() + prefix.size(),
+                                   key.size() - prefix.size());
+            small::encode::decode_key(&input, pk_type);
+            std::string_view current(key.data(), key.size() - input.size());
+            if (current != row_key) {
+                if (!flush()) {
+                    stopped = true;
+                    return false;
+                }
+                row_key.assign(current);
+                row.clear();
+
+                // a row without its primary family is missing
+                missing = !input.empty() || value.empty();
+            }
+            uint64_t family_id = 0;
+            if (!input.empty()) {
+                small::encode::get_varint64(&input, &family_id);
+            }
+            if (!missing && family_id < needed.size() && needed[family_id]) {
+                row.append(value.data(), value.size());
+            }
+            return true;
+        },
+        options);
+    if (!stopped) {
+        flush();
+    }
+}
+
+Snapshot RocksDBWrapper::GetSnapshot() {
+    auto* db = db_;
+    return Snapshot(db->GetSnapshot(), [db](const rocksdb::Snapshot* snapshot) {
+        db->ReleaseSnapshot(snapshot);
+    });
+}
+
+uint64_t RocksDBWrapper::GetOldestSnapshotSequence() {
+    uint64_t sequence = 0;
+    if (!db_->GetIntProperty(rocksdb::DB::Properties::kOldestSnapshotSequence,
+                             &sequence)) {
+        SPDLOG_WARN("failed to get the oldest snapshot sequence");
+        return 0;
+    }
+
+    // 0 means there is no snapshot
+    return sequence == 0 ? db_->GetLatestSequenceNumber() : sequence;
+}
+
+void RocksDBWrapper::MultiGet(const std::string& cf_name,
+                              const std::vector<std::string>& keys,
+                              std::vector<rocksdb::PinnableSlice>* values,
+                              std::vector<rocksdb::Status>* statuses,
+                              bool sorted_input, const ScanOptions& options) {
+    std::vector<std::string> cf_names(keys.size(), cf_name);
+    MultiGet(cf_names, keys, values, statuses, sorted_input, options);
+}
+
+void RocksDBWrapper::MultiGet(const std::vector<std::string>& cf_names,
+                              const std::vector<std::string>& keys,
+                              std::vector<rocksdb::PinnableSlice>* values,
+                              std::vector<rocksdb::Status>* statuses,
+                              bool sorted_input, const ScanOptions& options) {
+    if (cf_names.size() != keys.size()) {
+        throw std::runtime_error("column families and keys mismatch");
+    }
+
+    std::vector<rocksdb::ColumnFamilyHandle*> handles;
+    std::vector<rocksdb::Slice> key_slices;
+    handles.reserve(keys.size());
+    key_slices.reserve(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        handles.push_back(GetColumnFamilyHandle(cf_names[i]));
+        key_slices.emplace_back(keys[i]);
+    }
+
+    values->clear();
+    values->resize(keys.size());
+    statuses->clear();
+    statuses->resize(keys.size());
+    if (keys.empty()) {
+        return;
+    }
+
+    // Read data blocks of the same SST file with a single batched (and
+    // asynchronous, when rocksdb is built with io_uring/coroutines) I/O
+    // instead of one read per key.
+    rocksdb::ReadOptions read_options;
+    read_options.snapshot = options.snapshot.get();
+    read_options.async_io = true;
+    read_options.optimize_multiget_for_io = true;
+
+    db_->MultiGet(read_options, keys.size(), handles.data(),
+                  key_slices.data(), values->data(), statuses->data(),
+                  sorted_input);
+}
+
+std::vector<std::pair<std::string, std::string>> RocksDBWrapper::GetAll(
+    const std::string& prefix) {
+    std::vector<std::pair<std::string, std::string>> kv_pairs;
+    ScanPrefix(prefix, [&](const rocksdb::Slice& key,
+                           const rocksdb::Slice& value) {
+        kv_pairs.emplace_back(key.ToString(), value.ToString());
+        return true;
+    });
     return kv_pairs;
 }
 
@@ -188,6 +793,112 @@ bool RocksDBWrapper::Delete(const std::string& cf_name,
     return status.ok();
 }
 
+bool RocksDBWrapper::GetRow(const small::schema::Table& table,
+                            const small::type::Datum& pk, std::string* row) {
+    std::vector<rocksdb::PinnableSlice> values;
+    std::vector<rocksdb::Status> statuses;
+    MultiGet(rocksdb::kDefaultColumnFamilyName,
+             family_keys(table, row_key(table.id, pk)), &values, &statuses);
+    if (assemble_row(table, values, statuses, 0, row)) {
+        return true;
+    }
+    return cold_row_reader_ && cold_row_reader_(table, pk, row);
+}
+
+void RocksDBWrapper::SetColdRowReader(ColdRowReader reader) {
+    cold_row_reader_ = std::move(reader);
+}
+
+absl::StatusOr<int64_t> RocksDBWrapper::DeleteIfUnchanged(
+    const small::schema::Table& table, const std::vector<std::string>& keys,
+    const Snapshot& snapshot) {
+    size_t num_families = table.families.size() + 1;
+    std::vector<std::string> all_keys;
+    all_keys.reserve(keys.size() * num_families);
+    for (const auto& key : keys) {
+        for (auto& family_key : family_keys(table, key)) {
+            all_keys.push_back(std::move(family_key));
+        }
+    }
+
+    // the values at the snapshot never change, read them before the lock
+    ScanOptions snapshot_options;
+    snapshot_options.snapshot = snapshot;
+    std::vector<rocksdb::PinnableSlice> old_values;
+    std::vector<rocksdb::Status> old_statuses;
+    MultiGet(rocksdb::kDefaultColumnFamilyName, all_keys, &old_values,
+             &old_statuses, /*sorted_input=*/false, snapshot_options);
+
+    std::unique_lock lock(write_mutex_);
+
+    std::vector<rocksdb::PinnableSlice> values;
+    std::vector<rocksdb::Status> statuses;
+    MultiGet(rocksdb::kDefaultColumnFamilyName, all_keys, &values, &statuses);
+
+    rocksdb::WriteBatch batch;
+    int64_t num_deleted = 0;
+    std::string old_row;
+    std::string row;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        size_t offset = i * num_families;
+        try {
+            if (!assemble_row(table, old_values, old_statuses, offset,
+                              &old_row) ||
+                !assemble_row(table, values, statuses, offset, &row)) {
+                continue;
+            }
+        } catch (const std::runtime_error& e) {
+            return absl::InternalError(e.what());
+        }
+        if (row != old_row) {
+            continue;
+        }
+        for (size_t j = offset; j < offset + num_families; j++) {
+            batch.Delete(all_keys[j]);
+        }
+        num_deleted++;
+    }
+
+    rocksdb::Status status = db_->Write(rocksdb::WriteOptions(), &batch);
+    if (!status.ok()) {
+        return absl::InternalError("failed to delete keys: " +
+                                   status.ToString());
+    }
+    return num_deleted;
+}
+
+std::unordered_set<std::string> RocksDBWrapper::GetRecentRowKeys(
+    const small::schema::Table& table) {
+    auto prefix = table_prefix(table.id);
+    auto upper_bound = prefix_successor(prefix);
+    rocksdb::Slice upper(upper_bound);
+
+    // only the memtables, no SST file is read
+    rocksdb::ReadOptions read_options;
+    read_options.read_tier = rocksdb::kMemtableTier;
+    read_options.iterate_upper_bound = &upper;
+    read_options.prefix_same_as_start = true;
+
+    auto pk_type = table.columns[table.get_pk_index()].type;
+    std::unordered_set<std::string> keys;
+    std::unique_ptr<rocksdb::Iterator> it(db_->NewIterator(
+        read_options,
+        GetColumnFamilyHandle(rocksdb::kDefaultColumnFamilyName)));
+    for (it->Seek(prefix); it->Valid(); it->Next()) {
+        // the row key without the family suffix
+        auto key = it->key();
+        std::string_view input(key.data() + prefix.size(),
+                               key.size() - prefix.size());
+        small::encode::decode_key(&input, pk_type);
+        keys.emplace(key.data(), key.size() - input.size());
+    }
+    if (!it->status().ok()) {
+        throw std::runtime_error("Error during iteration: " +
+                                 it->status().ToString());
+    }
+    return keys;
+}
+
 void RocksDBWrapper::PrintAllKV() {
     for (const auto& cf : cf_handles_) {
         std::cout << "Column Family: " << cf.first << std::endl;
@@ -205,36 +916,592 @@ void RocksDBWrapper::PrintAllKV() {
 void RocksDBWrapper::WriteRow(
     const std::shared_ptr<small::schema::Table>& table,
     const std::vector<small::type::Datum>& values) {
-    int pk_index = -1;
-    for (int i = 0; i < table->columns.size(); ++i) {
-        if (table->columns[i].is_primary_key) {
-            pk_index = i;
-            break;
+    WriteRows(table, {values});
+}
+
+void RocksDBWrapper::WriteRowWire(
+    const std::shared_ptr<small::schema::Table>& table,
+    const std::vector<std::string>& values) {
+    WriteRows(table, {decode_wire(*table, values)});
+}
+
+bool RocksDBWrapper::WriteRows(
+    const std::shared_ptr<small::schema::Table>& table,
+    const std::vector<std::vector<small::type::Datum>>& rows) {
+    int pk_index = table->get_pk_index();
+    if (pk_index == -1) {
+        throw std::runtime_error("primary key not found: " + table->name);
+    }
+
+    auto is_last = find_last_rows(*table, rows);
+
+    RowLock lock;
+    if (!table->indexes.empty()) {
+        std::vector<small::type::Datum> pks;
+        pks.reserve(rows.size());
+        for (const auto& row : rows) {
+            pks.push_back(row[pk_index]);
+        }
+        lock = LockRows(*table, pks);
+    }
+    rocksdb::WriteBatch batch;
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (is_last[i]) {
+            PutRow(&batch, table, rows[i]);
+        }
+    }
+    return Write(&batch);
+}
+
+bool RocksDBWrapper::IncrementRow(const small::schema::Table& table,
+                                  const small::type::Datum& pk,
+                                  const std::vector<int64_t>& column_ids,
+                                  const std::vector<int64_t>& deltas) {
+    auto key = row_key(table.id, pk);
+    auto operand = increment_operand(column_ids, deltas);
+
+    // family ID -> columns and deltas of the family
+    std::map<int64_t, std::pair<std::vector<int64_t>, std::vector<int64_t>>>
+        families;
+    for (size_t i = 0; i < column_ids.size(); i++) {
+        auto& [family_column_ids, family_deltas] =
+            families[table.get_family_id(column_ids[i])];
+        family_column_ids.push_back(column_ids[i]);
+        family_deltas.push_back(deltas[i]);
+    }
+
+    rocksdb::WriteBatch batch;
+    rocksdb::Status status;
+    {
+        // held from the lookups until the write, so only one increment writes
+        // a cold row back
+        auto row_lock = LockRows(table, {pk});
+
+        // shared like "Write": "DeleteIfUnchanged" removes rows from rocksdb
+        // only after their segment is current, so a row is either still in
+        // rocksdb or found by the cold row reader
+        std::shared_lock lock(write_mutex_);
+        std::string cold_row;
+        if (cold_row_reader_ && cold_row_reader_(table, pk, &cold_row)) {
+            std::string row;
+            status = db_->Get(rocksdb::ReadOptions(), key, &row);
+            if (!status.ok() && !status.IsNotFound()) {
+                SPDLOG_ERROR("failed to read row: {}", status.ToString());
+                return false;
+            }
+            if (status.IsNotFound() || row.empty()) {
+                std::string new_row;
+                if (!apply_increment(cold_row, operand, &new_row)) {
+                    SPDLOG_ERROR("corrupted row of table {}", table.name);
+                    return false;
+                }
+                auto values = decode_row(table, new_row);
+                for (const auto& [family_key, value] :
+                     pack_families(table, values)) {
+                    status = batch.Put(family_key, value);
+                    if (!status.ok()) {
+                        break;
+                    }
+                }
+            }
         }
+        if (batch.Count() == 0) {
+            for (const auto& [family_id, family] : families) {
+                status = batch.Merge(
+                    family_key(key, family_id),
+                    increment_operand(family.first, family.second));
+                if (!status.ok()) {
+                    break;
+                }
+            }
+        }
+        if (status.ok()) {
+            status = db_->Write(rocksdb::WriteOptions(), &batch);
+        }
+    }
+    if (!status.ok()) {
+        SPDLOG_ERROR("failed to increment row: {}", status.ToString());
+        return false;
     }
 
-    for (int i = 0; i < table->columns.size(); ++i) {
-        auto key = absl::StrFormat("/%s/%s/column_%d", table->name,
-                                   small::encode::encode(values[pk_index]), i);
-        this->Put(key, small::encode::encode(values[i]));
+    BumpTableVersions(batch);
+    return true;
+}
+
+void RocksDBWrapper::Put(rocksdb::WriteBatch* batch, const std::string& cf_name,
+                         const std::string& key, const std::string& value) {
+    auto* handle = GetColumnFamilyHandle(cf_name);
+    rocksdb::Status status = batch->Put(handle, key, value);
+    if (!status.ok()) {
+        throw std::runtime_error("Failed to add to batch: " +
+                                 status.ToString());
     }
 }
 
-void RocksDBWrapper::WriteRowWire(
+void RocksDBWrapper::Merge(rocksdb::WriteBatch* batch,
+                           const std::string& cf_name, const std::string& key,
+                           const std::string& value) {
+    auto* handle = GetColumnFamilyHandle(cf_name);
+    rocksdb::Status status = batch->Merge(handle, key, value);
+    if (!status.ok()) {
+        throw std::runtime_error("Failed to add to batch: " +
+                                 status.ToString());
+    }
+}
+
+RowLock RocksDBWrapper::LockRows(const small::schema::Table& table,
+                                 const std::vector<small::type::Datum>& pks) {
+    std::vector<size_t> stripes;
+    stripes.reserve(pks.size());
+    for (const auto& pk : pks) {
+        stripes.push_back(std::hash<std::string>{}(row_key(table.id, pk)) %
+                          kRowLockStripes);
+    }
+    std::sort(stripes.begin(), stripes.end());
+    stripes.erase(std::unique(stripes.begin(), stripes.end()), stripes.end());
+
+    RowLock lock;
+    lock.reserve(stripes.size());
+    for (size_t stripe : stripes) {
+        lock.emplace_back(row_mutexes_[stripe]);
+    }
+    return lock;
+}
+
+void RocksDBWrapper::PutRow(rocksdb::WriteBatch* batch,
+                            const std::shared_ptr<small::schema::Table>& table,
+                            const std::vector<small::type::Datum>& values) {
+    int pk_index = table->get_pk_index();
+    if (pk_index == -1) {
+        throw std::runtime_error("primary key not found: " + table->name);
+    }
+
+    if (!table->indexes.empty()) {
+        PutIndexEntries(batch, *table, values);
+    }
+
+    for (const auto& [key, value] : pack_families(*table, values)) {
+        Put(batch, rocksdb::kDefaultColumnFamilyName, key, value);
+    }
+}
+
+void RocksDBWrapper::PutIndexEntries(
+    rocksdb::WriteBatch* batch, const small::schema::Table& table,
+    const std::vector<small::type::Datum>& values) {
+    // entries of the previous version of the row are stale if their key
+    // columns change
+    std::vector<small::type::Datum> old_values;
+    std::string old_row;
+    if (GetRow(table, values[table.get_pk_index()], &old_row)) {
+        old_values = decode_row(table, old_row);
+    }
+
+    auto* handle = GetColumnFamilyHandle("IndexCF");
+    for (const auto& index : table.indexes) {
+        if (index.method == small::schema::Index::Method::Bitmap) {
+            // merge operands, so the containers are never read here. The
+            // old value comes from the version of the row read under its
+            // lock, so the remove operand is never for a value another
+            // writer already replaced.
+            const auto& pk = values[table.get_pk_index()];
+            uint64_t row_id = small::bitmap::to_row_id(std::get<int64_t>(pk));
+            uint64_t high = row_id >> 16;
+            uint16_t low = row_id & 0xffff;
+            int column_index = table.get_column_index(index.column_ids[0]);
+            const auto& value = values[column_index];
+            if (!old_values.empty()) {
+                const auto& old_value = old_values[column_index];
+                if (old_value == value) {
+                    continue;
+                }
+                Merge(batch, "BitmapCF", bitmap_key(index.id, old_value, high),
+                      small::bitmap::remove_operand(low));
+            }
+            Merge(batch, "BitmapCF", bitmap_key(index.id, value, high),
+                  small::bitmap::add_operand(low));
+            continue;
+        }
+
+        auto key = index_key(table, index, values);
+        if (!old_values.empty()) {
+            auto old_key = index_key(table, index, old_values);
+            if (old_key != key) {
+                rocksdb::Status status = batch->Delete(handle, old_key);
+                if (!status.ok()) {
+                    throw std::runtime_error("Failed to add to batch: " +
+                                             status.ToString());
+                }
+            }
+        }
+        Put(batch, "IndexCF", key, index_value(table, index, values));
+    }
+}
+
+void RocksDBWrapper::PutRowWire(
+    rocksdb::WriteBatch* batch,
     const std::shared_ptr<small::schema::Table>& table,
     const std::vector<std::string>& values) {
-    int pk_index = -1;
-    for (int i = 0; i < table->columns.size(); ++i) {
-        if (table->columns[i].is_primary_key) {
-            pk_index = i;
-            break;
+    PutRow(batch, table, decode_wire(*table, values));
+}
+
+bool RocksDBWrapper::Write(rocksdb::WriteBatch* batch) {
+    std::shared_lock lock(write_mutex_);
+    rocksdb::Status status = db_->Write(rocksdb::WriteOptions(), batch);
+    if (!status.ok()) {
+        SPDLOG_ERROR("failed to write batch: {}", status.ToString());
+        return false;
+    }
+
+    // bump after the commit, otherwise a scan may read the new version before
+    // the rows are visible and cache stale rows under it
+    BumpTableVersions(*batch);
+    return true;
+}
+
+void RocksDBWrapper::Delete(rocksdb::WriteBatch* batch,
+                            const std::string& cf_name,
+                            const std::string& key) {
+    auto* handle = GetColumnFamilyHandle(cf_name);
+    rocksdb::Status status = batch->Delete(handle, key);
+    if (!status.ok()) {
+        throw std::runtime_error("Failed to add to batch: " +
+                                 status.ToString());
+    }
+}
+
+void RocksDBWrapper::DeleteRange(rocksdb::WriteBatch* batch,
+                                 const std::string& cf_name,
+                                 const std::string& begin,
+                                 const std::string& end) {
+    auto* handle = GetColumnFamilyHandle(cf_name);
+    rocksdb::Status status = batch->DeleteRange(handle, begin, end);
+    if (!status.ok()) {
+        throw std::runtime_error("Failed to add to batch: " +
+                                 status.ToString());
+    }
+}
+
+bool RocksDBWrapper::DeletePrefix(const std::string& cf_name, int64_t id) {
+    auto begin = table_prefix(id);
+    auto end = prefix_successor(begin);
+
+    // committed by "Write", so the versions of deleted tables are bumped
+    rocksdb::WriteBatch batch;
+    DeleteRange(&batch, cf_name, begin, end);
+    if (!Write(&batch)) {
+        return false;
+    }
+
+    // files deleted at once are gone for older snapshots too (e.g. a SELECT
+    // which took its snapshot before the delete), leave them to compactions
+    // while any snapshot may still read the range
+    uint64_t sequence = GetLatestSequenceNumber();
+    if (GetOldestSnapshotSequence() < sequence) {
+        SPDLOG_INFO("keep files in range for older snapshots, id: {}", id);
+        return true;
+    }
+
+    // drop whole files at once, the range tombstone covers the keys of the
+    // files partially in the range
+    rocksdb::Slice begin_slice(begin);
+    rocksdb::Slice end_slice(end);
+    rocksdb::Status status = rocksdb::DeleteFilesInRange(
+        db_, GetColumnFamilyHandle(cf_name), &begin_slice, &end_slice);
+    if (!status.ok()) {
+        // only the space is reclaimed later
+        SPDLOG_WARN("failed to delete files in range, id: {}, error: {}", id,
+                    status.ToString());
+    }
+    return true;
+}
+
+bool RocksDBWrapper::MarkPrefixDead(const std::string& cf_name, int64_t id) {
+    if (!Put("TablesCF", dead_prefix_key(cf_name, id), "")) {
+        return false;
+    }
+    get_dead_prefixes(cf_name)->Add(id);
+    return true;
+}
+
+uint64_t RocksDBWrapper::GetLatestSequenceNumber() {
+    return db_->GetLatestSequenceNumber();
+}
+
+uint64_t RocksDBWrapper::GetApproximateTableSize(int64_t table_id) {
+    auto prefix = table_prefix(table_id);
+    auto end = prefix_successor(prefix);
+    rocksdb::Range range(prefix, end);
+
+    rocksdb::SizeApproximationOptions size_options;
+    size_options.include_memtables = true;
+    size_options.include_files = true;
+    uint64_t size = 0;
+    auto status = db_->GetApproximateSizes(
+        size_options, GetColumnFamilyHandle(rocksdb::kDefaultColumnFamilyName),
+        &range, 1, &size);
+    if (!status.ok()) {
+        SPDLOG_ERROR("get approximate size failed, table id: {}, error: {}",
+                     table_id, status.ToString());
+        return 0;
+    }
+    return size;
+}
+
+std::vector<std::pair<std::string, std::string>>
+RocksDBWrapper::GetStorageReport() {
+    std::vector<std::pair<std::string, std::string>> report;
+
+    std::map<std::string, rocksdb::ColumnFamilyHandle*> handles(
+        cf_handles_.begin(), cf_handles_.end());
+    for (const auto& [name, handle] : handles) {
+        uint64_t sst_bytes = 0;
+        db_->GetIntProperty(handle, rocksdb::DB::Properties::kLiveSstFilesSize,
+                            &sst_bytes);
+
+        // the table properties are read from the table cache, or the footer
+        // of the files not opened yet
+        uint64_t raw_bytes = 0;
+        uint64_t data_bytes = 0;
+        rocksdb::TablePropertiesCollection tables;
+        auto status = db_->GetPropertiesOfAllTables(handle, &tables);
+        if (!status.ok()) {
+            SPDLOG_ERROR("get table properties failed, cf: {}, error: {}",
+                         name, status.ToString());
+        }
+        for (const auto& [_, properties] : tables) {
+            raw_bytes += properties->raw_key_size + properties->raw_value_size;
+            data_bytes += properties->data_size;
+        }
+
+        report.emplace_back(name + ".sst_bytes", std::to_string(sst_bytes));
+        report.emplace_back(name + ".raw_bytes", std::to_string(raw_bytes));
+        report.emplace_back(
+            name + ".compression_ratio",
+            data_bytes == 0 ? "" : absl::StrFormat("%.2f", 1.0 * raw_bytes /
+                                                               data_bytes));
+    }
+
+    auto statistics = db_->GetDBOptions().statistics;
+    if (statistics != nullptr) {
+        rocksdb::HistogramData nanos;
+        statistics->histogramData(rocksdb::DECOMPRESSION_TIMES_NANOS, &nanos);
+        auto blocks =
+            statistics->getTickerCount(rocksdb::NUMBER_BLOCK_DECOMPRESSED);
+        report.emplace_back("blocks_decompressed", std::to_string(blocks));
+        report.emplace_back("decompress_nanos_avg",
+                            absl::StrFormat("%.0f", nanos.average));
+        report.emplace_back("decompress_nanos_p99",
+                            absl::StrFormat("%.0f", nanos.percentile99));
+
+        // seeks checked against the prefix filter of an SST file, and the
+        // ones that skipped the file
+        report.emplace_back(
+            "bloom_prefix_checked",
+            std::to_string(statistics->getTickerCount(
+                rocksdb::BLOOM_FILTER_PREFIX_CHECKED)));
+        report.emplace_back(
+            "bloom_prefix_useful",
+            std::to_string(statistics->getTickerCount(
+                rocksdb::BLOOM_FILTER_PREFIX_USEFUL)));
+    }
+    return report;
+}
+
+bool RocksDBWrapper::IngestRows(
+    const std::shared_ptr<small::schema::Table>& table,
+    const std::vector<std::vector<small::type::Datum>>& rows) {
+    int pk_index = table->get_pk_index();
+    if (pk_index == -1) {
+        SPDLOG_ERROR("primary key not found: {}", table->name);
+        return false;
+    }
+    if (rows.empty()) {
+        return true;
+    }
+
+    auto is_last = find_last_rows(*table, rows);
+
+    std::vector<std::pair<std::string, std::string>> kv_pairs;
+    kv_pairs.reserve(rows.size() * (table->families.size() + 1));
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (!is_last[i]) {
+            continue;
+        }
+        for (auto& kv_pair : pack_families(*table, rows[i])) {
+            kv_pairs.push_back(std::move(kv_pair));
         }
     }
 
-    for (int i = 0; i < table->columns.size(); ++i) {
-        auto key = absl::StrFormat("/%s/%s/column_%d", table->name,
-                                   values[pk_index], i);
-        this->Put(key, values[i]);
+    // an SST file needs strictly increasing keys
+    std::sort(kv_pairs.begin(), kv_pairs.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    // The index entries of the rows are ingested together with them, so
+    // readers see both or neither. They are collected by "PutRow" like
+    // for a write batch, under the locks of the rows until the files are
+    // ingested.
+    RowLock lock;
+    SstEntryCollector collector;
+    if (!table->indexes.empty()) {
+        std::vector<small::type::Datum> pks;
+        pks.reserve(rows.size());
+        for (const auto& row : rows) {
+            pks.push_back(row[pk_index]);
+        }
+        lock = LockRows(*table, pks);
+
+        rocksdb::WriteBatch batch;
+        for (size_t i = 0; i < rows.size(); i++) {
+            if (is_last[i]) {
+                PutIndexEntries(&batch, *table, rows[i]);
+            }
+        }
+        rocksdb::Status status = batch.Iterate(&collector);
+        if (!status.ok()) {
+            SPDLOG_ERROR("failed to collect index entries: {}",
+                         status.ToString());
+            return false;
+        }
+    }
+
+    std::string dir = db_->GetName() + "/ingest";
+    std::filesystem::create_directories(dir);
+    auto next_path = [&]() {
+        return absl::StrFormat("%s/%d-%d.sst", dir, table->id,
+                               ingest_sequence_++);
+    };
+
+    std::vector<rocksdb::IngestExternalFileArg> args;
+    auto remove_files = [&]() {
+        for (const auto& arg : args) {
+            std::error_code ec;
+            std::filesystem::remove(arg.external_files[0], ec);
+        }
+    };
+
+    rocksdb::IngestExternalFileArg arg;
+    arg.column_family =
+        GetColumnFamilyHandle(rocksdb::kDefaultColumnFamilyName);
+    arg.external_files = {next_path()};
+    arg.options.move_files = true;
+    rocksdb::Status status = write_sst_file(
+        arg.external_files[0], rocksdb::kDefaultColumnFamilyName,
+        arg.column_family, [&](rocksdb::SstFileWriter* writer) {
+            rocksdb::Status put_status;
+            for (const auto& [key, value] : kv_pairs) {
+                put_status = writer->Put(key, value);
+                if (!put_status.ok()) {
+                    break;
+                }
+            }
+            return put_status;
+        });
+    if (status.ok()) {
+        args.push_back(arg);
+    }
+
+    for (const auto& [cf_name, handle] : cf_handles_) {
+        auto it = collector.entries.find(handle->GetID());
+        if (!status.ok() || it == collector.entries.end()) {
+            continue;
+        }
+        arg.column_family = handle;
+        arg.external_files = {next_path()};
+        status = write_sst_file(
+            arg.external_files[0], cf_name, handle,
+            [&](rocksdb::SstFileWriter* writer) {
+                rocksdb::Status add_status;
+                for (const auto& [key, entry] : it->second) {
+                    switch (entry.op) {
+                        case SstEntry::Op::kPut:
+                            add_status = writer->Put(key, entry.value);
+                            break;
+                        case SstEntry::Op::kDelete:
+                            add_status = writer->Delete(key);
+                            break;
+                        case SstEntry::Op::kMerge:
+                            add_status = writer->Merge(key, entry.value);
+                            break;
+                    }
+                    if (!add_status.ok()) {
+                        break;
+                    }
+                }
+                return add_status;
+            });
+        if (status.ok()) {
+            args.push_back(arg);
+        }
+    }
+    if (!status.ok()) {
+        SPDLOG_ERROR("failed to write sst files of table {}: {}", table->name,
+                     status.ToString());
+        remove_files();
+        return false;
+    }
+
+    {
+        // shared like "Write", so "DeleteIfUnchanged" never misses the rows
+        std::shared_lock write_lock(write_mutex_);
+
+        // the files of all column families are ingested atomically
+        status = db_->IngestExternalFiles(args);
+    }
+
+    // the files are linked into the database, drop the names in "dir"
+    remove_files();
+    if (!status.ok()) {
+        SPDLOG_ERROR("failed to ingest sst files of table {}: {}",
+                     table->name, status.ToString());
+        return false;
+    }
+
+    {
+        std::lock_guard version_lock(version_mutex_);
+        table_versions_[table->id]++;
+    }
+    return true;
+}
+
+bool RocksDBWrapper::CompactTable(int64_t table_id) {
+    auto begin = table_prefix(table_id);
+    auto end = prefix_successor(begin);
+    rocksdb::Slice begin_slice(begin);
+    rocksdb::Slice end_slice(end);
+
+    rocksdb::CompactRangeOptions options;
+    options.exclusive_manual_compaction = false;
+    rocksdb::Status status = db_->CompactRange(
+        options, GetColumnFamilyHandle(rocksdb::kDefaultColumnFamilyName),
+        &begin_slice, end.empty() ? nullptr : &end_slice);
+    if (!status.ok()) {
+        SPDLOG_ERROR("failed to compact table {}: {}", table_id,
+                     status.ToString());
+        return false;
+    }
+    return true;
+}
+
+uint64_t RocksDBWrapper::GetTableVersion(int64_t table_id) {
+    std::lock_guard lock(version_mutex_);
+    auto it = table_versions_.find(table_id);
+    return versions_epoch_ +
+           (it == table_versions_.end() ? 0 : it->second);
+}
+
+void RocksDBWrapper::BumpTableVersions(const rocksdb::WriteBatch& batch) {
+    TableCollector collector;
+    rocksdb::Status status = batch.Iterate(&collector);
+
+    std::lock_guard lock(version_mutex_);
+    if (!status.ok()) {
+        // can't tell the tables of the batch, bump all of them
+        SPDLOG_WARN("failed to iterate batch: {}", status.ToString());
+        versions_epoch_++;
+        return;
+    }
+    for (int64_t table_id : collector.table_ids) {
+        table_versions_[table_id]++;
     }
 }
 
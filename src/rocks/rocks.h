@@ -18,10 +18,18 @@
 // c++ std
 // =====================================================================
 
+#include <array>
+#include <atomic>
+#include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 // =====================================================================
@@ -30,6 +38,10 @@
 
 #include "rocksdb/db.h"
 #include "rocksdb/options.h"
+#include "rocksdb/write_batch.h"
+
+// absl
+#include "absl/status/statusor.h"
 
 // =====================================================================
 // local libraries
@@ -41,6 +53,142 @@
 
 namespace small::rocks {
 
+// The key of a row is:
+//
+//   <varint table ID><pk>
+//
+// The primary key is encoded by "small::encode::encode_key", so rows of a table
+// are stored together and sorted by their primary key. A varint is
+// self-delimiting, so the prefix of a table never matches rows of another
+// table.
+std::string table_prefix(int64_t table_id);
+
+std::string row_key(int64_t table_id, const small::type::Datum& pk);
+
+// A table with column families (see "small::schema::Family") stores each
+// family of a row as a separate value:
+//
+//   <row key><varint family ID>
+//
+// The primary family has no suffix, so it's the key of the row. The encoded
+// primary key is self-delimiting, so the keys of a row are stored together,
+// the primary family first.
+std::string family_key(const std::string& row_key, int64_t family_id);
+
+// Return the keys of all families of a row, the primary family first.
+std::vector<std::string> family_keys(const small::schema::Table& table,
+                                     const std::string& row_key);
+
+// Assemble the packed row from the values of the family keys of a row (see
+// "family_keys") looked up by "MultiGet", starting at "offset". The columns
+// of a packed row are tagged by ID, so the values are just concatenated.
+//
+// Return false if the row is missing, i.e. the primary family is missing or
+// empty (see "RocksDBWrapper::GetRow"). Throw "std::runtime_error" if a
+// lookup failed.
+bool assemble_row(const small::schema::Table& table,
+                  const std::vector<rocksdb::PinnableSlice>& values,
+                  const std::vector<rocksdb::Status>& statuses, size_t offset,
+                  std::string* row);
+
+// The key of an index entry is:
+//
+//   <varint index ID><key columns><pk>
+//
+// Every column is encoded by "small::encode::encode_key", so entries are sorted
+// by the key columns and the primary key makes them unique. "values" are all
+// columns of a row in the order of the table.
+std::string index_key(const small::schema::Table& table,
+                      const small::schema::Index& index,
+                      const std::vector<small::type::Datum>& values);
+
+// The value of an index entry packs the included columns. "nulls" marks the
+// NULL columns of the row (in the order of the table, empty if there is
+// none): a NULL included column is left out like in a packed row, a NULL key
+// column is encoded as the default value of its type in the key, so the IDs
+// of such columns are listed in the reserved column ID 0 of the value.
+std::string index_value(const small::schema::Table& table,
+                        const small::schema::Index& index,
+                        const std::vector<small::type::Datum>& values,
+                        const std::vector<bool>& nulls = {});
+
+// Split the value of an index entry into the IDs of its NULL key columns and
+// the packed included columns, which are returned.
+std::string_view split_index_value(std::string_view value,
+                                   std::vector<int64_t>* null_column_ids);
+
+// The key of a bitmap index container is:
+//
+//   <varint index ID><value><row ID high 48 bits>
+//
+// The value is encoded by "small::encode::encode_key" and the high bits are
+// big-endian, so containers of a value are stored together in row ID order.
+// Row IDs are int64 primary keys mapped by "small::bitmap::to_row_id".
+std::string bitmap_key(int64_t index_id, const small::type::Datum& value,
+                       uint64_t high);
+
+// Return the column family of the entries of an index, "IndexCF" or
+// "BitmapCF".
+std::string index_column_family(const small::schema::Index& index);
+
+// Decode a packed row into values in the order of the table, a column missing
+// in the row gets the default value of its type.
+std::vector<small::type::Datum> decode_row(const small::schema::Table& table,
+                                           std::string_view row);
+
+// Return the smallest key which is greater than all keys starting with
+// "prefix", or an empty string if there is no such key (e.g. "prefix" is all
+// "\xff").
+std::string prefix_successor(const std::string& prefix);
+
+// Called for each key-value pair of a scan. The slices point into rocksdb's
+// internal buffers and are only valid during the call. Return false to stop
+// the scan.
+using ScanVisitor = std::function<bool(const rocksdb::Slice& key,
+                                       const rocksdb::Slice& value)>;
+
+// Called for each row of "ScanRows" with its key (see "row_key") and the
+// packed row. Return false to stop the scan.
+using RowScanVisitor =
+    std::function<bool(std::string_view key, std::string_view row)>;
+
+// A consistent point-in-time view of the database, released when the last
+// reference is gone.
+using Snapshot = std::shared_ptr<const rocksdb::Snapshot>;
+
+// Read a row moved out of rocksdb (see "small::columnar::SegmentStore") by its
+// primary key, return false if not found.
+using ColdRowReader =
+    std::function<bool(const small::schema::Table& table,
+                       const small::type::Datum& pk, std::string* row)>;
+
+// Rows are locked by one of "kRowLockStripes" mutexes picked by the hash of
+// their key, rows sharing a mutex just wait for each other.
+constexpr size_t kRowLockStripes = 1024;
+
+// The locks of some rows, see "RocksDBWrapper::LockRows". They are released
+// when it's destroyed.
+using RowLock = std::vector<std::unique_lock<std::mutex>>;
+
+// Options of a scan, also used by the batched lookups of a statement.
+class ScanOptions {
+   public:
+    // Read from the snapshot, nullptr means the latest state.
+    Snapshot snapshot;
+
+    // A scan reading much more than the block cache holds (e.g. a full scan
+    // of a large table): prefetch the next blocks asynchronously while the
+    // current ones are decoded, with a readahead growing as the scan goes
+    // on, and keep the blocks read once out of the block cache so they don't
+    // evict the hot blocks of point lookups. Only used by scans.
+    bool large = false;
+
+    // Indexes of the columns read by the statement, empty means all. Scans of
+    // rows skip the families without any of them (the primary family is
+    // always read) and decode only these columns.
+    std::vector<int> columns;
+};
+
 class RocksDBWrapper {
    private:
     // singleton instance
@@ -77,6 +225,76 @@ class RocksDBWrapper {
     bool Get(const std::string& cf_name, const std::string& key,
              std::string& value);
 
+    // Visit key-value pairs in [lower_bound, upper_bound) of a column family
+    // in key order, without copying them. An empty "upper_bound" means no
+    // upper bound.
+    //
+    // Throw "std::runtime_error" if the iterator fails.
+    void Scan(const std::string& cf_name, const std::string& lower_bound,
+              const std::string& upper_bound, const ScanVisitor& visitor,
+              const ScanOptions& options = {});
+
+    // Visit key-value pairs starting with "prefix" in the default column
+    // family.
+    void ScanPrefix(const std::string& prefix, const ScanVisitor& visitor,
+                    const ScanOptions& options = {});
+
+    // Visit the rows of a table in primary key order, the families of a row
+    // are assembled into a single packed row and missing rows (see "GetRow")
+    // are skipped. Families not needed by "options.columns" are left out of
+    // the row without being copied.
+    //
+    // The scan starts from the key "start" if it's not empty, e.g. the
+    // "prefix_successor" of the last row key visited to resume a scan.
+    //
+    // Throw "std::runtime_error" if the iterator fails.
+    void ScanRows(const small::schema::Table& table,
+                  const RowScanVisitor& visitor,
+                  const ScanOptions& options = {},
+                  const std::string& start = "");
+
+    // A snapshot pins the versions of the keys it can see, compactions drop
+    // older versions (and deleted keys) no live snapshot can see. Taking one
+    // never blocks writers.
+    Snapshot GetSnapshot();
+
+    // Return the sequence number of the oldest live snapshot, the latest
+    // sequence number if there is no snapshot, or 0 if it's unknown.
+    uint64_t GetOldestSnapshotSequence();
+
+    // Read the packed row of the primary key, from rocksdb or from the cold
+    // row reader. Return false if not found.
+    //
+    // An empty value in rocksdb (left by increments of a missing row, see
+    // "RowMergeOperator") is a missing row, all readers must skip it.
+    bool GetRow(const small::schema::Table& table,
+                const small::type::Datum& pk, std::string* row);
+
+    // Set the reader of rows moved out of rocksdb, must be called before any
+    // write.
+    void SetColdRowReader(ColdRowReader reader);
+
+    // Look up many keys of a column family in a single batched call, which
+    // shares the block cache lookups and overlaps the I/O of keys in the same
+    // SST file. "values" and "statuses" are resized to the number of keys and
+    // keep their order, a missing key has a "NotFound" status.
+    //
+    // Set "sorted_input" if the keys are already sorted (e.g. primary keys
+    // from an index scan) to skip the sorting inside rocksdb.
+    void MultiGet(const std::string& cf_name,
+                  const std::vector<std::string>& keys,
+                  std::vector<rocksdb::PinnableSlice>* values,
+                  std::vector<rocksdb::Status>* statuses,
+                  bool sorted_input = false, const ScanOptions& options = {});
+
+    // Look up keys across column families, "cf_names[i]" is the column family
+    // of "keys[i]".
+    void MultiGet(const std::vector<std::string>& cf_names,
+                  const std::vector<std::string>& keys,
+                  std::vector<rocksdb::PinnableSlice>* values,
+                  std::vector<rocksdb::Status>* statuses,
+                  bool sorted_input = false, const ScanOptions& options = {});
+
     std::vector<std::pair<std::string, std::string>> GetAll(
         const std::string& prefix);
     std::vector<std::pair<std::string, std::string>> GetAllKV(
@@ -84,18 +302,197 @@ class RocksDBWrapper {
 
     bool Delete(const std::string& cf_name, const std::string& key);
 
+    // Delete the rows of the table, given by their keys (see "ScanRows"),
+    // whose current value is still the one at the snapshot, e.g. rows moved
+    // into a segment built from it. Rows written again since the snapshot are
+    // kept with all their families. Writes through "Write" are blocked during
+    // the check, so a concurrent write is never lost.
+    //
+    // Return the number of deleted rows.
+    absl::StatusOr<int64_t> DeleteIfUnchanged(
+        const small::schema::Table& table, const std::vector<std::string>& keys,
+        const Snapshot& snapshot);
+
+    // Return the keys of the rows of the table with a family written since
+    // the last flush, i.e. still in a memtable.
+    //
+    // Throw "std::runtime_error" if the iterator fails.
+    std::unordered_set<std::string> GetRecentRowKeys(
+        const small::schema::Table& table);
+
     void PrintAllKV();
 
+    // Write a row as a single key-value pair (one per family, see
+    // "family_key"), the key is built by "row_key" and the value packs all
+    // columns of the row.
+    //
+    // See "small::encode::encode_row" for the format of the value.
     void WriteRow(const std::shared_ptr<small::schema::Table>& table,
                   const std::vector<small::type::Datum>& values);
 
     void WriteRowWire(const std::shared_ptr<small::schema::Table>& table,
                       const std::vector<std::string>& values);
 
+    // Write rows in a single batch, all of them are committed atomically with
+    // a single WAL append. Of rows with the same primary key the last one
+    // wins.
+    bool WriteRows(const std::shared_ptr<small::schema::Table>& table,
+                   const std::vector<std::vector<small::type::Datum>>& rows);
+
+    // Add "deltas" to the Int64 columns "column_ids" of the row with the
+    // primary key by a merge operand (see "RowMergeOperator") to each family
+    // of the columns, without reading the row from rocksdb, so only these
+    // families are rewritten. The columns must not be covered by an index,
+    // whose entries would be stale. A missing row stays missing.
+    //
+    // A row moved out of rocksdb (see "ColdRowReader") has no base value for
+    // the operand, so every increment looks the row up by the cold row
+    // reader first. A row found there but not in rocksdb is written back
+    // with the deltas applied, under the lock of the row (see "LockRows"):
+    // a concurrent increment waits and merges its operand into that row
+    // instead of writing the cold row back again.
+    bool IncrementRow(const small::schema::Table& table,
+                      const small::type::Datum& pk,
+                      const std::vector<int64_t>& column_ids,
+                      const std::vector<int64_t>& deltas);
+
+    // =================================================================
+    // batch api
+    //
+    // Collect writes (maybe across column families) into a
+    // "rocksdb::WriteBatch" and commit them atomically by "Write".
+    // =================================================================
+
+    void Put(rocksdb::WriteBatch* batch, const std::string& cf_name,
+             const std::string& key, const std::string& value);
+
+    void Merge(rocksdb::WriteBatch* batch, const std::string& cf_name,
+               const std::string& key, const std::string& value);
+
+    // Lock the rows of the primary keys until the returned lock is
+    // destroyed. Index entries of the previous version of a row are deleted
+    // by its writer (see "PutRow"), which must hold the lock of the row from
+    // reading that version until its batch is committed: otherwise two
+    // writers both delete the entries of the same version, and the entries
+    // of the first one to commit are left stale.
+    //
+    // Locks are taken in a fixed order, so writers of overlapping rows never
+    // deadlock.
+    RowLock LockRows(const small::schema::Table& table,
+                     const std::vector<small::type::Datum>& pks);
+
+    // Put the row and its index entries, entries of the previous version of
+    // the row are deleted. That version is read from the database, not from
+    // the batch, so a row must be put at most once per batch, and the caller
+    // must hold the lock of the row (see "LockRows") if the table has
+    // indexes.
+    void PutRow(rocksdb::WriteBatch* batch,
+                const std::shared_ptr<small::schema::Table>& table,
+                const std::vector<small::type::Datum>& values);
+
+    void PutRowWire(rocksdb::WriteBatch* batch,
+                    const std::shared_ptr<small::schema::Table>& table,
+                    const std::vector<std::string>& values);
+
+    // Commit the batch, then bump the version of every table with rows
+    // written by it.
+    bool Write(rocksdb::WriteBatch* batch);
+
+    void Delete(rocksdb::WriteBatch* batch, const std::string& cf_name,
+                const std::string& key);
+
+    void DeleteRange(rocksdb::WriteBatch* batch, const std::string& cf_name,
+                     const std::string& begin, const std::string& end);
+
+    // =================================================================
+    // range removal
+    // =================================================================
+
+    // Delete all keys starting with "<varint id>" (rows of a table in the
+    // default column family, entries of an index in "IndexCF"/"BitmapCF") in
+    // constant time: a range tombstone hides them at once, SST files inside
+    // the range are deleted and compactions reclaim the rest.
+    //
+    // Files are only deleted if no snapshot older than the tombstone is live,
+    // readers of older snapshots still see all the keys. Otherwise the
+    // compactions reclaim everything once those snapshots are released.
+    bool DeletePrefix(const std::string& cf_name, int64_t id);
+
+    // Let compactions remove the keys starting with "<varint id>" without a
+    // range tombstone, the ID must never be used again (e.g. a dropped table).
+    // The ID is recorded in "TablesCF" and loaded when the database is
+    // opened, so the keys are still removed after a restart. Return false if
+    // it can't be recorded.
+    bool MarkPrefixDead(const std::string& cf_name, int64_t id);
+
+    uint64_t GetLatestSequenceNumber();
+
+    // Approximate bytes of the rows of a table, in SST files and memtables.
+    uint64_t GetApproximateTableSize(int64_t table_id);
+
+    // Name/value pairs of the on-disk size of each column family ("<cf>.*":
+    // bytes of the live SST files, raw bytes of their keys and values and
+    // the ratio of the raw to the compressed data blocks), and the cost of
+    // decompressing blocks and the hits of the prefix filters if statistics
+    // are enabled, see "StorageConfig::statistics".
+    std::vector<std::pair<std::string, std::string>> GetStorageReport();
+
+    // =================================================================
+    // bulk load
+    // =================================================================
+
+    // Sort the rows by primary key, write them into an SST file and ingest it
+    // into the default column family, skipping the memtable and the WAL. Of
+    // rows with the same primary key the last one wins, and rows of a later
+    // call override the ones of an earlier call.
+    //
+    // The index entries of the rows (and the deletes of the entries of the
+    // versions they replace) are written into SST files of "IndexCF" and
+    // "BitmapCF", all files are ingested atomically.
+    bool IngestRows(const std::shared_ptr<small::schema::Table>& table,
+                    const std::vector<std::vector<small::type::Datum>>& rows);
+
+    // Compact the rows of the table, e.g. after ingesting files which overlap
+    // existing rows. Block until it's done.
+    bool CompactTable(int64_t table_id);
+
+    // Version of the rows of a table, it changes after every committed write
+    // of the table. Read it before a scan: a scan can't miss writes committed
+    // before the version is read.
+    //
+    // Versions start from 0 when the process starts.
+    uint64_t GetTableVersion(int64_t table_id);
+
    private:
     rocksdb::DB* db_;
     std::unordered_map<std::string, rocksdb::ColumnFamilyHandle*> cf_handles_;
 
+    // Shared by batch writers, exclusive for "DeleteIfUnchanged".
+    std::shared_mutex write_mutex_;
+
+    std::mutex version_mutex_;
+    std::unordered_map<int64_t, uint64_t> table_versions_;
+
+    // added to the versions of all tables
+    uint64_t versions_epoch_ = 0;
+
+    void BumpTableVersions(const rocksdb::WriteBatch& batch);
+
+    // names the SST files of "IngestRows"
+    std::atomic<uint64_t> ingest_sequence_ = 0;
+
+    // see "LockRows"
+    std::array<std::mutex, kRowLockStripes> row_mutexes_;
+
+    ColdRowReader cold_row_reader_;
+
+    // Load the IDs recorded by "MarkPrefixDead".
+    void LoadDeadPrefixes();
+
+    void PutIndexEntries(rocksdb::WriteBatch* batch,
+                         const small::schema::Table& table,
+                         const std::vector<small::type::Datum>& values);
+
     void Close();
     rocksdb::ColumnFamilyHandle* GetColumnFamilyHandle(
         const std::string& cf_name);
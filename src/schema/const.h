@@ -21,4 +21,21 @@
 #include <cstdint>
 #include <string>
 
-namespace small::schema {}  // namespace small::schema
+namespace small::schema {
+
+// IDs of the system tables, they are fixed so the system tables can be located
+// before the catalog is loaded.
+constexpr int64_t kSystemTablesID = 1;
+constexpr int64_t kSystemPartitionsID = 2;
+
+// IDs of user tables start from here, IDs below it are reserved for system
+// tables.
+constexpr int64_t kFirstUserTableID = 100;
+
+// Column IDs start from 1 in every table.
+constexpr int64_t kFirstColumnID = 1;
+
+// Index IDs are unique across tables, they prefix the index entries.
+constexpr int64_t kFirstIndexID = 1;
+
+}  // namespace small::schema
@@ -64,6 +64,7 @@ namespace small::schema {
 
 void to_json(nlohmann::json& j, const Column& c) {
     j = nlohmann::json{
+        {"id", c.id},
         {"name", c.name},
         {"type", c.type},
         {"is_primary_key", c.is_primary_key},
@@ -71,18 +72,84 @@ void to_json(nlohmann::json& j, const Column& c) {
 }
 
 void from_json(const nlohmann::json& j, Column& c) {
+    j.at("id").get_to(c.id);
     j.at("name").get_to(c.name);
     j.at("type").get_to(c.type);
     j.at("is_primary_key").get_to(c.is_primary_key);
 }
 
+NLOHMANN_JSON_SERIALIZE_ENUM(Index::Method,
+                             {
+                                 {Index::Method::BTree, "btree"},
+                                 {Index::Method::Bitmap, "bitmap"},
+                             })
+
+void to_json(nlohmann::json& j, const Index& i) {
+    j = nlohmann::json{
+        {"id", i.id},
+        {"name", i.name},
+        {"method", i.method},
+        {"column_ids", i.column_ids},
+        {"include_column_ids", i.include_column_ids},
+    };
+}
+
+void from_json(const nlohmann::json& j, Index& i) {
+    j.at("id").get_to(i.id);
+    j.at("name").get_to(i.name);
+    if (j.contains("method")) {
+        j.at("method").get_to(i.method);
+    }
+    j.at("column_ids").get_to(i.column_ids);
+    j.at("include_column_ids").get_to(i.include_column_ids);
+}
+
+void to_json(nlohmann::json& j, const Family& f) {
+    j = nlohmann::json{
+        {"id", f.id},
+        {"name", f.name},
+        {"column_ids", f.column_ids},
+    };
+}
+
+void from_json(const nlohmann::json& j, Family& f) {
+    j.at("id").get_to(f.id);
+    j.at("name").get_to(f.name);
+    j.at("column_ids").get_to(f.column_ids);
+}
+
 void to_json(nlohmann::json& j, const Table& t) {
-    j = nlohmann::json{{"name", t.name}, {"columns", t.columns}};
+    j = nlohmann::json{{"id", t.id},
+                       {"name", t.name},
+                       {"columns", t.columns},
+                       {"indexes", t.indexes},
+                       {"families", t.families}};
 }
 
 void from_json(const nlohmann::json& j, Table& t) {
+    j.at("id").get_to(t.id);
     j.at("name").get_to(t.name);
     j.at("columns").get_to(t.columns);
+    if (j.contains("indexes")) {
+        j.at("indexes").get_to(t.indexes);
+    }
+    if (j.contains("families")) {
+        j.at("families").get_to(t.families);
+    }
+}
+
+bool Index::covers(int64_t column_id) const {
+    for (int64_t id : column_ids) {
+        if (id == column_id) {
+            return true;
+        }
+    }
+    for (int64_t id : include_column_ids) {
+        if (id == column_id) {
+            return true;
+        }
+    }
+    return false;
 }
 
 Column::Column(const std::string& name, const small::type::Type& type,
@@ -91,10 +158,11 @@ Column::Column(const std::string& name, const small::type::Type& type,
 
 void Column::set_primary_key(bool set) { is_primary_key = set; }
 
-Table::Table(const std::string& name, const std::vector<Column>& columns)
-    : name(name), columns(columns) {}
+Table::Table(int64_t id, const std::string& name,
+             const std::vector<Column>& columns)
+    : id(id), name(name), columns(columns) {}
 
-int Table::get_pk_index() {
+int Table::get_pk_index() const {
     for (int i = 0; i < columns.size(); ++i) {
         if (columns[i].is_primary_key) {
             return i;
@@ -103,4 +171,33 @@ int Table::get_pk_index() {
     return -1;
 }
 
+int Table::get_column_index(int64_t column_id) const {
+    for (int i = 0; i < columns.size(); ++i) {
+        if (columns[i].id == column_id) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int Table::get_column_index(const std::string& name) const {
+    for (int i = 0; i < columns.size(); ++i) {
+        if (columns[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int64_t Table::get_family_id(int64_t column_id) const {
+    for (const auto& family : families) {
+        for (int64_t id : family.column_ids) {
+            if (id == column_id) {
+                return family.id;
+            }
+        }
+    }
+    return 0;
+}
+
 }  // namespace small::schema
@@ -23,6 +23,19 @@
 // - partition metadata
 //   - key: P:<table ID>:<partition ID>
 //   - value: <partition metadata>
+// - segment manifest (see "small::columnar::Segment")
+//   - key: S:<table ID>
+//   - value: <segment file and sequence number>
+// - row data
+//   - key: <varint table ID><pk> (see "small::rocks::row_key")
+//   - value: <packed row> (see "small::encode::encode_row")
+// - index entry (column family "IndexCF")
+//   - key: <varint index ID><key columns><pk> (see "small::rocks::index_key")
+//   - value: <packed included columns>
+// - bitmap index container (column family "BitmapCF")
+//   - key: <varint index ID><value><row ID high 48 bits> (see
+//     "small::rocks::bitmap_key")
+//   - value: <container> (see "small::bitmap::Container")
 
 #pragma once
 
@@ -30,6 +43,7 @@
 // c++ std
 // =====================================================================
 
+#include <cstdint>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -57,6 +71,9 @@ namespace small::schema {
 
 class Column {
    public:
+    // Stable ID of the column inside its table, assigned by the catalog.
+    int64_t id = 0;
+
     std::string name;
     small::type::Type type;
     bool is_primary_key = false;
@@ -75,18 +92,94 @@ void to_json(nlohmann::json& j, const Column& c);
 
 void from_json(const nlohmann::json& j, Column& c);
 
+// A secondary index, its entries are kept in the same write batch as the rows.
+class Index {
+   public:
+    enum class Method {
+        // ordered entries of the key columns, for equality and range scans
+        BTree,
+
+        // a compressed bitmap of row IDs per value of a single (low
+        // cardinality) column, for =/IN predicates combined by AND/OR
+        Bitmap,
+    };
+
+    // Stable ID of the index, assigned by the catalog.
+    int64_t id = 0;
+
+    std::string name;
+
+    Method method = Method::BTree;
+
+    // IDs of the key columns, in order.
+    std::vector<int64_t> column_ids;
+
+    // IDs of the columns stored in the entries (INCLUDE), so scans reading only
+    // these columns and the key columns never touch the rows.
+    std::vector<int64_t> include_column_ids;
+
+    // Return true if the entries contain the column.
+    bool covers(int64_t column_id) const;
+};
+
+void to_json(nlohmann::json& j, const Index& i);
+
+void from_json(const nlohmann::json& j, Index& i);
+
+// A group of columns stored together as a single value, so a write of some
+// columns only rewrites the values of their families (see
+// "small::rocks::family_key"). Columns of no family, including the primary
+// key, are in the primary family.
+class Family {
+   public:
+    // ID of the family inside its table, from 1 (the primary family is 0).
+    int64_t id = 0;
+
+    std::string name;
+
+    // IDs of the columns, in the order of the table.
+    std::vector<int64_t> column_ids;
+};
+
+void to_json(nlohmann::json& j, const Family& f);
+
+void from_json(const nlohmann::json& j, Family& f);
+
 class Table {
    public:
+    // Stable ID of the table, assigned by the catalog.
+    int64_t id = 0;
+
     std::string name;
     std::vector<Column> columns;
 
     partition_t partition;
 
+    std::vector<Index> indexes;
+
+    // Families besides the primary family, empty if the whole row is stored
+    // as a single value.
+    std::vector<Family> families;
+
     Table() = default;
 
-    Table(const std::string& name, const std::vector<Column>& columns);
+    Table(int64_t id, const std::string& name,
+          const std::vector<Column>& columns);
+
+    int get_pk_index() const;
+
+    // Return the index of the column with the given ID, or -1 if not found.
+    int get_column_index(int64_t column_id) const;
 
-    int get_pk_index();
+    // Return the index of the column with the given name, or -1 if not found.
+    int get_column_index(const std::string& name) const;
+
+    // Return the ID of the family of the column, 0 for the primary family.
+    int64_t get_family_id(int64_t column_id) const;
 };
 
+void to_json(nlohmann::json& j, const Table& t);
+
+void from_json(const nlohmann::json& j, Table& t);
+
 }  // namespace small::schema
@@ -12,6 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <optional>
+#include <string>
+
 // =====================================================================
 // third-party libraries
 // =====================================================================
@@ -56,4 +63,12 @@ std::optional<small::type::Datum> extract_const(PgQuery__AConst* node) {
     }
 }
 
+std::string extract_table_name(PgQuery__RangeVar* range_var) {
+    std::string schema_name = range_var->schemaname;
+    if (schema_name.empty()) {
+        return range_var->relname;
+    }
+    return schema_name + "." + range_var->relname;
+}
+
 }  // namespace small::semantics
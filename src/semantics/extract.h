@@ -14,6 +14,13 @@
 
 #pragma once
 
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <optional>
+#include <string>
+
 // =====================================================================
 // third-party libraries
 // =====================================================================
@@ -32,4 +39,8 @@ namespace small::semantics {
 
 std::optional<small::type::Datum> extract_const(PgQuery__AConst* node);
 
+// Return the name of the table in the catalog, "<schema>.<relation>" if the
+// schema is given (e.g. "system.tables"), otherwise "<relation>".
+std::string extract_table_name(PgQuery__RangeVar* range_var);
+
 }  // namespace small::semantics
@@ -16,6 +16,8 @@
 // c++ std
 // =====================================================================
 
+#include <cstdint>
+#include <cstdlib>
 #include <string>
 
 // =====================================================================
@@ -32,6 +34,7 @@
 // local libraries
 // =====================================================================
 
+#include "src/rocks/config.h"
 #include "src/server/server.h"
 
 int main(int argc, char *argv[]) {
@@ -59,12 +62,71 @@ int main(int argc, char *argv[]) {
     std::string join;
     app.add_option("--join", join, "Join server address");
 
+    // storage options, the ones given on the command line override the ones
+    // from the config file
+    std::string storage_config_path;
+    app.add_option("--storage-config", storage_config_path,
+                   "Storage config file (JSON)")
+        ->check(CLI::ExistingFile);
+
+    uint64_t block_cache_size = 0;
+    auto block_cache_size_opt =
+        app.add_option("--block-cache-size", block_cache_size,
+                       "Size of the shared block cache (e.g. 4GB)")
+            ->transform(CLI::AsSizeValue(false));
+
+    std::string block_cache_type;
+    auto block_cache_type_opt =
+        app.add_option("--block-cache-type", block_cache_type,
+                       "Type of the shared block cache")
+            ->check(CLI::IsMember({"lru", "hyper_clock"}));
+
+    int max_background_jobs = 0;
+    auto max_background_jobs_opt =
+        app.add_option("--max-background-jobs", max_background_jobs,
+                       "Max number of concurrent flushes and compactions")
+            ->check(CLI::PositiveNumber);
+
+    uint64_t compaction_rate_limit = 0;
+    auto compaction_rate_limit_opt =
+        app.add_option("--compaction-rate-limit", compaction_rate_limit,
+                       "Bytes per second of flushes and compactions (e.g. "
+                       "100MB), 0 means unlimited")
+            ->transform(CLI::AsSizeValue(false));
+
     try {
         app.parse(argc, argv);
     } catch (const CLI::ParseError &e) {
         return app.exit(e);
     }
 
+    small::rocks::StorageConfig storage_config;
+    if (!storage_config_path.empty()) {
+        auto config = small::rocks::load_storage_config(storage_config_path);
+        if (!config.ok()) {
+            SPDLOG_ERROR("failed to load storage config: {}",
+                         config.status().ToString());
+            return EXIT_FAILURE;
+        }
+        storage_config = config.value();
+    }
+    if (*block_cache_size_opt) {
+        storage_config.block_cache_size = block_cache_size;
+    }
+    if (*block_cache_type_opt) {
+        storage_config.block_cache_type =
+            block_cache_type == "hyper_clock"
+                ? small::rocks::StorageConfig::CacheType::HyperClock
+                : small::rocks::StorageConfig::CacheType::LRU;
+    }
+    if (*max_background_jobs_opt) {
+        storage_config.max_background_jobs = max_background_jobs;
+    }
+    if (*compaction_rate_limit_opt) {
+        storage_config.compaction_rate_limit = compaction_rate_limit;
+    }
+    small::rocks::init_storage_config(storage_config);
+
     std::string sql_addr = fmt::format("0.0.0.0:{}", sql_port);
     std::string grpc_addr = fmt::format("0.0.0.0:{}", grpc_addr);
 
@@ -55,10 +55,13 @@
 // =====================================================================
 
 #include "src/catalog/catalog.h"
+#include "src/columnar/scan_cache.h"
+#include "src/columnar/segment.h"
 #include "src/gossip/gossip.h"
 #include "src/insert/insert.h"
 #include "src/peers/server_registry.h"
 #include "src/pg_wire/pg_wire.h"
+#include "src/query/expression_cache.h"
 #include "src/server/stmt_handler.h"
 #include "src/server_info/info.h"
 #include "src/util/ip/ip.h"
@@ -279,16 +282,25 @@ void handle_query(std::string& query, int sockfd) {
             return;
         }
 
-        auto record_batch = result.value();
-
-        if (record_batch->num_rows() == 0) {
-            small::pg_wire::send_empty_result(sockfd);
-            return;
-        } else {
-            SPDLOG_INFO("result batch: {}", record_batch->ToString());
-            small::pg_wire::send_batch(sockfd, record_batch);
-            return;
+        // pull the batches of the result and flush each one to the client,
+        // the memory used doesn't grow with the size of the result
+        auto pipeline = std::move(result.value());
+        small::pg_wire::ResultWriter writer(sockfd);
+        while (true) {
+            auto batch = pipeline->Next();
+            if (!batch.ok()) {
+                SPDLOG_ERROR("error executing statement: {}",
+                             batch.status().ToString());
+                small::pg_wire::send_error(sockfd, batch.status().ToString());
+                return;
+            }
+            if (batch.value() == nullptr) {
+                break;
+            }
+            writer.Write(batch.value());
         }
+        writer.Finish();
+        return;
     }
 }
 
@@ -319,6 +331,9 @@ int RunServer(const small::server_info::ImmutableInfo& args) {
     }
 
     small::catalog::Catalog::InitInstance();
+    small::columnar::SegmentStore::InitInstance();
+    small::columnar::ScanCache::InitInstance();
+    query::ExpressionCache::InitInstance();
 
     small::gossip::GossipServer::init_instance(args);
     // === initialize singleton instances end ===
@@ -36,16 +36,28 @@
 
 // absl
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 
 // =====================================================================
 // local libraries
 // =====================================================================
 
 #include "src/catalog/catalog.h"
+#include "src/columnar/scan_cache.h"
+#include "src/insert/copy.h"
 #include "src/insert/insert.h"
+#include "src/query/expression_cache.h"
+#include "src/query/index_scan.h"
+#include "src/query/pipeline.h"
 #include "src/query/query.h"
+#include "src/query/truncate.h"
+#include "src/query/update.h"
+#include "src/rocks/rocks.h"
+#include "src/schema/const.h"
 #include "src/schema/schema.h"
 #include "src/semantics/check.h"
+#include "src/semantics/extract.h"
+#include "src/server_info/info.h"
 
 // =====================================================================
 // self header
@@ -55,6 +67,50 @@
 
 namespace small::stmt_handler {
 
+namespace {
+
+using Families = std::vector<std::pair<std::string, std::vector<std::string>>>;
+
+// Parse the column families of a table, postgres has no syntax for them so
+// they are storage parameters:
+//
+//   CREATE TABLE ... WITH (family.<name> = '<column>[, <column> ...]')
+absl::StatusOr<Families> get_families(PgQuery__CreateStmt* create_stmt) {
+    Families families;
+    for (int i = 0; i < create_stmt->n_options; i++) {
+        auto def_elem = create_stmt->options[i]->def_elem;
+        if (std::string(def_elem->defnamespace) != "family") {
+            continue;
+        }
+        if (def_elem->arg == nullptr ||
+            def_elem->arg->node_case != PG_QUERY__NODE__NODE_STRING) {
+            return absl::InvalidArgumentError(
+                fmt::format("columns of family {} must be a string",
+                            def_elem->defname));
+        }
+
+        std::vector<std::string> columns;
+        std::string column;
+        for (const char* c = def_elem->arg->string->sval;; c++) {
+            if (*c == ',' || *c == '\0') {
+                if (!column.empty()) {
+                    columns.push_back(column);
+                }
+                column.clear();
+                if (*c == '\0') {
+                    break;
+                }
+            } else if (*c != ' ') {
+                column.push_back(*c);
+            }
+        }
+        families.emplace_back(def_elem->defname, columns);
+    }
+    return families;
+}
+
+}  // namespace
+
 absl::Status handle_create_table(PgQuery__CreateStmt* create_stmt) {
     std::string table_name = create_stmt->relation->relname;
     std::vector<small::schema::Column> columns;
@@ -115,8 +171,13 @@ absl::Status handle_create_table(PgQuery__CreateStmt* create_stmt) {
         }
     }
 
+    auto families = get_families(create_stmt);
+    if (!families.ok()) {
+        return families.status();
+    }
+
     auto status = small::catalog::Catalog::GetInstance()->CreateTable(
-        table_name, columns);
+        table_name, columns, families.value());
     if (!status.ok()) {
         SPDLOG_ERROR("create table failed: {}", status.ToString());
         return status;
@@ -146,7 +207,60 @@ absl::Status handle_create_table(PgQuery__CreateStmt* create_stmt) {
 
 absl::Status handle_drop_table(PgQuery__DropStmt* drop_stmt) {
     auto table_name = drop_stmt->objects[0]->list->items[0]->string->sval;
-    return small::catalog::Catalog::GetInstance()->DropTable(table_name);
+    auto catalog = small::catalog::Catalog::GetInstance();
+    auto table = catalog->GetTable(table_name);
+    auto status = catalog->DropTable(table_name);
+    if (!status.ok() || !table.has_value()) {
+        return status;
+    }
+
+    // the table is gone from the catalog, its keys can go in the background
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        return info.status();
+    }
+    auto db =
+        small::rocks::RocksDBWrapper::GetInstance(info.value()->db_path, {});
+    return query::truncate_table(table.value(), /*drop=*/true, db);
+}
+
+absl::Status handle_truncate(PgQuery__TruncateStmt* truncate_stmt) {
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        return info.status();
+    }
+    auto db =
+        small::rocks::RocksDBWrapper::GetInstance(info.value()->db_path, {});
+
+    for (int i = 0; i < truncate_stmt->n_relations; i++) {
+        auto table_name = small::semantics::extract_table_name(
+            truncate_stmt->relations[i]->range_var);
+        auto table =
+            small::catalog::Catalog::GetInstance()->GetTable(table_name);
+        if (!table.has_value()) {
+            return absl::NotFoundError("Table not found: " + table_name);
+        }
+        if (table.value()->id < small::schema::kFirstUserTableID) {
+            return absl::InvalidArgumentError("can't truncate system table: " +
+                                              table_name);
+        }
+
+        auto status = query::truncate_table(table.value(), /*drop=*/false, db);
+        if (!status.ok()) {
+            return status;
+        }
+    }
+    return absl::OkStatus();
+}
+
+absl::Status handle_update(PgQuery__UpdateStmt* update_stmt) {
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        return info.status();
+    }
+    auto db =
+        small::rocks::RocksDBWrapper::GetInstance(info.value()->db_path, {});
+    return query::update(update_stmt, db);
 }
 
 absl::Status handle_add_partition(PgQuery__CreateStmt* create_stmt) {
@@ -178,6 +292,141 @@ absl::Status handle_add_constraint(PgQuery__AlterTableStmt* alter_stmt) {
         partition_name, std::make_pair(lexpr, rexpr));
 }
 
+absl::Status handle_create_index(PgQuery__IndexStmt* index_stmt) {
+    if (index_stmt->unique) {
+        return absl::UnimplementedError("unique index is not supported");
+    }
+    std::string access_method = index_stmt->access_method;
+    small::schema::Index::Method method;
+    if (access_method == "btree") {
+        method = small::schema::Index::Method::BTree;
+    } else if (access_method == "bitmap") {
+        method = small::schema::Index::Method::Bitmap;
+    } else {
+        return absl::UnimplementedError("unsupported index method: " +
+                                        access_method);
+    }
+
+    auto table_name =
+        small::semantics::extract_table_name(index_stmt->relation);
+
+    std::vector<std::string> columns;
+    for (int i = 0; i < index_stmt->n_index_params; i++) {
+        std::string name = index_stmt->index_params[i]->index_elem->name;
+        if (name.empty()) {
+            return absl::UnimplementedError(
+                "index on expression is not supported");
+        }
+        columns.push_back(name);
+    }
+
+    std::vector<std::string> include_columns;
+    for (int i = 0; i < index_stmt->n_index_including_params; i++) {
+        include_columns.push_back(
+            index_stmt->index_including_params[i]->index_elem->name);
+    }
+
+    // name the index like postgres does if it's not given
+    std::string index_name = index_stmt->idxname;
+    if (index_name.empty()) {
+        index_name = index_stmt->relation->relname;
+        for (const auto& column : columns) {
+            index_name += "_" + column;
+        }
+        index_name += "_idx";
+    }
+
+    auto catalog = small::catalog::Catalog::GetInstance();
+    auto index = catalog->CreateIndex(index_name, table_name, columns,
+                                      include_columns, method);
+    if (!index.ok()) {
+        SPDLOG_ERROR("create index failed: {}", index.status().ToString());
+        return index.status();
+    }
+
+    // new writes maintain the index from now on, write the entries of the
+    // existing rows
+    auto info = small::server_info::get_info();
+    if (!info.ok()) {
+        return info.status();
+    }
+    auto db =
+        small::rocks::RocksDBWrapper::GetInstance(info.value()->db_path, {});
+    return query::backfill_index(catalog->GetTable(table_name).value(),
+                                 index.value(), db);
+}
+
+absl::Status handle_copy(PgQuery__CopyStmt* copy_stmt) {
+    auto rows = small::insert::copy_from(copy_stmt);
+    if (!rows.ok()) {
+        SPDLOG_ERROR("copy failed: {}", rows.status().ToString());
+        return rows.status();
+    }
+    return absl::OkStatus();
+}
+
+// SHOW storage: the on-disk size and decompression cost of rocksdb.
+// SHOW expression_cache: the hits, misses and size of the cache of compiled
+// expressions.
+// SHOW scan_cache: the hits, misses and bytes of the cache of table scans.
+//
+// One name/value row per metric.
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> handle_show(
+    PgQuery__VariableShowStmt* show_stmt) {
+    std::string variable = show_stmt->name;
+    std::vector<std::pair<std::string, std::string>> report;
+    if (variable == "storage") {
+        auto info = small::server_info::get_info();
+        if (!info.ok()) {
+            return info.status();
+        }
+        auto db = small::rocks::RocksDBWrapper::GetInstance(
+            info.value()->db_path, {});
+        report = db->GetStorageReport();
+    } else if (variable == "expression_cache") {
+        auto cache = query::ExpressionCache::GetInstance();
+        if (cache == nullptr) {
+            return absl::InternalError("expression cache not initialized");
+        }
+        report = {
+            {"hits", std::to_string(cache->num_hits())},
+            {"misses", std::to_string(cache->num_misses())},
+            {"entries", std::to_string(cache->size())},
+        };
+    } else if (variable == "scan_cache") {
+        auto cache = small::columnar::ScanCache::GetInstance();
+        if (cache == nullptr) {
+            return absl::InternalError("scan cache not initialized");
+        }
+        report = {
+            {"hits", std::to_string(cache->num_hits())},
+            {"misses", std::to_string(cache->num_misses())},
+            {"bytes", std::to_string(cache->bytes())},
+        };
+    } else {
+        return absl::UnimplementedError(
+            fmt::format("unknown variable: {}", variable));
+    }
+
+    arrow::StringBuilder names;
+    arrow::StringBuilder values;
+    for (const auto& [name, value] : report) {
+        if (!names.Append(name).ok() || !values.Append(value).ok()) {
+            return absl::InternalError("failed to build the report");
+        }
+    }
+    std::shared_ptr<arrow::Array> name_array;
+    std::shared_ptr<arrow::Array> value_array;
+    if (!names.Finish(&name_array).ok() || !values.Finish(&value_array).ok()) {
+        return absl::InternalError("failed to build the report");
+    }
+
+    auto schema = arrow::schema({arrow::field("name", arrow::utf8()),
+                                 arrow::field("value", arrow::utf8())});
+    return arrow::RecordBatch::Make(schema, report.size(),
+                                    {name_array, value_array});
+}
+
 std::shared_ptr<arrow::RecordBatch> EmptyBatch() {
     auto schema = arrow::schema({});
     arrow::ArrayVector outputs;
@@ -196,7 +445,8 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> WrapEmptyStatus(
     }
 }
 
-absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> handle_stmt(
+// Execute a statement other than SELECT, its result is a single batch.
+absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> execute_stmt(
     PgQuery__Node* stmt) {
     switch (stmt->node_case) {
         case PG_QUERY__NODE__NODE_CREATE_STMT: {
@@ -212,12 +462,22 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> handle_stmt(
             }
             break;
         }
+        case PG_QUERY__NODE__NODE_INDEX_STMT: {
+            return WrapEmptyStatus(
+                [&]() { return handle_create_index(stmt->index_stmt); });
+            break;
+        }
         case PG_QUERY__NODE__NODE_DROP_STMT: {
             // return handle_drop_table(stmt->drop_stmt);
             return WrapEmptyStatus(
                 [&]() { return handle_drop_table(stmt->drop_stmt); });
             break;
         }
+        case PG_QUERY__NODE__NODE_TRUNCATE_STMT: {
+            return WrapEmptyStatus(
+                [&]() { return handle_truncate(stmt->truncate_stmt); });
+            break;
+        }
         case PG_QUERY__NODE__NODE_TRANSACTION_STMT: {
             SPDLOG_INFO("transaction statement");
             break;
@@ -229,15 +489,25 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> handle_stmt(
             });
             break;
         }
-        case PG_QUERY__NODE__NODE_SELECT_STMT: {
-            return query::query(stmt->select_stmt);
-            break;
-        }
         case PG_QUERY__NODE__NODE_INSERT_STMT: {
             return WrapEmptyStatus(
                 [&]() { return small::insert::insert(stmt->insert_stmt); });
             break;
         }
+        case PG_QUERY__NODE__NODE_UPDATE_STMT: {
+            return WrapEmptyStatus(
+                [&]() { return handle_update(stmt->update_stmt); });
+            break;
+        }
+        case PG_QUERY__NODE__NODE_COPY_STMT: {
+            return WrapEmptyStatus(
+                [&]() { return handle_copy(stmt->copy_stmt); });
+            break;
+        }
+        case PG_QUERY__NODE__NODE_VARIABLE_SHOW_STMT: {
+            return handle_show(stmt->variable_show_stmt);
+            break;
+        }
         default:
             SPDLOG_ERROR("unknown statement, node_case: {}",
                          magic_enum::enum_name(stmt->node_case));
@@ -250,4 +520,18 @@ absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> handle_stmt(
     return EmptyBatch();
 }
 
+absl::StatusOr<std::unique_ptr<query::Operator>> handle_stmt(
+    PgQuery__Node* stmt) {
+    // a SELECT streams its result, other statements return it at once
+    if (stmt->node_case == PG_QUERY__NODE__NODE_SELECT_STMT) {
+        return query::query(stmt->select_stmt);
+    }
+    auto batch = execute_stmt(stmt);
+    if (!batch.ok()) {
+        return batch.status();
+    }
+    return std::unique_ptr<query::Operator>(
+        std::make_unique<query::BatchSource>(batch.value()));
+}
+
 }  // namespace small::stmt_handler
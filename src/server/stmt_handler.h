@@ -27,9 +27,16 @@
 // pg_query
 #include "pg_query.pb-c.h"
 
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/query/pipeline.h"
+
 namespace small::stmt_handler {
 
-absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> handle_stmt(
+// Execute the statement, return the pipeline its result is pulled from.
+absl::StatusOr<std::unique_ptr<query::Operator>> handle_stmt(
     PgQuery__Node* stmt);
 
 }  // namespace small::stmt_handler
@@ -96,6 +96,18 @@ gandiva::DataTypePtr get_gandiva_type(Type type) {
     }
 }
 
+absl::StatusOr<Type> from_gandiva_type(const gandiva::DataTypePtr& type) {
+    switch (type->id()) {
+        case arrow::Type::INT64:
+            return Type::Int64;
+        case arrow::Type::STRING:
+            return Type::String;
+        default:
+            return absl::InternalError("unknown gandiva type: " +
+                                       type->ToString());
+    }
+}
+
 // > For a fixed-size type, typlen is the number of bytes in the internal
 // > representation of the type. But for a variable-length type, typlen is
 // > negative. -1 indicates a “varlena” type (one that has a length word), -2
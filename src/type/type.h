@@ -52,6 +52,9 @@ absl::StatusOr<Type> from_pgwire_oid(pqxx::oid oid);
 
 gandiva::DataTypePtr get_gandiva_type(Type type);
 
+// The inverse of "get_gandiva_type", e.g. the type of a result column.
+absl::StatusOr<Type> from_gandiva_type(const gandiva::DataTypePtr& type);
+
 int16_t get_pgwire_size(Type type);
 
 }  // namespace small::type
@@ -0,0 +1,276 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// absl
+#include "absl/status/statusor.h"
+
+// arrow
+#include "arrow/api.h"
+
+// gtest
+#include "gtest/gtest.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/query/aggregate.h"
+#include "src/query/pipeline.h"
+#include "src/server_info/info.h"
+
+namespace {
+
+constexpr char kDataDir[] = "./data/aggregate_test";
+
+// one row per batch, so every level of spilling still gets batches after its
+// first one
+constexpr int64_t kRows = 4096;
+
+// Produce the rows of a batch one at a time.
+class RowSource : public query::Operator {
+   public:
+    explicit RowSource(std::shared_ptr<arrow::RecordBatch> batch)
+        : batch_(std::move(batch)) {}
+
+    std::shared_ptr<arrow::Schema> schema() const override {
+        return batch_->schema();
+    }
+
+    absl::StatusOr<std::shared_ptr<arrow::RecordBatch>> Next() override {
+        if (offset_ >= batch_->num_rows()) {
+            return std::shared_ptr<arrow::RecordBatch>();
+        }
+        return batch_->Slice(offset_++, 1);
+    }
+
+   private:
+    std::shared_ptr<arrow::RecordBatch> batch_;
+    int64_t offset_ = 0;
+};
+
+// The input rows: the keys are (name, bucket) and both have NULLs, so do the
+// values, some groups only have NULL values.
+std::shared_ptr<arrow::RecordBatch> make_rows() {
+    arrow::StringBuilder names;
+    arrow::Int64Builder buckets;
+    arrow::Int64Builder values;
+    arrow::StringBuilder labels;
+    for (int64_t i = 0; i < kRows; i++) {
+        auto _ = i % 17 == 0 ? names.AppendNull()
+                             : names.Append("n" + std::to_string(i % 50));
+        _ = i % 13 == 0 ? buckets.AppendNull() : buckets.Append(i % 37);
+        _ = i % 5 == 0 ? values.AppendNull() : values.Append(i * 7 - 9000);
+        _ = i % 3 == 0 ? labels.AppendNull()
+                       : labels.Append("l" + std::to_string(i % 101));
+    }
+    auto schema = arrow::schema({
+        arrow::field("name", arrow::utf8()),
+        arrow::field("bucket", arrow::int64()),
+        arrow::field("value", arrow::int64()),
+        arrow::field("label", arrow::utf8()),
+    });
+    return arrow::RecordBatch::Make(
+        schema, kRows,
+        {names.Finish().ValueOrDie(), buckets.Finish().ValueOrDie(),
+         values.Finish().ValueOrDie(), labels.Finish().ValueOrDie()});
+}
+
+std::string cell(const arrow::Array& array, int64_t row) {
+    if (array.IsNull(row)) {
+        return "NULL";
+    }
+    return array.GetScalar(row).ValueOrDie()->ToString();
+}
+
+size_t count_spill_files() {
+    auto dir = std::filesystem::path(kDataDir) / "spill";
+    std::error_code ec;
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+        (void)entry;
+        count++;
+    }
+    return count;
+}
+
+// The result of an aggregation, the cells of the aggregates by the keys.
+class Result {
+   public:
+    std::map<std::string, std::vector<std::string>> groups;
+
+    // a group produced twice, e.g. by a partition and by the memory
+    bool duplicated = false;
+
+    // spill files left after the first output batch
+    size_t spill_files = 0;
+};
+
+Result aggregate(int64_t memory_limit, int max_depth) {
+    std::vector<query::Aggregate> aggregates = {
+        {query::Aggregate::Kind::CountStar, 0, "count_star"},
+        {query::Aggregate::Kind::Count, 2, "count"},
+        {query::Aggregate::Kind::Sum, 2, "sum"},
+        {query::Aggregate::Kind::Avg, 2, "avg"},
+        {query::Aggregate::Kind::Min, 3, "min"},
+        {query::Aggregate::Kind::Max, 2, "max"},
+    };
+    auto op = query::HashAggregate::Make(
+        std::make_unique<RowSource>(make_rows()), 2, aggregates, memory_limit,
+        max_depth);
+    EXPECT_TRUE(op.ok()) << op.status();
+
+    Result result;
+    bool first = true;
+    while (true) {
+        auto batch = op.value()->Next();
+        EXPECT_TRUE(batch.ok()) << batch.status();
+        if (!batch.ok() || batch.value() == nullptr) {
+            break;
+        }
+        if (first) {
+            result.spill_files = count_spill_files();
+            first = false;
+        }
+        const auto& b = *batch.value();
+        for (int64_t r = 0; r < b.num_rows(); r++) {
+            std::string key =
+                cell(*b.column(0), r) + "|" + cell(*b.column(1), r);
+            std::vector<std::string> cells;
+            for (int c = 2; c < b.num_columns(); c++) {
+                cells.push_back(cell(*b.column(c), r));
+            }
+            if (!result.groups.emplace(key, cells).second) {
+                result.duplicated = true;
+            }
+        }
+    }
+    return result;
+}
+
+class AggregateTest : public ::testing::Test {
+   protected:
+    static void SetUpTestSuite() {
+        std::filesystem::remove_all(kDataDir);
+        auto _ = small::server_info::init(
+            small::server_info::ImmutableInfo{"", "", kDataDir, "", ""});
+    }
+
+    static void TearDownTestSuite() { std::filesystem::remove_all(kDataDir); }
+};
+
+// Without spilling the groups match a plain computation over the rows, NULL
+// keys form their own groups and NULL values are skipped.
+TEST_F(AggregateTest, InMemory) {
+    class Expected {
+       public:
+        int64_t count_star = 0;
+        int64_t count = 0;
+        int64_t sum = 0;
+        int64_t max = 0;
+        std::string min;
+        bool has_min = false;
+    };
+
+    auto rows = make_rows();
+    std::map<std::string, Expected> expected;
+    for (int64_t i = 0; i < kRows; i++) {
+        auto& e = expected[cell(*rows->column(0), i) + "|" +
+                           cell(*rows->column(1), i)];
+        e.count_star++;
+        if (rows->column(2)->IsValid(i)) {
+            int64_t value =
+                static_cast<const arrow::Int64Array&>(*rows->column(2))
+                    .Value(i);
+            e.max = e.count == 0 ? value : std::max(e.max, value);
+            e.sum += value;
+            e.count++;
+        }
+        if (rows->column(3)->IsValid(i)) {
+            auto label = cell(*rows->column(3), i);
+            if (!e.has_min || label < e.min) {
+                e.min = label;
+                e.has_min = true;
+            }
+        }
+    }
+
+    auto result = aggregate(query::kAggregateMemoryLimit,
+                            query::kAggregateMaxDepth);
+    EXPECT_FALSE(result.duplicated);
+    EXPECT_EQ(result.spill_files, 0u);
+    ASSERT_EQ(result.groups.size(), expected.size());
+    EXPECT_TRUE(result.groups.count("NULL|NULL"));
+
+    bool all_null_values = false;
+    for (const auto& [key, e] : expected) {
+        auto it = result.groups.find(key);
+        ASSERT_NE(it, result.groups.end()) << key;
+        const auto& cells = it->second;
+        EXPECT_EQ(cells[0], std::to_string(e.count_star)) << key;
+        EXPECT_EQ(cells[1], std::to_string(e.count)) << key;
+        EXPECT_EQ(cells[2], e.count == 0 ? "NULL" : std::to_string(e.sum))
+            << key;
+        EXPECT_EQ(cells[3] == "NULL", e.count == 0) << key;
+        EXPECT_EQ(cells[4], e.has_min ? e.min : "NULL") << key;
+        EXPECT_EQ(cells[5], e.count == 0 ? "NULL" : std::to_string(e.max))
+            << key;
+        all_null_values |= e.count == 0;
+    }
+    EXPECT_TRUE(all_null_values);
+}
+
+// A memory limit of 1 byte spills after the first batch of every level, so
+// the partitions are split again until they hold a batch or two.
+TEST_F(AggregateTest, Spill) {
+    auto in_memory = aggregate(query::kAggregateMemoryLimit,
+                               query::kAggregateMaxDepth);
+    auto spilled = aggregate(1, query::kAggregateMaxDepth);
+    EXPECT_FALSE(spilled.duplicated);
+    EXPECT_GT(spilled.spill_files, 1u);
+    EXPECT_EQ(spilled.groups, in_memory.groups);
+
+    // the spill files are deleted once read
+    EXPECT_EQ(count_spill_files(), 0u);
+}
+
+// Partitions of the last level are aggregated in memory over the limit.
+TEST_F(AggregateTest, MaxDepth) {
+    auto in_memory = aggregate(query::kAggregateMemoryLimit,
+                               query::kAggregateMaxDepth);
+    for (int max_depth : {0, 1}) {
+        auto spilled = aggregate(1, max_depth);
+        EXPECT_FALSE(spilled.duplicated);
+        EXPECT_EQ(spilled.spill_files > 0, max_depth > 0);
+        EXPECT_EQ(spilled.groups, in_memory.groups);
+        EXPECT_EQ(count_spill_files(), 0u);
+    }
+}
+
+}  // namespace
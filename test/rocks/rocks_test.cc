@@ -0,0 +1,106 @@
+// Copyright 2025 Xiaochen Cui
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// =====================================================================
+// c++ std
+// =====================================================================
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// =====================================================================
+// third-party libraries
+// =====================================================================
+
+// gtest
+#include "gtest/gtest.h"
+
+// rocksdb
+#include "rocksdb/slice.h"
+
+// =====================================================================
+// local libraries
+// =====================================================================
+
+#include "src/rocks/config.h"
+#include "src/rocks/rocks.h"
+
+namespace {
+
+constexpr char kDataDir[] = "./data/rocks_test";
+
+int64_t report_value(small::rocks::RocksDBWrapper* db,
+                     const std::string& name) {
+    std::map<std::string, std::string> report;
+    for (auto& [key, value] : db->GetStorageReport()) {
+        report[key] = value;
+    }
+    EXPECT_TRUE(report.count(name)) << name;
+    return report.count(name) ? std::stoll(report[name]) : 0;
+}
+
+int count_keys(small::rocks::RocksDBWrapper* db, const std::string& lower,
+               const std::string& upper) {
+    int count = 0;
+    db->Scan(rocksdb::kDefaultColumnFamilyName, lower, upper,
+             [&](const rocksdb::Slice&, const rocksdb::Slice&) {
+                 count++;
+                 return true;
+             });
+    return count;
+}
+
+// A scan of a table seeks with the prefix filters, so it skips an SST file
+// with the tables before and after it but none of its rows.
+TEST(RocksTest, PrefixFilter) {
+    std::filesystem::remove_all(kDataDir);
+    small::rocks::StorageConfig config;
+    config.statistics = true;
+    small::rocks::init_storage_config(config);
+    auto* db = small::rocks::RocksDBWrapper::GetInstance(kDataDir, {});
+
+    for (int64_t table_id : {1, 5}) {
+        auto prefix = small::rocks::table_prefix(table_id);
+        for (int i = 0; i < 100; i++) {
+            ASSERT_TRUE(db->Put(prefix + std::to_string(i), "v"));
+        }
+    }
+
+    // flush the memtable into a single SST file with both tables
+    ASSERT_TRUE(db->CompactTable(1));
+
+    int64_t checked = report_value(db, "bloom_prefix_checked");
+    int64_t useful = report_value(db, "bloom_prefix_useful");
+
+    auto absent = small::rocks::table_prefix(3);
+    EXPECT_EQ(count_keys(db, absent, small::rocks::prefix_successor(absent)),
+              0);
+    EXPECT_GT(report_value(db, "bloom_prefix_checked"), checked);
+    EXPECT_GT(report_value(db, "bloom_prefix_useful"), useful);
+
+    auto prefix = small::rocks::table_prefix(1);
+    EXPECT_EQ(count_keys(db, prefix, small::rocks::prefix_successor(prefix)),
+              100);
+
+    // ranges over several prefixes seek in total order
+    EXPECT_EQ(count_keys(db, prefix, ""), 200);
+    EXPECT_EQ(count_keys(db, prefix, small::rocks::table_prefix(5) + "5"),
+              145);
+}
+
+}  // namespace